@@ -1,6 +1,5 @@
 #include <glad/glad.h>
 #include <GLFW/glfw3.h>
-#include <stb_image.h>
 
 #include <glm/glm.hpp>
 #include <glm/gtc/matrix_transform.hpp>
@@ -17,15 +16,27 @@
 #include <iostream>
 #include "Timer.h"
 #include <chrono>
-#include <thread>
+#include <cctype>
 #include "Skybox.h"
+#include "Profiler.h"
+#include "BonePaletteBuffer.h"
+#include "ClipLoader.h"
+#include "AssetCache.h"
+#include "AllocationCounter.h"
+#include "JobSystem.h"
+#include "ImageData.h"
+#include "TextureCache.h"
+#include "TextureCook.h"
+#include "IBL.h"
+#include "SimulationClock.h"
+#include "Fighter.h"
+#include "AnimationSystem.h"
+#include "CrowdRenderer.h"
 #include <irrKlang/irrKlang.h>
 
 using namespace irrklang;
 
 ISoundEngine* soundEngine;
-ISoundSource* punchSound;
-ISoundSource* kickSound;
 ISoundSource* P1swishSound;
 ISoundSource* P2swishSound;
 ISoundSource* BGM;
@@ -34,48 +45,13 @@ ISoundSource* introP2Sound;
 ISoundSource* crowdSound;
 
 #define MAX_HEALTH 100.0f
-#define HIT_PAUSE_DURATION 0.1f // adjust the duration as necessary
+// hit-stop on a blocked strike: seconds of simulation frozen while rendering and input carry
+// on. A strike that lands freezes for its own clip's hitStop.
+#define BLOCK_HIT_STOP 0.05f
 
 
 #define ROUND_DURATION 60.0f
 
-enum AnimStateP1 {
-	P1_IDLE = 1,
-	P1_IDLE_PUNCH,
-	P1_PUNCH_IDLE,
-	P1_IDLE_KICK,
-	P1_KICK_IDLE,
-	P1_IDLE_BLOCK,
-	P1_BLOCK_IDLE,
-	P1_IDLE_WALK_FRONT,
-	P1_IDLE_WALK_BACK,
-	P1_WALK_FRONT_IDLE,
-	P1_WALK_BACK_IDLE,
-	P1_WALK_FRONT,
-	P1_WALK_BACK,
-	P1_IDLE_HIT,
-	P1_HIT_IDLE
-
-};
-
-enum AnimStateP2 {
-	P2_IDLE = 1,
-	P2_IDLE_PUNCH,
-	P2_PUNCH_IDLE,
-	P2_IDLE_KICK,
-	P2_KICK_IDLE,
-	P2_IDLE_BLOCK,
-	P2_BLOCK_IDLE,
-	P2_IDLE_WALK_FRONT,
-	P2_IDLE_WALK_BACK,
-	P2_WALK_FRONT_IDLE,
-	P2_WALK_BACK_IDLE,
-	P2_WALK_FRONT,
-	P2_WALK_BACK,
-	P2_IDLE_HIT,
-	P2_HIT_IDLE
-};
-
 enum GameState {
 	GAME_INTRO,
 	INTRO_P1,
@@ -112,8 +88,6 @@ void framebuffer_size_callback(GLFWwindow* window, int width, int height);
 void mouse_callback(GLFWwindow* window, double xpos, double ypos);
 void scroll_callback(GLFWwindow* window, double xoffset, double yoffset);
 void processInput(GLFWwindow* window);
-void UpdateStateP1(GLFWwindow* window, Animator& animator, AnimStateP1& charState, float& blendAmount);
-void UpdateStateP2(GLFWwindow* window, Animator& animator, AnimStateP2& charState, float& blendAmount);
 
 //PBR
 void renderCube();
@@ -122,7 +96,6 @@ void renderQuad();
 void initTextRendering(const std::string& fontPath);
 void RenderText(Shader& shader, std::string text, float x, float y, float scale, glm::vec3 color);
 
-unsigned int loadTexture(char const* path);
 void initUIRendering();
 void RenderUIElement(Shader& shader, unsigned int texture, float x, float y, float width, float height);
 
@@ -177,53 +150,32 @@ float lastY = SCR_HEIGHT / 2.0f;
 bool firstMouse = true;
 
 // timing
-float deltaTime = 0.0f;
+float deltaTime = 0.0f; // wall-clock length of the last rendered frame, for presentation only
 float lastFrame = 0.0f;
 
-ModelAnim player1;
-Animation introAnimationP1;
-Animation idleAnimationP1;
-Animation walkFrontAnimationP1;
-Animation walkBackAnimationP1;
-Animation punchAnimationP1;
-Animation kickAnimationP1;
-Animation blockAnimationP1;
-Animation hitAnimationP1;
-Animation victoryAnimationP1;
-Animation defeatAnimationP1;
-
-ModelAnim player2;
-Animation introAnimationP2;
-Animation idleAnimationP2;
-Animation walkFrontAnimationP2;
-Animation walkBackAnimationP2;
-Animation punchAnimationP2;
-Animation kickAnimationP2;
-Animation blockAnimationP2;
-Animation hitAnimationP2;
-Animation victoryAnimationP2;
-Animation defeatAnimationP2;
-
-glm::vec3 player1Position = glm::vec3(0.0f, -0.4f, 0.0f);
-glm::vec3 player2Position = glm::vec3(0.0f, -0.4f, 3.0f);
+// gameplay advances in fixed 60 Hz ticks (simulateTick); rendering blends the last two
+SimulationClock simClock(60.0);
+
+// keys the simulation reads, sampled once per rendered frame and applied to every tick in it
+struct SimInput {
+	bool keys[GLFW_KEY_LAST + 1];
+
+	bool isDown(int key) const { return keys[key]; }
+};
+
+SimInput simInput = {};
+
+// both fighters come from definition files (Fighters/*.json, or --p1/--p2) and step through the
+// same FighterRuntime state machine
+Fighter fighterP1;
+Fighter fighterP2;
 
 glm::vec3 player1IntroPosition = glm::vec3(0.0f, -0.4f, -2.0f);
 glm::vec3 player2IntroPosition = glm::vec3(0.0f, -0.4f, 5.0f);
 glm::vec3 player1gamePosition = glm::vec3(0.0f, -0.4f, 0.0f);
 glm::vec3 player2gamePosition = glm::vec3(0.0f, -0.4f, 3.0f);
-float moveSpeed = 0.9f;
-float knockback = 1.0f;
-int P1punchDamage = 4;
-int P1kickDamage = 6;
-int P2punchDamage = 4;
-int P2kickDamage = 6;
-Animator player1_animator(&idleAnimationP1);
-Animator player2_animator(&idleAnimationP2);
-enum AnimStateP1 P1charState = P1_IDLE;
-enum AnimStateP2 P2charState = P2_IDLE;
-float blendAmountP1 = 0.0f;
-float blendAmountP2 = 0.0f;
-float blendRate = 0.055f;
+float knockback = 0.1f; // distance a strike pushes both fighters, times the clip's knockback for the defender
+float blendRate = 0.055f; // crossfade progress per simulation tick
 
 const float shakeDuration = 0.5f;
 const float shakeIntensity = 3.0f;
@@ -264,13 +216,6 @@ glm::vec3 lerpVec3(const glm::vec3& start, const glm::vec3& end, float t) {
 	return start + t * (end - start);
 }
 
-void setPauseTimer(float duration) {
-	// Convert duration from seconds to milliseconds
-	int milliseconds = static_cast<int>(duration * 1000);
-	// Pause the execution of the current thread (simulating a pause in game)
-	std::this_thread::sleep_for(std::chrono::milliseconds(milliseconds));
-}
-
 //call at the beginning of every round
 void restartRound() {
 
@@ -281,18 +226,18 @@ void restartRound() {
 	player1Stats.playerHealth = MAX_HEALTH;
 	player2Stats.playerHealth = MAX_HEALTH;
 
-	player2Position = player2gamePosition;
-	player1Position = player1gamePosition;
-	player1_animator.PlayAnimation(&idleAnimationP1, nullptr, 0.0f, 0.0f, 0.0f);
-	player2_animator.PlayAnimation(&idleAnimationP2, nullptr, 0.0f, 0.0f, 0.0f);
+	fighterP2.position = player2gamePosition;
+	fighterP1.position = player1gamePosition;
+	fighterP1.PlayRole(ROLE_IDLE);
+	fighterP2.PlayRole(ROLE_IDLE);
 
 }
 
 
-void updateIntroCamera(GLFWwindow* window, float deltaTime) {
+void updateIntroCamera(float deltaTime) {
 
-	float introDurationP1 = introAnimationP1.GetDuration() / 1000.0f; // Convert ms to seconds
-	float introDurationP2 = introAnimationP2.GetDuration() / 1000.0f; // Convert ms to seconds
+	float introDurationP1 = fighterP1.RoleClip(ROLE_INTRO).GetDuration() / 1000.0f; // Convert ms to seconds
+	float introDurationP2 = fighterP2.RoleClip(ROLE_INTRO).GetDuration() / 1000.0f; // Convert ms to seconds
 	static float transitionDuration = 1.0f; // Duration of the camera transition
 	static float transitionTimer = 0.0f; // Timer for the camera transition
 
@@ -307,7 +252,7 @@ void updateIntroCamera(GLFWwindow* window, float deltaTime) {
 		introTimer += deltaTime;
 
 		// Transition to INTRO_P1 state
-		if (introTimer >= 8.0f || glfwGetKey(window, GLFW_KEY_SPACE) == GLFW_PRESS) {
+		if (introTimer >= 8.0f || simInput.isDown(GLFW_KEY_SPACE)) {
 			currentState = INTRO_P1;
 			if (soundEngine->isCurrentlyPlaying(introP1Sound) == false)
 				soundEngine->play2D(introP1Sound, false);
@@ -315,8 +260,8 @@ void updateIntroCamera(GLFWwindow* window, float deltaTime) {
 				soundEngine->play2D(crowdSound, false);
 			introTimer = 0.0f;
 			transitionTimer = 0.0f;
-			player1_animator.PlayAnimation(&introAnimationP1, nullptr, 0.0f, 0.0f, 0.0f);
-			player2_animator.PlayAnimation(&idleAnimationP2, nullptr, 0.0f, 0.0f, 0.0f);
+			fighterP1.PlayRole(ROLE_INTRO);
+			fighterP2.PlayRole(ROLE_IDLE);
 
 		}
 
@@ -330,8 +275,8 @@ void updateIntroCamera(GLFWwindow* window, float deltaTime) {
 		camera.Position = introCamPos;
 		camera.updateCameraVectors();
 
-		player1Position = player1IntroPosition;
-		player2Position = player2IntroPosition;
+		fighterP1.position = player1IntroPosition;
+		fighterP2.position = player2IntroPosition;
 
 		if (transitionTimer < gameToPlayerDuration) {
 			// Perform the interpolation
@@ -351,7 +296,7 @@ void updateIntroCamera(GLFWwindow* window, float deltaTime) {
 		}
 
 
-		if (introTimer >= introDurationP1 || glfwGetKey(window, GLFW_KEY_SPACE) == GLFW_PRESS) {
+		if (introTimer >= introDurationP1 || simInput.isDown(GLFW_KEY_SPACE)) {
 			currentState = INTRO_P2;
 			soundEngine->stopAllSounds();
 			if (soundEngine->isCurrentlyPlaying(introP2Sound) == false)
@@ -360,8 +305,8 @@ void updateIntroCamera(GLFWwindow* window, float deltaTime) {
 				soundEngine->play2D(crowdSound, false);
 			introTimer = 0.0f;
 			transitionTimer = 0.0f; // Reset transition timer
-			player1_animator.PlayAnimation(&idleAnimationP1, nullptr, 0.0f, 0.0f, 0.0f);
-			player2_animator.PlayAnimation(&introAnimationP2, nullptr, 0.0f, 0.0f, 0.0f);
+			fighterP1.PlayRole(ROLE_IDLE);
+			fighterP2.PlayRole(ROLE_INTRO);
 		}
 
 	}
@@ -384,16 +329,16 @@ void updateIntroCamera(GLFWwindow* window, float deltaTime) {
 			camera.updateCameraVectors();
 		}
 
-		if (introTimer >= introDurationP2 || glfwGetKey(window, GLFW_KEY_SPACE) == GLFW_PRESS) {
+		if (introTimer >= introDurationP2 || simInput.isDown(GLFW_KEY_SPACE)) {
 			currentState = TRANSITION_TO_GAMEPLAY;
 			soundEngine->stopAllSounds();
 			introTimer = 0.0f;
 			transitionTimer = 0.0f; // Reset transition timer
 
-			player2Position = player2gamePosition; // Reset to game position
-			player1Position = player1gamePosition;
-			player1_animator.PlayAnimation(&idleAnimationP1, nullptr, 0.0f, 0.0f, 0.0f);
-			player2_animator.PlayAnimation(&idleAnimationP2, nullptr, 0.0f, 0.0f, 0.0f);
+			fighterP2.position = player2gamePosition; // Reset to game position
+			fighterP1.position = player1gamePosition;
+			fighterP1.PlayRole(ROLE_IDLE);
+			fighterP2.PlayRole(ROLE_IDLE);
 
 		}
 
@@ -432,7 +377,7 @@ void updateIntroCamera(GLFWwindow* window, float deltaTime) {
 }
 
 
-void updateEndCamera(GLFWwindow* window, float deltaTime) {
+void updateEndCamera(float deltaTime) {
 
 	static float elapsedTime = 0.0f;
 
@@ -471,6 +416,14 @@ void updateEndCamera(GLFWwindow* window, float deltaTime) {
 
 }
 
+// a fighter's definition name the way the intro shows it, in capitals
+std::string introName(const Fighter& fighter) {
+	std::string name = fighter.definition.name;
+	for (char& c : name)
+		c = static_cast<char>(std::toupper(static_cast<unsigned char>(c)));
+	return name;
+}
+
 void updateText(Shader& textShader, float deltaTime) {
 
 	static float elapsedTime = 0.0f; // Track elapsed time for animations
@@ -510,7 +463,8 @@ void updateText(Shader& textShader, float deltaTime) {
 
 		player1X = glm::min(player1X + speed * deltaTime, targetX); // Slide in
 
-		RenderText(textShader, "BIG VEGAS", player1X, SCR_HEIGHT - 150, 1.0f, yellowColor);
+		static const std::string player1Name = introName(fighterP1);
+		RenderText(textShader, player1Name, player1X, SCR_HEIGHT - 150, 1.0f, yellowColor);
 
 	}
 	else if (currentState == INTRO_P2) {
@@ -525,7 +479,8 @@ void updateText(Shader& textShader, float deltaTime) {
 
 		player2X = glm::max(player2X - speed * deltaTime, targetX);
 
-		RenderText(textShader, "EL CHUPACABRA", player2X, SCR_HEIGHT - 150, 1.0f, purpleColor);
+		static const std::string player2Name = introName(fighterP2);
+		RenderText(textShader, player2Name, player2X, SCR_HEIGHT - 150, 1.0f, purpleColor);
 
 	}
 
@@ -564,9 +519,9 @@ void updateText(Shader& textShader, float deltaTime) {
 }
 
 
-void startCountdown() {
+void startCountdown(float deltaTime) {
 
-	countdownTimer.update();
+	countdownTimer.update(deltaTime);
 
 	if (countdownTimer.getRemainingTime() <= 0.0f) {
 		gameStart = true;
@@ -575,13 +530,9 @@ void startCountdown() {
 		timer.resetToDefault(ROUND_DURATION);
 		timer.start();
 
-		// Ensure both players are set to idle at the start of gameplay
-		P1charState = P1_IDLE;
-		P2charState = P2_IDLE;
-
-		// Start idle animations for both players
-		player1_animator.PlayAnimation(&idleAnimationP1, nullptr, 0.0f, 0.0f, 0.0f);
-		player2_animator.PlayAnimation(&idleAnimationP2, nullptr, 0.0f, 0.0f, 0.0f);
+		// Ensure both players start gameplay idle, playing their idle animations
+		FighterRuntime::Reset(fighterP1);
+		FighterRuntime::Reset(fighterP2);
 
 		// Reset camera position if necessary
 		camera.Position = gameCamPos; // Example camera position
@@ -594,21 +545,21 @@ void startCountdown() {
 void checkEndofGame() {
 
 	if (player1Stats.playerScore == 3) {
-		player1_animator.PlayAnimation(&victoryAnimationP1, nullptr, 0.0f, 0.0f, 0.0f);
-		player2_animator.PlayAnimation(&defeatAnimationP2, nullptr, 0.0f, 0.0f, 0.0f);
+		fighterP1.PlayRole(ROLE_VICTORY);
+		fighterP2.PlayRole(ROLE_DEFEAT);
 		currentState = P1_WINS;
 	}
 	else if (player2Stats.playerScore == 3) {
-		player1_animator.PlayAnimation(&defeatAnimationP1, nullptr, 0.0f, 0.0f, 0.0f);
-		player2_animator.PlayAnimation(&victoryAnimationP2, nullptr, 0.0f, 0.0f, 0.0f);
+		fighterP1.PlayRole(ROLE_DEFEAT);
+		fighterP2.PlayRole(ROLE_VICTORY);
 		currentState = P2_WINS;
 	}
 
 }
 
-void updateGameplay() {
+void updateGameplay(float deltaTime) {
 
-	timer.update();
+	timer.update(deltaTime);
 
 	if (player1Stats.playerHealth <= 0.0f) {
 		std::cout << "Player 2 wins this round!" << std::endl;
@@ -631,15 +582,16 @@ void updateGameplay() {
 
 
 
+// hitbox offsets come from each fighter's definition
+void updateCapsule(Capsule& capsule, const Fighter& fighter) {
+	capsule.pointA = fighter.position + glm::vec3(0.0f, fighter.definition.hitboxTop, 0.0f);
+	capsule.pointB = fighter.position + glm::vec3(0.0f, fighter.definition.hitboxBottom, 0.0f);
+	capsule.radius = fighter.definition.hitboxRadius;
+}
+
 void updateCapsules() {
-	// Adjust these values based on the character's current pose and animation
-	player1Capsule.pointA = player1Position + glm::vec3(0.0f, 1.2f, 0.0f); // example values
-	player1Capsule.pointB = player1Position + glm::vec3(0.0f, 0.4f, 0.0f);
-	player1Capsule.radius = 0.5f;
-
-	player2Capsule.pointA = player2Position + glm::vec3(0.0f, 1.2f, 0.0f);
-	player2Capsule.pointB = player2Position + glm::vec3(0.0f, 0.4f, 0.0f);
-	player2Capsule.radius = 0.5f;
+	updateCapsule(player1Capsule, fighterP1);
+	updateCapsule(player2Capsule, fighterP2);
 }
 
 float segmentSegmentDistance(const glm::vec3& p1, const glm::vec3& p2, const glm::vec3& q1, const glm::vec3& q2) {
@@ -718,140 +670,70 @@ bool checkCapsuleCollision(const Capsule& capsule1, const Capsule& capsule2) {
 
 
 
-void handleCollisions(GLFWwindow* window, float deltaTime) {
+void handleCollisions() {
 	if (checkCapsuleCollision(player1Capsule, player2Capsule)) {
-		glm::vec3 collisionNormal = glm::normalize(player2Position - player1Position);
+		glm::vec3 collisionNormal = glm::normalize(fighterP2.position - fighterP1.position);
 		float overlap = (player1Capsule.radius + player2Capsule.radius) - glm::distance(player1Capsule.pointB, player2Capsule.pointB);
 		float pushFactor = 0.1f;
 
 		// Push both players away from each other
-		player1Position -= collisionNormal * (overlap * pushFactor) * 0.5f;
-		player2Position += collisionNormal * (overlap * pushFactor) * 0.5f;
-
-		// Handling for Player 1 attacking
-		if (P1charState == P1_PUNCH_IDLE || P1charState == P1_KICK_IDLE) {
-			float animationTime = player1_animator.getCurrentAnimationTime(); // Get the current animation time
-			bool isP1Kicked = false;
-			int damage = 0;
-			if (P1charState == P1_PUNCH_IDLE) {
-				damage = punchAnimationP1.getDamageForTime(animationTime); // Check for damage at the current animation time
-			}
-			else if (P1charState == P1_KICK_IDLE) {
-				damage = kickAnimationP1.getDamageForTime(animationTime);
-				isP1Kicked = true;
-			}
-
-			if (damage > 0) { // Damage is applied only if the current frame is a damage keyframe
-				// Check if Player 2 is currently blocking
-				if (glfwGetKey(window, GLFW_KEY_DOWN) == GLFW_PRESS) {
-					std::cout << "Player 2 blocked the attack!" << std::endl;
-					//player2_animator.PlayAnimation(&idleAnimationP2, &blockAnimationP2, animator.m_CurrentTime, 0.0f, blendAmount);
-					P2charState = P2_IDLE_BLOCK;
-					//player1Position.z += knockback * deltaTime;
-					player2Position.z += knockback * deltaTime;
-					player1Position.z += knockback * deltaTime;
-					//player1_animator.pauseAtCurrentTime();
-					//player1_animator.pauseAtCurrentTime();
-					
-				}
-				else {
-					// Apply damage to Player 2 if not blocking
-					player2Stats.playerHealth -= damage;
-					std::cout << "Player 2 hit! Health now: " <<  player2Stats.playerHealth << std::endl;
-					P2charState = P2_IDLE_HIT; // Update the state to reflect being hit
-					if (player2Stats.playerHealth <= 0) {
-						std::cout << "Player 2 has been defeated!" << std::endl;
-					}
-					//player1Position.z += knockback * deltaTime;
-					if (isP1Kicked) {
-						// Apply additional knockback and trigger fall animation for kicks
-						player2Position.z += knockback * 5 * deltaTime; // Double knockback for kicks
-						player1Position.z += knockback * deltaTime;
-						
-					}
-					else
-					{
-						//soundEngine->play2D(punchSound, false);
-						player2Position.z += knockback * deltaTime;
-						player1Position.z += knockback * deltaTime;
-					}
-					
-					
-					//player1_animator.pauseAtCurrentTime();
-					//player1_animator.pauseAtCurrentTime();
-					player2Stats.shakeTimer = shakeDuration;
-				}
+		fighterP1.position -= collisionNormal * (overlap * pushFactor) * 0.5f;
+		fighterP2.position += collisionNormal * (overlap * pushFactor) * 0.5f;
+	}
+}
 
+// A strike event on the attacker's clips, reported once as the clip crosses it. The strike only
+// connects if the capsules touch at that moment; a defender holding block turns it into a blocked
+// hit. Damage comes from the event, knockback, hit-stop and impact sound from the attacking clip's
+// definition. Both fighters are pushed along the attacker's facing, so the attacker follows through.
+void resolveStrike(Fighter& attacker, Fighter& defender, PlayerStats& defenderStats, const char* defenderName,
+	const Animation& clip, const AnimationEvent& event) {
+	if (event.type != AnimationEventType::Strike || currentState != GAMEPLAY)
+		return;
+	updateCapsules();
+	if (!checkCapsuleCollision(player1Capsule, player2Capsule))
+		return;
 
-				if (soundEngine->isCurrentlyPlaying(P1swishSound) == false)
-				{
-					soundEngine->play2D(P1swishSound, false);
-				}
+	const FighterClip& attack = attacker.definition.clips[attacker.ClipIndex(clip)];
+	float push = attacker.facing * knockback;
 
-			}
+	if (simInput.isDown(defender.keys[INPUT_BLOCK])) {
+		std::cout << defenderName << " blocked the attack!" << std::endl;
+		FighterRuntime::EnterState(defender, defender.definition.blockState);
+		defender.position.z += push;
+		attacker.position.z += push;
+		simClock.HitStop(BLOCK_HIT_STOP);
+	}
+	else {
+		defenderStats.playerHealth -= event.value;
+		std::cout << defenderName << " hit! Health now: " << defenderStats.playerHealth << std::endl;
+		FighterRuntime::EnterState(defender, defender.definition.hitState);
+		if (defenderStats.playerHealth <= 0) {
+			std::cout << defenderName << " has been defeated!" << std::endl;
 		}
-
-		// Handling for Player 2 attacking
-		if (P2charState == P2_PUNCH_IDLE || P2charState == P2_KICK_IDLE) {
-			float animationTime = player2_animator.getCurrentAnimationTime(); // Get the current animation time
-			int damage = 0;
-			bool isP2Kicked = false;
-			if (P2charState == P2_PUNCH_IDLE) {
-				damage = punchAnimationP2.getDamageForTime(animationTime); // Check for damage at the current animation time
-			}
-			else if (P2charState == P2_KICK_IDLE) {
-				damage = kickAnimationP2.getDamageForTime(animationTime);	
-			}
-
-			if (damage > 0) { // Damage is applied only if the current frame is a damage keyframe
-				// Check if Player 1 is currently blocking
-				if (glfwGetKey(window, GLFW_KEY_S) == GLFW_PRESS) {
-					std::cout << "Player 1 blocked the attack!" << std::endl;
-					//player2_animator.PlayAnimation(&idleAnimationP2, &blockAnimationP2, animator.m_CurrentTime, 0.0f, blendAmount);
-					P1charState = P1_IDLE_BLOCK;
-					//player1Position.z += knockback * deltaTime;
-					player1Position.z += knockback * deltaTime;
-					player2Position.z += knockback * deltaTime;
-					//player1_animator.pauseAtCurrentTime();
-					//player1_animator.pauseAtCurrentTime();
-
-				}
-				else {
-					// Apply damage to Player 2 if not blocking
-					player1Stats.playerHealth -= damage;
-					std::cout << "Player 1 hit! Health now: " << player1Stats.playerHealth << std::endl;
-					P1charState = P1_IDLE_HIT; // Update the state to reflect being hit
-					if (player1Stats.playerHealth <= 0) {
-						std::cout << "Player 1 has been defeated!" << std::endl;
-					}
-					//player1Position.z += knockback * deltaTime;
-					if (isP2Kicked) {
-						// Apply additional knockback and trigger fall animation for kicks
-						player1Position.z += knockback * 5 * deltaTime; // Double knockback for kicks
-						player2Position.z += knockback * deltaTime;
-						soundEngine->play2D(kickSound, false);
-					}
-					else
-					{
-						//soundEngine->play2D(punchSound, false);
-						player1Position.z += knockback * deltaTime;
-						player2Position.z += knockback * deltaTime;
-					}
-					//player1_animator.pauseAtCurrentTime();
-					//player1_animator.pauseAtCurrentTime();
-					player1Stats.shakeTimer = shakeDuration;
-				}
-
-				if (soundEngine->isCurrentlyPlaying(P2swishSound) == false)
-				{
-					soundEngine->play2D(P2swishSound, false);
-				}
-
-			}
+		defender.position.z += push * attack.knockback;
+		attacker.position.z += push;
+		if (!attack.impactSound.empty()) {
+			ISoundSource* impactSound = soundEngine->getSoundSource(attack.impactSound.c_str());
+			if (impactSound && soundEngine->isCurrentlyPlaying(impactSound) == false)
+				soundEngine->play2D(impactSound, false);
 		}
+		if (attack.hitStop > 0.0f)
+			simClock.HitStop(attack.hitStop);
+		defenderStats.shakeTimer = shakeDuration;
 	}
 }
 
+// a Sound event on a fighter's clips, played from that player's own source for the cue so
+// both fighters can swish at once
+void playSoundCue(ISoundSource* swishSound, const AnimationEvent& event) {
+	if (event.type != AnimationEventType::Sound || currentState != GAMEPLAY)
+		return;
+	ISoundSource* source = event.value == CUE_SWISH ? swishSound : nullptr;
+	if (source && soundEngine->isCurrentlyPlaying(source) == false)
+		soundEngine->play2D(source, false);
+}
+
 void RenderHealthBars(Shader& shader, unsigned int texture, unsigned int borderTexture) {
 
 
@@ -964,8 +846,770 @@ void RenderScoreStatus(Shader& shader, unsigned int emptyCircle, unsigned int fi
 }
 
 
-int main()
+// the state the renderer draws, captured around each tick so frames between ticks can blend it
+struct RenderState {
+	glm::vec3 player1Position;
+	glm::vec3 player2Position;
+	glm::vec3 cameraPosition;
+	float cameraYaw;
+	float cameraPitch;
+};
+
+RenderState captureRenderState() {
+	RenderState state = { fighterP1.position, fighterP2.position, camera.Position, camera.Yaw, camera.Pitch };
+	return state;
+}
+
+RenderState lerpRenderState(const RenderState& previous, const RenderState& current, float t) {
+	RenderState state;
+	state.player1Position = lerpVec3(previous.player1Position, current.player1Position, t);
+	state.player2Position = lerpVec3(previous.player2Position, current.player2Position, t);
+	state.cameraPosition = lerpVec3(previous.cameraPosition, current.cameraPosition, t);
+	state.cameraYaw = lerp(previous.cameraYaw, current.cameraYaw, t);
+	state.cameraPitch = lerp(previous.cameraPitch, current.cameraPitch, t);
+	return state;
+}
+
+// the camera a frame draws with, at the blended render state
+Camera makeRenderCamera(const RenderState& state) {
+	Camera renderCamera = camera;
+	renderCamera.Position = state.cameraPosition;
+	renderCamera.Yaw = state.cameraYaw;
+	renderCamera.Pitch = state.cameraPitch;
+	renderCamera.updateCameraVectors();
+	return renderCamera;
+}
+
+// projection the animation LOD measures on-screen size with
+glm::mat4 lodProjection(const Camera& renderCamera) {
+	return glm::perspective(glm::radians(renderCamera.Zoom), (float)SCR_WIDTH / (float)SCR_HEIGHT, 0.1f, 100.0f);
+}
+
+SimInput sampleInput(GLFWwindow* window) {
+	// every key the state machines, collisions and intro skips read
+	static const int simKeys[] = {
+		GLFW_KEY_SPACE,
+		GLFW_KEY_A, GLFW_KEY_D, GLFW_KEY_S, GLFW_KEY_V, GLFW_KEY_B,
+		GLFW_KEY_LEFT, GLFW_KEY_RIGHT, GLFW_KEY_DOWN, GLFW_KEY_KP_1, GLFW_KEY_KP_2
+	};
+	SimInput input = {};
+	for (int key : simKeys)
+		input.keys[key] = glfwGetKey(window, key) == GLFW_PRESS;
+	return input;
+}
+
+// steps a fighter's move state machine with the inputs its slot has held this tick
+void tickFighter(Fighter& fighter, float dt) {
+	bool held[INPUT_COUNT];
+	for (int input = 0; input < INPUT_COUNT; input++)
+		held[input] = simInput.isDown(fighter.keys[input]);
+	FighterRuntime::Tick(fighter, held, blendRate, dt);
+}
+
+// One fixed simulation tick. Movement, knockback, crossfades, damage windows and round timers
+// all advance here by the constant step, never by the frame time, so a match plays out the
+// same for the same input at any frame rate.
+void simulateTick(float dt) {
+
+	// hit-stop: gameplay holds for the tick. Advancing the animators by zero keeps their pose
+	// from being interpolated across the pause.
+	if (simClock.ConsumeFrozenTick()) {
+		float animationDt = simClock.IsFreezingAnimators() ? 0.0f : dt;
+		fighterP1.animator.Advance(animationDt);
+		fighterP2.animator.Advance(animationDt);
+		return;
+	}
+
+	fighterP1.animator.Advance(dt);
+	fighterP2.animator.Advance(dt);
+
+	switch (currentState) {
+	case GAME_INTRO:
+	case INTRO_P1:
+
+	case INTRO_P2:
+
+	case TRANSITION_TO_GAMEPLAY:
+		updateIntroCamera(dt);
+		break;
+	case START_ROUND:
+		startCountdown(dt);
+		if (soundEngine->isCurrentlyPlaying(BGM) == false)
+			soundEngine->play2D(BGM, true);
+		break;
+	case GAMEPLAY:
+		// Gameplay logic
+		updateCapsules();
+		handleCollisions();
+		tickFighter(fighterP1, dt);
+		tickFighter(fighterP2, dt);
+		updateGameplay(dt);
+
+		break;
+
+	case P1_WINS:
+	case P2_WINS:
+		updateEndCamera(dt);
+		break;
+	}
+}
+
+// --sim-check input for one simulation tick: both players walk in, trade punches and kicks and
+// block on a 240-tick (four second) cycle, which covers movement, knockback, hits, blocks and
+// round ends. It is keyed by tick index, like a recorded input stream, so every frame timing
+// feeds each tick the same keys.
+SimInput scriptedInput(long long tick) {
+	SimInput input = {};
+	int phase = static_cast<int>(tick % 240);
+	input.keys[GLFW_KEY_D] = phase < 90;
+	input.keys[GLFW_KEY_V] = phase >= 100 && phase < 104;
+	input.keys[GLFW_KEY_B] = phase >= 160 && phase < 164;
+	input.keys[GLFW_KEY_S] = phase >= 200 && phase < 230;
+	input.keys[GLFW_KEY_LEFT] = phase >= 20 && phase < 100;
+	input.keys[GLFW_KEY_DOWN] = phase >= 100 && phase < 130;
+	input.keys[GLFW_KEY_KP_1] = phase >= 130 && phase < 134;
+	input.keys[GLFW_KEY_KP_2] = phase >= 180 && phase < 184;
+	return input;
+}
+
+// back to the countdown of round one with nothing scored
+void resetMatch() {
+	currentRound = 0;
+	player1Stats.playerScore = 0;
+	player2Stats.playerScore = 0;
+	player1Stats.shakeTimer = 0.0f;
+	player2Stats.shakeTimer = 0.0f;
+	FighterRuntime::Reset(fighterP1);
+	FighterRuntime::Reset(fighterP2);
+	gameStart = false;
+	timer.resetToDefault(ROUND_DURATION);
+	restartRound();
+}
+
+// FNV-1a over everything the simulation owns, so two runs compare bit for bit
+uint64_t hashSimulationState() {
+	uint64_t hash = 14695981039346656037ull;
+	auto mix = [&hash](const void* data, size_t size) {
+		const unsigned char* bytes = static_cast<const unsigned char*>(data);
+		for (size_t i = 0; i < size; i++)
+			hash = (hash ^ bytes[i]) * 1099511628211ull;
+	};
+
+	int states[] = { currentState, currentRound, fighterP1.state, fighterP2.state, player1Stats.playerScore, player2Stats.playerScore,
+		static_cast<int>(simClock.GetFrozenTickCount()) };
+	float values[] = {
+		fighterP1.position.x, fighterP1.position.y, fighterP1.position.z,
+		fighterP2.position.x, fighterP2.position.y, fighterP2.position.z,
+		player1Stats.playerHealth, player2Stats.playerHealth,
+		fighterP1.blendAmount, fighterP2.blendAmount,
+		timer.getRemainingTime(), countdownTimer.getRemainingTime(),
+		fighterP1.animator.m_CurrentTime, fighterP1.animator.m_CurrentTime2, fighterP1.animator.m_AnimationTimer,
+		fighterP2.animator.m_CurrentTime, fighterP2.animator.m_CurrentTime2, fighterP2.animator.m_AnimationTimer
+	};
+	mix(states, sizeof(states));
+	mix(values, sizeof(values));
+	return hash;
+}
+
+// frame times for one --sim-check run: a steady rate, each frame off by up to +-jitter of its
+// length, and a stall of stallSeconds every stallEvery frames
+struct FrameTiming {
+	const char* name;
+	double frameRate;
+	double jitter;
+	int stallEvery;         // 0: never stalls
+	double stallSeconds;
+};
+
+// Plays the scripted match through the render loop's own frame steps, minus the GL calls:
+// SimulationClock::Advance gets the frame's time, a render state is captured before every tick
+// and the poses are evaluated once per frame. The runs use steady 30, 144 and 500 FPS, 60 FPS
+// with jitter, and 144 FPS with stalls long enough to run into the clock's per-frame tick cap.
+// Every run simulates the same number of ticks with the same input per tick, so the fixed step
+// must bring them all to the same state, bit for bit, whatever the frame timing. Each run is
+// also replayed one tick at a time with no frames around it, which has to match too. The
+// stalling run has to reach the cap, and no frame, hit-stops included, may take longer than a
+// 30 FPS frame. That budget covers only the CPU side timed here (ticks and pose evaluation);
+// drawing, palette upload and buffer swaps aren't in it, and the output says so. Returns false
+// if a check fails.
+bool runSimulationCheck(long long ticks, AnimationSystem& poses) {
+	const FrameTiming timings[] = {
+		{ "30 FPS", 30.0, 0.0, 0, 0.0 },
+		{ "144 FPS", 144.0, 0.0, 0, 0.0 },
+		{ "500 FPS", 500.0, 0.0, 0, 0.0 },
+		{ "60 FPS +-40% jitter", 60.0, 0.4, 0, 0.0 },
+		{ "144 FPS, 250 ms stall every 300 frames", 144.0, 0.1, 300, 0.25 }
+	};
+	const double frameBudget = 1.0 / 30.0;
+	bool deterministic = true;
+	bool capReached = true;
+	bool bounded = true;
+	uint64_t reference = 0;
+
+	for (const FrameTiming& timing : timings) {
+		resetMatch();
+		simClock.Reset();
+		std::vector<SimInput> tickInputs;
+		tickInputs.reserve(static_cast<size_t>(ticks) + simClock.GetMaxTicksPerFrame());
+		uint32_t seed = 12345u;
+		double longestFrame = 0.0;
+		long long frames = 0;
+		long long cappedFrames = 0;
+		RenderState previousRenderState = captureRenderState();
+
+		while (static_cast<long long>(tickInputs.size()) < ticks) {
+			// what glfwGetTime would have measured for this frame
+			seed = seed * 1664525u + 1013904223u;
+			double noise = (seed >> 8) / 16777216.0 * 2.0 - 1.0;
+			double frameSeconds = (1.0 + timing.jitter * noise) / timing.frameRate;
+			if (timing.stallEvery > 0 && frames % timing.stallEvery == timing.stallEvery - 1)
+				frameSeconds = timing.stallSeconds;
+			deltaTime = static_cast<float>(frameSeconds);
+			frames++;
+
+			auto frameStart = std::chrono::high_resolution_clock::now();
+			int due = simClock.Advance(deltaTime);
+			if (due == simClock.GetMaxTicksPerFrame())
+				cappedFrames++;
+			// every run stops on the same tick, even when its last frame owes more
+			for (int tick = 0; tick < due && static_cast<long long>(tickInputs.size()) < ticks; tick++) {
+				previousRenderState = captureRenderState();
+				simInput = scriptedInput(static_cast<long long>(tickInputs.size()));
+				tickInputs.push_back(simInput);
+				simulateTick(simClock.GetStep());
+			}
+			float alpha = simClock.GetAlpha();
+			Camera renderCamera = makeRenderCamera(lerpRenderState(previousRenderState, captureRenderState(), alpha));
+			poses.SelectLods(renderCamera.GetViewMatrix(), lodProjection(renderCamera));
+			poses.EvaluatePoses(alpha);
+			std::chrono::duration<double> frameTime = std::chrono::high_resolution_clock::now() - frameStart;
+			longestFrame = std::max(longestFrame, frameTime.count());
+		}
+		uint64_t played = hashSimulationState();
+		int round = currentRound;
+		int healthP1 = player1Stats.playerHealth, healthP2 = player2Stats.playerHealth;
+		int scoreP1 = player1Stats.playerScore, scoreP2 = player2Stats.playerScore;
+		long long hitStops = simClock.GetHitStopCount();
+		long long frozenTicks = simClock.GetFrozenTickCount();
+
+		// the same ticks again with nothing between them, not even a pose evaluation
+		resetMatch();
+		simClock.Reset();
+		deltaTime = simClock.GetStep();
+		for (const SimInput& input : tickInputs) {
+			simInput = input;
+			simulateTick(simClock.GetStep());
+		}
+		uint64_t replayed = hashSimulationState();
+
+		std::cout << "Simulation at " << timing.name << ": " << frames << " frames (" << cappedFrames << " at the "
+			<< simClock.GetMaxTicksPerFrame() << "-tick cap), " << tickInputs.size() << " ticks, state " << std::hex << played
+			<< ", replayed " << replayed << std::dec << ", round " << round << ", health " << healthP1 << "/" << healthP2
+			<< ", score " << scoreP1 << "-" << scoreP2 << ", " << hitStops << " hit-stops (" << frozenTicks << " frozen ticks)"
+			<< ", longest frame " << longestFrame * 1000.0 << " ms (headless)" << std::endl;
+		if (played != replayed) {
+			std::cout << "Simulation check FAILED: at " << timing.name << " the state depends on how the ticks fell into frames" << std::endl;
+			deterministic = false;
+		}
+		if (&timing == &timings[0])
+			reference = played;
+		else if (played != reference) {
+			std::cout << "Simulation check FAILED: the same ticks end in another state at " << timing.name << " than at "
+				<< timings[0].name << std::endl;
+			deterministic = false;
+		}
+		if (timing.stallEvery > 0 && cappedFrames == 0) {
+			std::cout << "Simulation check FAILED: the stalls at " << timing.name << " never reached the tick cap" << std::endl;
+			capReached = false;
+		}
+		if (longestFrame > frameBudget) {
+			std::cout << "Simulation check FAILED: a headless frame at " << timing.name << " took longer than " << frameBudget * 1000.0 << " ms" << std::endl;
+			bounded = false;
+		}
+	}
+
+	if (deterministic && capReached && bounded)
+		std::cout << "Simulation check passed: every frame timing reaches the same state and replays tick for tick, and no headless frame went over "
+			<< frameBudget * 1000.0 << " ms, hit-stops included" << std::endl;
+	// what the budget above leaves out
+	std::cout << "Frame times are headless: simulation ticks and pose evaluation only, without drawing, palette upload or "
+		"buffer swaps, so they bound what hit-stops cost the CPU side of a frame, not the full frame" << std::endl;
+	simInput = SimInput();
+	simClock.Reset();
+	deltaTime = 0.0f;
+	return deterministic && capReached && bounded;
+}
+
+// --key-check: every track of both fighters' clips, looked up through the cursor-cached key
+// search and through a plain linear search, must land on the same key. Times follow playback at
+// 60 and 500 Hz over two and a half loops (so every wrap-around is in there), then random seeks
+// that include times before the first key and past the last. A Sample through the caller's
+// cursors, as the animators take it, must also equal a one-off binary-search Sample. Runs on
+// the raw keys, so before FinishLoading compresses them. Returns false on any mismatch.
+bool runKeyLookupCheck() {
+	long long lookups = 0;
+	long long mismatches = 0;
+	auto linearKey = [](const float* times, int numKeys, float time) {
+		int index = 0;
+		while (index < numKeys - 2 && time >= times[index + 1])
+			index++;
+		return index;
+	};
+	auto checkTrack = [&](const float* times, int numKeys, const std::vector<float>& sequence) {
+		if (numKeys < 2)
+			return;
+		int cursor = 0;
+		for (float time : sequence) {
+			lookups++;
+			if (Bone::FindKeyIndex(times, numKeys, time, cursor) != linearKey(times, numKeys, time))
+				mismatches++;
+		}
+	};
+
+	int clips = 0;
+	for (Fighter* fighter : { &fighterP1, &fighterP2 }) {
+		for (Animation& clip : fighter->clips) {
+			float duration = clip.GetDuration();
+			std::vector<float> sequence;
+			for (float rate : { 60.0f, 500.0f }) {
+				float step = clip.GetTicksPerSecond() / rate;
+				int steps = (int)(2.5f * duration / step);
+				for (int i = 0; i < steps; i++)
+					sequence.push_back(std::fmod(i * step, duration));
+			}
+			uint32_t seed = 12345u;
+			for (int i = 0; i < 1000; i++) {
+				seed = seed * 1664525u + 1013904223u;
+				sequence.push_back(((seed >> 8) / 16777216.0f * 1.2f - 0.1f) * duration);
+			}
+
+			for (int channel = 0; channel < clip.GetChannelCount(); channel++) {
+				Bone& bone = *clip.GetBone(channel);
+				checkTrack(bone.m_PositionTimes, bone.GetNumPositionKeys(), sequence);
+				checkTrack(bone.m_RotationTimes, bone.GetNumRotationKeys(), sequence);
+				checkTrack(bone.m_ScaleTimes, bone.GetNumScalingKeys(), sequence);
+				KeyCursors cursors;
+				for (float time : sequence) {
+					BonePose stepped, sampled;
+					bone.Sample(time, stepped, cursors);
+					bone.Sample(time, sampled);
+					if (stepped.translation != sampled.translation || stepped.rotation != sampled.rotation || stepped.scale != sampled.scale)
+						mismatches++;
+				}
+			}
+			clips++;
+		}
+	}
+
+	if (mismatches == 0)
+		std::cout << "Key check passed: " << lookups << " lookups over " << clips << " clips match a linear search" << std::endl;
+	else
+		std::cout << "Key check FAILED: " << mismatches << " mismatches in " << lookups << " lookups over " << clips << " clips" << std::endl;
+	return mismatches == 0;
+}
+
+// --alloc-check: steady-state animation on both fighters must not touch the heap, in any build
+// (NoAllocationScope only asserts where asserts are compiled in). Every clip plays alone and
+// crossfading into the next, at full detail and at an update interval with reduced bones. After
+// one frame that may size scratch, each frame's UpdateAnimation and an in-between EvaluatePose
+// are counted through AllocationCounter. Returns false if any of them allocated.
+bool runAllocationCheck(int frames) {
+	long long allocations = 0;
+	int runs = 0;
+	for (Fighter* fighter : { &fighterP1, &fighterP2 }) {
+		Animator& animator = fighter->animator;
+		std::vector<Animation>& clips = fighter->clips;
+		for (size_t i = 0; i < clips.size(); i++) {
+			Animation* next = &clips[(i + 1) % clips.size()];
+			for (Animation* blendTarget : { (Animation*)nullptr, next }) {
+				for (int lodInterval : { 1, 3 }) {
+					animator.PlayAnimation(&clips[i], blendTarget, 0.0f, 0.0f, blendTarget ? 0.5f : 0.0f);
+					animator.SetLod(lodInterval, lodInterval > 1);
+					animator.UpdateAnimation(1.0f / 60.0f);
+					long long start = AllocationCounter::GetThreadCount();
+					for (int frame = 0; frame < frames; frame++) {
+						animator.UpdateAnimation(1.0f / 60.0f);
+						animator.EvaluatePose(0.5f);
+					}
+					long long allocated = AllocationCounter::GetThreadCount() - start;
+					if (allocated != 0)
+						std::cout << "Allocation check: " << fighter->definition.name << " clip " << i << (blendTarget ? " crossfading" : "")
+							<< " at interval " << lodInterval << " made " << allocated << " allocations" << std::endl;
+					allocations += allocated;
+					runs++;
+				}
+			}
+		}
+		animator.SetLod(1, false);
+	}
+
+	if (allocations == 0)
+		std::cout << "Allocation check passed: " << runs << " runs of " << frames << " frames made no heap allocations" << std::endl;
+	else
+		std::cout << "Allocation check FAILED: " << allocations << " heap allocations over " << runs << " runs of " << frames << " frames" << std::endl;
+	return allocations == 0;
+}
+
+// --pose-bench: the per-node transform math of a pose update on each fighter's clips, the
+// original glm::mat4 path (translate * rotate * scale per channel, 4x4 concatenation, 4x4 bone
+// offset) against the 3x4 affine path the animator runs now. Both start from the same sampled
+// local poses and walk the same flattened skeleton, so only the math differs; the two palettes
+// are compared so a faster path can't be a wrong one.
+void runPoseMathBenchmark(int frames) {
+	static ProfileSection s_Mat4("Pose math: glm::mat4 (original)", "node");
+	static ProfileSection s_Affine("Pose math: 3x4 affine", "node");
+	float maxDifference = 0.0f;
+
+	for (Fighter* fighter : { &fighterP1, &fighterP2 }) {
+		std::vector<Animation>& clips = fighter->clips;
+		const Skeleton& skeleton = clips[0].GetSkeleton();
+		const int nodeCount = skeleton.GetNodeCount();
+		const int* parents = skeleton.GetParents();
+		const int* boneIds = skeleton.GetBoneIds();
+		const AffineTransform* bindTransforms = skeleton.GetBindTransforms();
+		const std::vector<AffineTransform>& offsets = clips[0].GetBoneOffsets();
+
+		// the original path kept every transform as a mat4
+		std::vector<glm::mat4> bindMatrices(nodeCount), offsetMatrices(offsets.size());
+		for (int node = 0; node < nodeCount; node++)
+			PoseMath::ToMat4(bindTransforms[node], bindMatrices[node]);
+		for (size_t bone = 0; bone < offsets.size(); bone++)
+			PoseMath::ToMat4(offsets[bone], offsetMatrices[bone]);
+
+		std::vector<BonePose> poses(nodeCount);
+		std::vector<unsigned char> driven(nodeCount);
+		std::vector<glm::mat4> globalMatrices(nodeCount);
+		std::vector<AffineTransform> globals(nodeCount);
+		std::vector<glm::mat4> paletteMat4(offsets.size(), glm::mat4(1.0f));
+		std::vector<glm::mat4> paletteAffine(offsets.size(), glm::mat4(1.0f));
+
+		for (int frame = 0; frame < frames; frame++) {
+			Animation& clip = clips[frame % clips.size()];
+			float time = std::fmod(frame * clip.GetTicksPerSecond() / 60.0f, clip.GetDuration());
+			for (int node = 0; node < nodeCount; node++) {
+				int channel = clip.GetChannelForNode(node);
+				driven[node] = channel >= 0;
+				if (channel >= 0)
+					clip.SampleChannel(channel, time, poses[node]);
+			}
+
+			{
+				ProfileScope profile(s_Mat4, nodeCount);
+				for (int node = 0; node < nodeCount; node++) {
+					glm::mat4 local = bindMatrices[node];
+					if (driven[node]) {
+						const BonePose& pose = poses[node];
+						local = glm::translate(glm::mat4(1.0f), pose.translation) * glm::toMat4(pose.rotation) * glm::scale(glm::mat4(1.0f), pose.scale);
+					}
+					globalMatrices[node] = parents[node] < 0 ? local : globalMatrices[parents[node]] * local;
+					if (boneIds[node] >= 0)
+						paletteMat4[boneIds[node]] = globalMatrices[node] * offsetMatrices[boneIds[node]];
+				}
+			}
+
+			{
+				ProfileScope profile(s_Affine, nodeCount);
+				for (int node = 0; node < nodeCount; node++) {
+					AffineTransform local;
+					if (driven[node])
+						PoseMath::Compose(poses[node], local);
+					else
+						local = bindTransforms[node];
+					Animator::StoreNode(node, local, parents[node], boneIds[node], offsets.data(), globals.data(), paletteAffine.data());
+				}
+			}
+
+			for (size_t bone = 0; bone < offsets.size(); bone++)
+				for (int column = 0; column < 4; column++)
+					maxDifference = std::max(maxDifference, glm::length(paletteMat4[bone][column] - paletteAffine[bone][column]));
+		}
+	}
+
+	std::cout << "Pose math: largest palette difference between the two paths " << maxDifference << std::endl;
+	ProfileSection::Report(std::cout);
+}
+
+// --blend-bench: frame cost of the blend tree next to the two-slot crossfade, on one fighter's
+// clips. Runs 2, 4 and 8 inputs at even weights, 8 inputs with all but two under the prune
+// weight, and a walk with an upper-body punch and an additive hit layered over it.
+void runBlendBenchmark(Fighter& fighter, int frames) {
+	static ProfileSection s_Crossfade("Blend: two-slot crossfade", "frame");
+	static ProfileSection s_Inputs2("Blend tree: 2 inputs", "frame");
+	static ProfileSection s_Inputs4("Blend tree: 4 inputs", "frame");
+	static ProfileSection s_Inputs8("Blend tree: 8 inputs", "frame");
+	static ProfileSection s_Pruned("Blend tree: 8 inputs, 6 pruned", "frame");
+	static ProfileSection s_Layered("Blend tree: upper-body layers", "frame");
+	const float dt = 1.0f / 60.0f;
+	std::vector<Animation>& clips = fighter.clips;
+
+	auto run = [&](const char* name, ProfileSection& section, Animator& animator) {
+		long long sampled = 0;
+		for (int frame = 0; frame < frames; frame++) {
+			ProfileScope profile(section);
+			animator.Advance(dt);
+			animator.EvaluatePose(1.0f);
+			sampled += animator.m_SampledBones;
+		}
+		std::cout << name << ": " << static_cast<double>(sampled) / frames << " channels sampled per frame" << std::endl;
+	};
+
+	Animator crossfade(nullptr);
+	crossfade.PlayAnimation(&clips[0], &clips[1 % clips.size()], 0.0f, 0.0f, 0.5f);
+	run(s_Crossfade.GetName(), s_Crossfade, crossfade);
+
+	const int inputCounts[] = { 2, 4, 8 };
+	ProfileSection* sections[] = { &s_Inputs2, &s_Inputs4, &s_Inputs8 };
+	for (int i = 0; i < 3; i++) {
+		BlendTree tree;
+		int layer = tree.AddLayer();
+		for (int input = 0; input < inputCounts[i]; input++)
+			tree.AddInput(layer, &clips[input % clips.size()]);
+		Animator animator(nullptr);
+		animator.SetBlendTree(&tree);
+		run(sections[i]->GetName(), *sections[i], animator);
+	}
+
+	{
+		BlendTree tree;
+		int layer = tree.AddLayer();
+		for (int input = 0; input < 8; input++)
+			tree.AddInput(layer, &clips[input % clips.size()], input < 2 ? 1.0f : 0.001f);
+		Animator animator(nullptr);
+		animator.SetBlendTree(&tree);
+		run(s_Pruned.GetName(), s_Pruned, animator);
+	}
+
+	const FighterDefinition& definition = fighter.definition;
+	int walk = definition.FindClip("walk_front");
+	int punch = definition.FindClip("punch");
+	int hit = definition.FindClip("hit");
+	if (walk >= 0 && punch >= 0 && hit >= 0) {
+		BlendTree tree;
+		tree.AddInput(tree.AddLayer(), &clips[walk]);
+		int upperBody = tree.AddLayer();
+		tree.AddInput(upperBody, &clips[punch]);
+		int flinch = tree.AddLayer(BlendLayerMode::Additive, 0.5f);
+		tree.AddInput(flinch, &clips[hit]);
+		tree.SetAdditiveReference(flinch, &clips[hit]);
+		const Skeleton& skeleton = clips[walk].GetSkeleton();
+		if (!tree.SetLayerMask(upperBody, skeleton, "mixamorig_Spine") || !tree.SetLayerMask(flinch, skeleton, "mixamorig_Spine"))
+			std::cout << "Blend benchmark: " << definition.name << " has no mixamorig_Spine, layers cover the whole body" << std::endl;
+		Animator animator(nullptr);
+		animator.SetBlendTree(&tree);
+		run(s_Layered.GetName(), s_Layered, animator);
+	}
+
+	ProfileSection::Report(std::cout);
+}
+
+// --anim-bench: pose cost per frame for 2 to 512 characters on 1 to 16 threads. Characters
+// alternate between the two fighters' rigs and share their clips, each on its own clip and
+// phase, with every third one in a crossfade.
+void runAnimationScalingBenchmark(int frames) {
+	const int characterCounts[] = { 2, 8, 32, 128, 512 };
+	const int threadCounts[] = { 1, 2, 4, 8, 16 };
+	const float dt = 1.0f / 60.0f;
+	Fighter* rigs[] = { &fighterP1, &fighterP2 };
+
+	for (int characters : characterCounts) {
+		std::vector<Animator> animators;
+		animators.reserve(characters);
+		for (int i = 0; i < characters; i++) {
+			std::vector<Animation>& clips = rigs[i % 2]->clips;
+			Animation* clip = &clips[(i / 2) % clips.size()];
+			Animation* blendTarget = i % 3 == 0 ? &clips[(i / 2 + 1) % clips.size()] : nullptr;
+			animators.emplace_back(nullptr);
+			animators.back().PlayAnimation(clip, blendTarget, clip->GetDuration() * (i % 7) / 7.0f, 0.0f, 0.5f);
+		}
+
+		std::cout << std::setw(4) << characters << " characters:";
+		double serialMs = 0.0;
+		for (int threads : threadCounts) {
+			JobSystem jobs(threads - 1);
+			AnimationSystem system(&jobs);
+			system.SetMinBatchSize(1);
+			for (Animator& animator : animators)
+				system.Add(animator);
+
+			std::chrono::duration<double, std::milli> elapsed(0.0);
+			for (int frame = 0; frame < frames; frame++) {
+				system.Advance(dt);
+				auto start = std::chrono::high_resolution_clock::now();
+				system.EvaluatePoses(1.0f);
+				elapsed += std::chrono::high_resolution_clock::now() - start;
+			}
+			double ms = elapsed.count() / frames;
+			if (threads == 1)
+				serialMs = ms;
+			std::cout << "  " << threads << "T " << std::fixed << std::setprecision(3) << ms << " ms (x"
+				<< std::setprecision(1) << serialMs / ms << ")";
+			system.Clear();
+		}
+		std::cout << std::defaultfloat << std::endl;
+	}
+	ProfileSection::Report(std::cout);
+}
+
+// --lod-bench: pose cost of 512 characters spread from 2 to 60 units in front of the gameplay
+// camera, on one thread: first every character at each level of detail in turn, for the cost
+// per character of each level, then with levels picked by screen size, and with a bone budget.
+void runAnimationLodBenchmark(int frames) {
+	const int characters = 512;
+	const int columns = 16;
+	const float characterHeight = 1.6f;
+	const int boneBudget = 4000;
+	const float dt = 1.0f / 60.0f;
+	Fighter* rigs[] = { &fighterP1, &fighterP2 };
+	Camera benchCamera(gameCamPos, glm::vec3(0.0f, 1.0f, 0.0f), gameCamYaw, gameCamPitch);
+	glm::mat4 projection = glm::perspective(glm::radians(benchCamera.Zoom), (float)SCR_WIDTH / (float)SCR_HEIGHT, 0.1f, 100.0f);
+	glm::mat4 view = benchCamera.GetViewMatrix();
+
+	std::vector<Animator> animators;
+	animators.reserve(characters);
+	AnimationSystem system;
+	for (int i = 0; i < characters; i++) {
+		std::vector<Animation>& clips = rigs[i % 2]->clips;
+		Animation* clip = &clips[(i / 2) % clips.size()];
+		animators.emplace_back(nullptr);
+		animators.back().PlayAnimation(clip, nullptr, clip->GetDuration() * (i % 7) / 7.0f, 0.0f, 0.0f);
+		int row = i / columns;
+		float distance = 2.0f + 58.0f * row / (characters / columns - 1);
+		float across = (i % columns - (columns - 1) * 0.5f) * distance * 0.05f;
+		system.SetPlacement(system.Add(animators.back()), gameCamPos + benchCamera.Front * distance + benchCamera.Right * across
+			- glm::vec3(0.0f, characterHeight * 0.5f, 0.0f), characterHeight);
+	}
+
+	auto run = [&](const char* name) {
+		system.SelectLods(view, projection);
+		std::vector<int> perLevel(system.GetLodLevels().size(), 0);
+		for (int i = 0; i < characters; i++)
+			perLevel[system.GetLodLevel(i)]++;
+		std::chrono::duration<double, std::milli> elapsed(0.0);
+		for (int frame = 0; frame < frames; frame++) {
+			system.Advance(dt);
+			auto start = std::chrono::high_resolution_clock::now();
+			system.EvaluatePoses(1.0f);
+			elapsed += std::chrono::high_resolution_clock::now() - start;
+		}
+		double ms = elapsed.count() / frames;
+		std::cout << std::setw(24) << std::left << name << std::right << std::fixed << std::setprecision(3) << ms << " ms, "
+			<< std::setprecision(2) << ms * 1000.0 / characters << " us per character, ~" << system.GetEstimatedBones() << " bones; levels";
+		for (int count : perLevel)
+			std::cout << " " << count;
+		std::cout << std::defaultfloat << std::endl;
+	};
+
+	const std::vector<AnimationLodLevel> levels = system.GetLodLevels();
+	for (size_t level = 0; level < levels.size(); level++) {
+		AnimationLodLevel only = levels[level];
+		only.minScreenHeight = 0.0f;
+		system.SetLodLevels(std::vector<AnimationLodLevel>(1, only));
+		std::string name = "Every " + std::to_string(only.updateInterval) + (only.reducedBones ? " frames, reduced" : " frames, all bones");
+		run(name.c_str());
+	}
+	system.SetLodLevels(levels);
+	run("By screen size");
+	system.SetBoneBudget(boneBudget);
+	std::string budgeted = "Budget " + std::to_string(boneBudget) + " bones";
+	run(budgeted.c_str());
+	ProfileSection::Report(std::cout);
+}
+
+// Seats the audience on the far side of the ring, facing it: half on each fighter's rig, one
+// rig to each side of the camera's line of sight, so both halves stay one draw per mesh.
+void seatCrowd(CrowdRenderer* crowds[2], int spectators) {
+	const glm::vec3 ringCenter(0.0f, -0.4f, 1.5f);
+	const float innerRadius = 4.5f;
+	const float facingCamera = glm::half_pi<float>();
+	const float halfArc = glm::radians(70.0f);
+	crowds[0]->setInstances(crowds[0]->arrange((spectators + 1) / 2, ringCenter, innerRadius, facingCamera - halfArc, facingCamera));
+	crowds[1]->setInstances(crowds[1]->arrange(spectators / 2, ringCenter, innerRadius, facingCamera, facingCamera + halfArc));
+}
+
+// --crowd-bench: GPU frame time of the audience alone, from the gameplay camera, for 0 to
+// 4096 spectators. Each frame is finished before the clock stops, so the time is the GPU's.
+void runCrowdBenchmark(CrowdRenderer* crowds[2], Shader& crowdShader, int frames) {
+	const int crowdSizes[] = { 0, 64, 256, 1024, 4096 };
+	Camera benchCamera(gameCamPos, glm::vec3(0.0f, 1.0f, 0.0f), gameCamYaw, gameCamPitch);
+	glm::mat4 projection = glm::perspective(glm::radians(benchCamera.Zoom), (float)SCR_WIDTH / (float)SCR_HEIGHT, 0.1f, 100.0f);
+	glm::mat4 view = benchCamera.GetViewMatrix();
+
+	for (int spectators : crowdSizes) {
+		seatCrowd(crowds, spectators);
+		std::chrono::duration<double, std::milli> elapsed(0.0);
+		for (int frame = 0; frame < frames; frame++) {
+			auto start = std::chrono::high_resolution_clock::now();
+			glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+			float time = frame / 60.0f;
+			crowds[0]->draw(crowdShader, view, projection, time);
+			crowds[1]->draw(crowdShader, view, projection, time);
+			glFinish();
+			elapsed += std::chrono::high_resolution_clock::now() - start;
+		}
+		std::cout << "Crowd of " << std::setw(4) << spectators << ": " << std::fixed << std::setprecision(3)
+			<< elapsed.count() / frames << " ms per frame" << std::defaultfloat << std::endl;
+	}
+}
+
+int main(int argc, char** argv)
 {
+	// --cook: parse every model and clip from source, write their binary caches and compressed
+	// textures, then exit. --bake-ibl: rebake the IBL maps in a hidden window and exit, so a
+	// changed HDR never costs a play session the bake. --sim-check: play a scripted match through
+	// the frame loop at steady, jittered and stalling frame times, exit with 1 if the runs end in
+	// different states, a run differs from a replay of its ticks, or a hit-stop holds up the CPU
+	// side of a frame (timed headless, without drawing). --key-check: compare the cursor-cached
+	// key lookup with a linear search over every clip, exit with 1 on a mismatch. --alloc-check:
+	// run steady-state pose updates on every clip of both fighters, exit with 1 if any heap
+	// allocation happens. --pose-bench: time the original glm::mat4 pose math against the 3x4
+	// affine path on both fighters' clips, then exit. --blend-bench: time blend trees of 2, 4 and
+	// 8 clips and a layered upper-body blend on P1's clips, then exit. --anim-bench: time pose
+	// updates for 2 to 512 characters on 1 to 16 threads, then exit. --crowd <n>: seat n
+	// spectators (0 for none). --crowd-bench: time the audience alone at 0 to 4096 spectators,
+	// then exit. --lod-bench: time 512 characters at each animation level of detail and under a
+	// bone budget, then exit. --p1 / --p2 <file>: pick another fighter definition for a slot.
+	bool bakeIBL = false;
+	bool simCheck = false;
+	bool keyCheck = false;
+	bool allocationCheck = false;
+	bool blendBench = false;
+	bool poseBench = false;
+	bool animationBench = false;
+	bool crowdBench = false;
+	bool lodBench = false;
+	int crowdSize = 200;
+	std::string fighterPathP1 = "Fighters/vegas.json";
+	std::string fighterPathP2 = "Fighters/wrestler.json";
+	for (int i = 1; i < argc; i++)
+	{
+		if (std::string(argv[i]) == "--cook")
+			AssetCache::SetCooking(true);
+		else if (std::string(argv[i]) == "--bake-ibl")
+			bakeIBL = true;
+		else if (std::string(argv[i]) == "--sim-check")
+			simCheck = true;
+		else if (std::string(argv[i]) == "--key-check")
+			keyCheck = true;
+		else if (std::string(argv[i]) == "--alloc-check")
+			allocationCheck = true;
+		else if (std::string(argv[i]) == "--pose-bench")
+			poseBench = true;
+		else if (std::string(argv[i]) == "--blend-bench")
+			blendBench = true;
+		else if (std::string(argv[i]) == "--anim-bench")
+			animationBench = true;
+		else if (std::string(argv[i]) == "--crowd" && i + 1 < argc)
+			crowdSize = std::max(0, std::atoi(argv[++i]));
+		else if (std::string(argv[i]) == "--crowd-bench")
+			crowdBench = true;
+		else if (std::string(argv[i]) == "--lod-bench")
+			lodBench = true;
+		else if (std::string(argv[i]) == "--p1" && i + 1 < argc)
+			fighterPathP1 = argv[++i];
+		else if (std::string(argv[i]) == "--p2" && i + 1 < argc)
+			fighterPathP2 = argv[++i];
+	}
+
 	// glfw: initialize and configure
 	// ------------------------------
 	/*glfwInit();
@@ -984,6 +1628,8 @@ int main()
 #ifdef __APPLE__
 	glfwWindowHint(GLFW_OPENGL_FORWARD_COMPAT, GL_TRUE);
 #endif
+	if (bakeIBL || simCheck || keyCheck || allocationCheck || poseBench || blendBench || animationBench || crowdBench || lodBench)
+		glfwWindowHint(GLFW_VISIBLE, GL_FALSE);
 
 	// glfw window creation
 	// --------------------
@@ -1012,8 +1658,11 @@ int main()
 		return -1;
 	}
 
-	// tell stb_image.h to flip loaded texture's on the y-axis (before loading model).
-	stbi_set_flip_vertically_on_load(true);
+	// cooked DXT textures are only used when the driver exposes S3TC
+	DetectCompressedTextureSupport();
+
+	// stb_image's flip switch stays off: it is one global shared by the loader workers, so each
+	// DecodeImage call flips its own rows instead (character textures, skybox and HDR are flipped)
 
 	// configure global opengl state
 	// -----------------------------
@@ -1026,6 +1675,11 @@ int main()
 	// build and compile shader
 	// -------------------------
 	Shader ourShader("anim_model.vs", "anim_model.fs");
+	// skinning palettes: the animators pose straight into the buffer's staging ranges
+	BonePaletteBuffer bonePalettes(2, fighterP1.animator.GetFinalBoneMatrices().size());
+	bonePalettes.bindBlock(ourShader.getID());
+	// the audience skins from a baked bone texture instead of the palette buffer
+	Shader crowdShader("Shaders/crowd.vs", "anim_model.fs");
 
 	Shader pbrShader("Shaders/PBR/pbr.vs", "Shaders/PBR/pbr.fs");
 	Shader equirectangularToCubemapShader("Shaders/PBR/cubemap.vs", "Shaders/PBR/equirectangular_to_cubemap.fs");
@@ -1037,6 +1691,18 @@ int main()
 	Shader textShader("Shaders/text.vs", "Shaders/text.fs");
 	Shader UIShader("Shaders/UIShader.vs", "Shaders/UIShader.fs");
 
+	if (bakeIBL)
+	{
+		{
+			IBLMaps bakedIBL("Textures/HDR/sky.hdr");
+			bakedIBL.bake(DecodeImage(bakedIBL.getHdrPath(), true, true), equirectangularToCubemapShader, irradianceShader, prefilterShader, brdfShader);
+		}
+		ProfileSection::Report(std::cout);
+		std::cout << "IBL bake finished" << std::endl;
+		glfwTerminate();
+		return 0;
+	}
+
 	Shader skyboxShader("Shaders/skybox/skybox.vs", "Shaders/skybox/skybox.fs");
 	std::vector<std::string> faces = {
 	"Textures/skybox/sunset/px.jpg",
@@ -1047,284 +1713,256 @@ int main()
 	"Textures/skybox/sunset/nz.jpg"
 	};
 
-	Skybox skybox(faces, skyboxShader.getID());
-
 	// load models
 	// -----------
 	// idle 3.3, walk 2.06, run 0.83, punch 1.03, kick 1.6
 	
-	player1.loadModel("Object/Vegas/Big Vegas.dae");
-	introAnimationP1.loadAnimation("Object/Vegas/Step Hip Hop Dance.dae",&player1);
-	idleAnimationP1.loadAnimation("Object/Vegas/Idle.dae",&player1);
-	walkFrontAnimationP1.loadAnimation("Object/Vegas/Walking.dae", &player1,1.0f);
-	walkBackAnimationP1.loadAnimation("Object/Vegas/Walking Backwards.dae", &player1,1.0f);
-	punchAnimationP1.loadAnimation("Object/Vegas/Punch Combo.dae", &player1,1.5f);
-	punchAnimationP1.AddDamageKeyframe(0.5f, P1punchDamage);
-	punchAnimationP1.AddDamageKeyframe(1.0f, P1punchDamage);
-	punchAnimationP1.AddDamageKeyframe(1.5f, P1punchDamage);
-	punchAnimationP1.AddDamageKeyframe(2.0f, P1punchDamage);
-	kickAnimationP1.loadAnimation("Object/Vegas/Kicking.dae", &player1,1.5f);
-	kickAnimationP1.AddDamageKeyframe(0.7f, P1kickDamage);
-	blockAnimationP1.loadAnimation("Object/Vegas/Center Block.dae", &player1,1.2f);
-	hitAnimationP1.loadAnimation("Object/Vegas/Head Hit Punch.dae", &player1, 1.5f);
-	defeatAnimationP1.loadAnimation("Object/Vegas/Defeat.dae", &player1, 1.0f);
-	victoryAnimationP1.loadAnimation("Object/Vegas/Victory Idle.dae", &player1, 1.0f);
-
-	player2.loadModel("Object/Wrestler/Ch43_nonPBR.dae");
-	introAnimationP2.loadAnimation("Object/Wrestler/Catwalk Walk.dae", &player2);
-	idleAnimationP2.loadAnimation("Object/Wrestler/Fighting Idle.dae", &player2);
-	walkFrontAnimationP2.loadAnimation("Object/Wrestler/Walking.dae", &player2);
-	walkBackAnimationP2.loadAnimation("Object/Wrestler/Walking Backwards.dae", &player2, 1.0f);
-	punchAnimationP2.loadAnimation("Object/Wrestler/Cross Punch.dae", &player2, 1.0f);
-	punchAnimationP2.AddDamageKeyframe(0.25f,P2punchDamage);
-	kickAnimationP2.loadAnimation("Object/Wrestler/Mma Kick.dae", &player2, 1.8f);
-	kickAnimationP2.AddDamageKeyframe(0.7f, P2kickDamage);
-	blockAnimationP2.loadAnimation("Object/Wrestler/Left Block.dae", &player2, 1.0f);
-	hitAnimationP2.loadAnimation("Object/Wrestler/Head Hit.dae", &player2, 1.5f);
-	defeatAnimationP2.loadAnimation("Object/Wrestler/Defeat.dae", &player2, 1.0f);
-	victoryAnimationP2.loadAnimation("Object/Wrestler/Victory.dae", &player2, 1.0f);
-
-	stbi_set_flip_vertically_on_load(false);
-
-	Model Scene("Object/Scene/Low Poly Winter Scene.obj");
-
-	pbrShader.use();
-	pbrShader.setInt("irradianceMap", 0);
-	pbrShader.setInt("prefilterMap", 1);
-	pbrShader.setInt("brdfLUT", 2);
-	pbrShader.setInt("albedoMap", 3);
-	pbrShader.setInt("normalMap", 4);
-	pbrShader.setInt("metallicMap", 5);
-	pbrShader.setInt("roughnessMap", 6);
-	pbrShader.setInt("aoMap", 7);
-
-	backgroundShader.use();
-	backgroundShader.setInt("environmentMap", 0);
-
-	//initTextRendering("Textures/Fonts/Roboto-Bold.ttf");
-
-	initTextRendering("Textures/Fonts/Cybergame-Regular Italic.ttf");
-	glm::mat4 projection = glm::ortho(0.0f, static_cast<float>(SCR_WIDTH), 0.0f, static_cast<float>(SCR_HEIGHT));
-	textShader.use();
-
-	glUniformMatrix4fv(glGetUniformLocation(textShader.ID, "projection"), 1, GL_FALSE, glm::value_ptr(projection));
-
-	initUIRendering();
-	unsigned int healthBarTexture = loadTexture("Textures/UI/Health Bar/HP_Bar.png");
-	unsigned int healthBarBorderTexture = loadTexture("Textures/UI/Health Bar/HP_Border.png");
-
-	unsigned int emptyCircleTexture = loadTexture("Textures/UI/Health Bar/Dot_01.png");
-	unsigned int fillCircletexture = loadTexture("Textures/UI/Health Bar/Dot_02.png");
-
-	// pbr: setup framebuffer
-   // ----------------------
-	unsigned int captureFBO;
-	unsigned int captureRBO;
-	glGenFramebuffers(1, &captureFBO);
-	glGenRenderbuffers(1, &captureRBO);
-
-	glBindFramebuffer(GL_FRAMEBUFFER, captureFBO);
-	glBindRenderbuffer(GL_RENDERBUFFER, captureRBO);
-	glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH_COMPONENT24, 512, 512);
-	glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_RENDERBUFFER, captureRBO);
-
-	// pbr: load the HDR environment map
-	// ---------------------------------
-	stbi_set_flip_vertically_on_load(true);
-	int width, height, nrComponents;
-	float* data = stbi_loadf("Textures/HDR/sky.hdr", &width, &height, &nrComponents, 0);
-	unsigned int hdrTexture;
-	if (data)
+	// startup is timed here and reported once, so load-path changes can be compared run to run.
+	// Parsing, clip imports and image decoding run on the job system's workers; mesh and texture
+	// uploads come back to this thread as completions while the remaining jobs keep going.
+	static ProfileSection s_ModelLoad("Startup: model import", "model");
+	auto loadStart = std::chrono::high_resolution_clock::now();
+	JobSystem loaderJobs;
+	ClipLoader clipLoaderP1;
+	ClipLoader clipLoaderP2;
+	Model Scene;
+
+	// the definitions are small and say what everything else loads, so they are read up front
+	if (!fighterP1.definition.Load(fighterPathP1) || !fighterP2.definition.Load(fighterPathP2))
 	{
-		glGenTextures(1, &hdrTexture);
-		glBindTexture(GL_TEXTURE_2D, hdrTexture);
-		glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB16F, width, height, 0, GL_RGB, GL_FLOAT, data); // note how we specify the texture's data value to be float
-
-		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
-		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
-		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-
-		std::cout << "HDR Loaded: Width = " << width << ", Height = " << height << ", Components = " << nrComponents << std::endl;
+		glfwTerminate();
+		return -1;
+	}
 
-		stbi_image_free(data);
+	// player slots: P1 faces +z and plays on D/A/V/B with S to block, P2 faces -z and plays on
+	// the arrows and keypad with DOWN to block
+	const int keysP1[INPUT_COUNT] = { GLFW_KEY_D, GLFW_KEY_A, GLFW_KEY_V, GLFW_KEY_B, GLFW_KEY_S };
+	const int keysP2[INPUT_COUNT] = { GLFW_KEY_LEFT, GLFW_KEY_RIGHT, GLFW_KEY_KP_1, GLFW_KEY_KP_2, GLFW_KEY_DOWN };
+	std::copy(keysP1, keysP1 + INPUT_COUNT, fighterP1.keys);
+	std::copy(keysP2, keysP2 + INPUT_COUNT, fighterP2.keys);
+	fighterP1.facing = 1.0f;
+	fighterP2.facing = -1.0f;
 
-	}
-	else
+	loaderJobs.Submit([&] {
+		{
+			ProfileScope profile(s_ModelLoad);
+			fighterP1.model.ParseModel(fighterP1.definition.modelPath);
+		}
+		loaderJobs.PostToMain([] { fighterP1.model.UploadModel(); });
+	});
+	loaderJobs.Submit([&] {
+		{
+			ProfileScope profile(s_ModelLoad);
+			fighterP2.model.ParseModel(fighterP2.definition.modelPath);
+		}
+		loaderJobs.PostToMain([] { fighterP2.model.UploadModel(); });
+	});
+	loaderJobs.Submit([&] {
+		{
+			ProfileScope profile(s_ModelLoad);
+			Scene.ParseModel("Object/Scene/Low Poly Winter Scene.obj");
+		}
+		loaderJobs.PostToMain([&] { Scene.UploadModel(); });
+	});
+
+	FighterRuntime::QueueClips(fighterP1, clipLoaderP1);
+	clipLoaderP1.Import(loaderJobs);
+	FighterRuntime::QueueClips(fighterP2, clipLoaderP2);
+	clipLoaderP2.Import(loaderJobs);
+
+	// images: each job decodes into its own slot, GL objects are created once WaitAll returns
+	std::vector<DecodedImage> skyboxFaces(faces.size());
+	for (size_t i = 0; i < faces.size(); i++)
+		loaderJobs.Submit([&, i] { skyboxFaces[i] = DecodeImage(faces[i], true); });
+
+	const char* uiTexturePaths[] = {
+		"Textures/UI/Health Bar/HP_Bar.png",
+		"Textures/UI/Health Bar/HP_Border.png",
+		"Textures/UI/Health Bar/Dot_01.png",
+		"Textures/UI/Health Bar/Dot_02.png"
+	};
+	DecodedImage uiImages[4];
+	for (int i = 0; i < 4; i++)
+		loaderJobs.Submit([&, i] { uiImages[i] = DecodeTexture(uiTexturePaths[i], false); });
+
+	// the HDR is only decoded when its baked IBL maps are missing or stale
+	IBLMaps ibl("Textures/HDR/sky.hdr");
+	DecodedImage hdrImage;
+	loaderJobs.Submit([&] {
+		if (!ibl.readCache())
+			hdrImage = DecodeImage(ibl.getHdrPath(), true, true);
+	});
+
+	loaderJobs.WaitAll();
+
+	// bone ids depend on bind order: each model's own bones first, then its clips as added.
+	// A clip that failed has no skeleton to sample, so the match can't start without it; Bind
+	// has already printed which one.
+	bool clipsBoundP1 = clipLoaderP1.Bind(fighterP1.model);
+	bool clipsBoundP2 = clipLoaderP2.Bind(fighterP2.model);
+	if (!clipsBoundP1 || !clipsBoundP2)
 	{
-		std::cout << "Failed to load HDR image." << std::endl;
+		glfwTerminate();
+		return -1;
 	}
 
-	// pbr: setup cubemap to render to and attach to framebuffer
-	// ---------------------------------------------------------
-	unsigned int envCubemap;
-	glGenTextures(1, &envCubemap);
-	glBindTexture(GL_TEXTURE_CUBE_MAP, envCubemap);
-	for (unsigned int i = 0; i < 6; ++i)
-	{
-		glTexImage2D(GL_TEXTURE_CUBE_MAP_POSITIVE_X + i, 0, GL_RGB16F, 512, 512, 0, GL_RGB, GL_FLOAT, nullptr);
-	}
-	glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
-	glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
-	glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_R, GL_CLAMP_TO_EDGE);
-	glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR); // enable pre-filter mipmap sampling (combatting visible dots artifact)
-	glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-
-	// pbr: set up projection and view matrices for capturing data onto the 6 cubemap face directions
-	// ----------------------------------------------------------------------------------------------
-	glm::mat4 captureProjection = glm::perspective(glm::radians(90.0f), 1.0f, 0.1f, 10.0f);
-	glm::mat4 captureViews[] =
+	if (keyCheck)
 	{
-		glm::lookAt(glm::vec3(0.0f, 0.0f, 0.0f), glm::vec3(1.0f,  0.0f,  0.0f), glm::vec3(0.0f, -1.0f,  0.0f)),
-		glm::lookAt(glm::vec3(0.0f, 0.0f, 0.0f), glm::vec3(-1.0f,  0.0f,  0.0f), glm::vec3(0.0f, -1.0f,  0.0f)),
-		glm::lookAt(glm::vec3(0.0f, 0.0f, 0.0f), glm::vec3(0.0f,  1.0f,  0.0f), glm::vec3(0.0f,  0.0f,  1.0f)),
-		glm::lookAt(glm::vec3(0.0f, 0.0f, 0.0f), glm::vec3(0.0f, -1.0f,  0.0f), glm::vec3(0.0f,  0.0f, -1.0f)),
-		glm::lookAt(glm::vec3(0.0f, 0.0f, 0.0f), glm::vec3(0.0f,  0.0f,  1.0f), glm::vec3(0.0f, -1.0f,  0.0f)),
-		glm::lookAt(glm::vec3(0.0f, 0.0f, 0.0f), glm::vec3(0.0f,  0.0f, -1.0f), glm::vec3(0.0f, -1.0f,  0.0f))
+		bool matching = runKeyLookupCheck();
+		glfwTerminate();
+		return matching ? 0 : 1;
+	}
 
-	};
+	// strike events from the definitions, then fixed-rate pose tables for the clips that ask for
+	// them (slow loops get away with a lower rate, strikes keep 60 Hz so contact poses stay
+	// sharp). Each table is checked against the raw keys and dropped, with a warning, when it
+	// strays past the fighter's bakeTolerance. Last the keys are compressed; every clip logs its
+	// bytes and worst error.
+	FighterRuntime::FinishLoading(fighterP1);
+	FighterRuntime::FinishLoading(fighterP2);
 
-	// pbr: convert HDR equirectangular environment map to cubemap equivalent
-	// ----------------------------------------------------------------------
-	equirectangularToCubemapShader.use();
-	equirectangularToCubemapShader.setInt("equirectangularMap", 0);
-	equirectangularToCubemapShader.setMat4("projection", captureProjection);
-	glActiveTexture(GL_TEXTURE0);
-	glBindTexture(GL_TEXTURE_2D, hdrTexture);
-
-	glViewport(0, 0, 512, 512); // don't forget to configure the viewport to the capture dimensions.
-	glBindFramebuffer(GL_FRAMEBUFFER, captureFBO);
-	for (unsigned int i = 0; i < 6; ++i)
+	// before any listener is attached, so the events crossed reach no game code
+	if (allocationCheck)
 	{
-		equirectangularToCubemapShader.setMat4("view", captureViews[i]);
-		glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_CUBE_MAP_POSITIVE_X + i, envCubemap, 0);
-		glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
-
-		renderCube();
-
+		bool allocationFree = runAllocationCheck(600);
+		glfwTerminate();
+		return allocationFree ? 0 : 1;
 	}
-	glBindFramebuffer(GL_FRAMEBUFFER, 0);
-
-	// then let OpenGL generate mipmaps from first mip face (combatting visible dots artifact)
-	glBindTexture(GL_TEXTURE_CUBE_MAP, envCubemap);
-	glGenerateMipmap(GL_TEXTURE_CUBE_MAP);
 
-	// pbr: create an irradiance cubemap, and re-scale capture FBO to irradiance scale.
-	// --------------------------------------------------------------------------------
-	unsigned int irradianceMap;
-	glGenTextures(1, &irradianceMap);
-	glBindTexture(GL_TEXTURE_CUBE_MAP, irradianceMap);
-	for (unsigned int i = 0; i < 6; ++i)
+	// damage and hit-stop follow the strike events the attack clips cross, the swish their sound events
+	fighterP1.animator.AddEventListener([](const Animation& clip, const AnimationEvent& event) {
+		resolveStrike(fighterP1, fighterP2, player2Stats, "Player 2", clip, event);
+	});
+	fighterP1.animator.AddEventListener([](const Animation&, const AnimationEvent& event) { playSoundCue(P1swishSound, event); });
+	fighterP2.animator.AddEventListener([](const Animation& clip, const AnimationEvent& event) {
+		resolveStrike(fighterP2, fighterP1, player1Stats, "Player 1", clip, event);
+	});
+	fighterP2.animator.AddEventListener([](const Animation&, const AnimationEvent& event) { playSoundCue(P2swishSound, event); });
+
+	// every frame's poses in one call on the loader's workers, straight into the palette
+	// staging; timed per rig, since the two skeletons differ in bone count
+	static const std::string s_PoseUpdateNameP1 = "Pose update: " + fighterP1.definition.name;
+	static const std::string s_PoseUpdateNameP2 = "Pose update: " + fighterP2.definition.name;
+	static ProfileSection s_PoseUpdateP1(s_PoseUpdateNameP1.c_str());
+	static ProfileSection s_PoseUpdateP2(s_PoseUpdateNameP2.c_str());
+	AnimationSystem characterAnimation(&loaderJobs);
+	characterAnimation.Add(fighterP1.animator, bonePalettes.getStaging(0), &s_PoseUpdateP1);
+	characterAnimation.Add(fighterP2.animator, bonePalettes.getStaging(1), &s_PoseUpdateP2);
+	// whatever else gets animated on the CPU drops detail with distance; the fighters never do
+	characterAnimation.SetFullQuality(0, true);
+	characterAnimation.SetFullQuality(1, true);
+
+	Skybox skybox(skyboxFaces, skyboxShader.getID());
+	skyboxFaces.clear();
+
+	// run once without caches (or right after --cook) and once with them to compare cold and warm starts
+	auto loadElapsed = std::chrono::high_resolution_clock::now() - loadStart;
+	std::cout << "Assets loaded in " << std::chrono::duration_cast<std::chrono::milliseconds>(loadElapsed).count() << " ms"
+		<< " on " << loaderJobs.GetWorkerCount() << " workers"
+		<< " (" << AssetCache::Hits().GetCount() << " from cache, " << AssetCache::Misses().GetCount() << " parsed)" << std::endl;
+	ProfileSection::Report(std::cout);
+
+	if (AssetCache::IsCooking())
 	{
-		glTexImage2D(GL_TEXTURE_CUBE_MAP_POSITIVE_X + i, 0, GL_RGB16F, 32, 32, 0, GL_RGB, GL_FLOAT, nullptr);
-	}
-	glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
-	glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
-	glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_R, GL_CLAMP_TO_EDGE);
-	glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-	glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-
-	glBindFramebuffer(GL_FRAMEBUFFER, captureFBO);
-	glBindRenderbuffer(GL_RENDERBUFFER, captureRBO);
-	glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH_COMPONENT24, 32, 32);
-
-	// pbr: solve diffuse integral by convolution to create an irradiance (cube)map.
-	// -----------------------------------------------------------------------------
-	irradianceShader.use();
-	irradianceShader.setInt("environmentMap", 0);
-	irradianceShader.setMat4("projection", captureProjection);
-	glActiveTexture(GL_TEXTURE0);
-	glBindTexture(GL_TEXTURE_CUBE_MAP, envCubemap);
+		std::cout << "Cook finished" << std::endl;
+		glfwTerminate();
+		return 0;
+	}
 
-	glViewport(0, 0, 32, 32); // don't forget to configure the viewport to the capture dimensions.
-	glBindFramebuffer(GL_FRAMEBUFFER, captureFBO);
-	for (unsigned int i = 0; i < 6; ++i)
+	if (poseBench)
 	{
-		irradianceShader.setMat4("view", captureViews[i]);
-		glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_CUBE_MAP_POSITIVE_X + i, irradianceMap, 0);
-		glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
-
-		renderCube();
+		runPoseMathBenchmark(2000);
+		glfwTerminate();
+		return 0;
+	}
 
+	if (blendBench)
+	{
+		runBlendBenchmark(fighterP1, 2000);
+		glfwTerminate();
+		return 0;
 	}
-	glBindFramebuffer(GL_FRAMEBUFFER, 0);
 
-	// pbr: create a pre-filter cubemap, and re-scale capture FBO to pre-filter scale.
-	// --------------------------------------------------------------------------------
-	unsigned int prefilterMap;
-	glGenTextures(1, &prefilterMap);
-	glBindTexture(GL_TEXTURE_CUBE_MAP, prefilterMap);
-	for (unsigned int i = 0; i < 6; ++i)
+	if (animationBench)
 	{
-		glTexImage2D(GL_TEXTURE_CUBE_MAP_POSITIVE_X + i, 0, GL_RGB16F, 128, 128, 0, GL_RGB, GL_FLOAT, nullptr);
-	}
-	glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
-	glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
-	glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_R, GL_CLAMP_TO_EDGE);
-	glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR); // be sure to set minification filter to mip_linear 
-	glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-	// generate mipmaps for the cubemap so OpenGL automatically allocates the required memory.
-	glGenerateMipmap(GL_TEXTURE_CUBE_MAP);
-
-	// pbr: run a quasi monte-carlo simulation on the environment lighting to create a prefilter (cube)map.
-	// ----------------------------------------------------------------------------------------------------
-	prefilterShader.use();
-	prefilterShader.setInt("environmentMap", 0);
-	prefilterShader.setMat4("projection", captureProjection);
-	glActiveTexture(GL_TEXTURE0);
-	glBindTexture(GL_TEXTURE_CUBE_MAP, envCubemap);
+		runAnimationScalingBenchmark(120);
+		glfwTerminate();
+		return 0;
+	}
 
-	glBindFramebuffer(GL_FRAMEBUFFER, captureFBO);
-	unsigned int maxMipLevels = 5;
-	for (unsigned int mip = 0; mip < maxMipLevels; ++mip)
+	if (lodBench)
 	{
-		// reisze framebuffer according to mip-level size.
-		unsigned int mipWidth = static_cast<unsigned int>(128 * std::pow(0.5, mip));
-		unsigned int mipHeight = static_cast<unsigned int>(128 * std::pow(0.5, mip));
-		glBindRenderbuffer(GL_RENDERBUFFER, captureRBO);
-		glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH_COMPONENT24, mipWidth, mipHeight);
-		glViewport(0, 0, mipWidth, mipHeight);
-
-		float roughness = (float)mip / (float)(maxMipLevels - 1);
-		prefilterShader.setFloat("roughness", roughness);
-		for (unsigned int i = 0; i < 6; ++i)
-		{
-			prefilterShader.setMat4("view", captureViews[i]);
-			glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_CUBE_MAP_POSITIVE_X + i, prefilterMap, mip);
+		runAnimationLodBenchmark(240);
+		glfwTerminate();
+		return 0;
+	}
 
-			glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
-			renderCube();
-		}
+	// the audience: each rig's intro, idle and victory clips baked into a bone texture, with
+	// every spectator animated on the GPU from there
+	CrowdRenderer crowdP1(fighterP1.model, fighterP1.definition.modelScale);
+	CrowdRenderer crowdP2(fighterP2.model, fighterP2.definition.modelScale);
+	CrowdRenderer* crowds[] = { &crowdP1, &crowdP2 };
+	const FighterRole crowdRoles[] = { ROLE_INTRO, ROLE_IDLE, ROLE_VICTORY };
+	for (int i = 0; i < 2; i++) {
+		Fighter& rig = i == 0 ? fighterP1 : fighterP2;
+		std::vector<Animation*> crowdClips;
+		for (FighterRole role : crowdRoles)
+			crowdClips.push_back(&rig.RoleClip(role));
+		crowds[i]->bake(crowdClips);
 	}
 
-	glBindFramebuffer(GL_FRAMEBUFFER, 0);
+	if (crowdBench)
+	{
+		runCrowdBenchmark(crowds, crowdShader, 120);
+		glfwTerminate();
+		return 0;
+	}
+	seatCrowd(crowds, crowdSize);
+	float crowdTime = 0.0f;
+
+	pbrShader.use();
+	pbrShader.setInt("irradianceMap", 0);
+	pbrShader.setInt("prefilterMap", 1);
+	pbrShader.setInt("brdfLUT", 2);
+	pbrShader.setInt("albedoMap", 3);
+	pbrShader.setInt("normalMap", 4);
+	pbrShader.setInt("metallicMap", 5);
+	pbrShader.setInt("roughnessMap", 6);
+	pbrShader.setInt("aoMap", 7);
 
-	// pbr: generate a 2D LUT from the BRDF equations used.
-	// ----------------------------------------------------
-	unsigned int brdfLUTTexture;
-	glGenTextures(1, &brdfLUTTexture);
+	backgroundShader.use();
+	backgroundShader.setInt("environmentMap", 0);
 
-	// pre-allocate enough memory for the LUT texture.
-	glBindTexture(GL_TEXTURE_2D, brdfLUTTexture);
-	glTexImage2D(GL_TEXTURE_2D, 0, GL_RG16F, 512, 512, 0, GL_RG, GL_FLOAT, 0);
-	// be sure to set wrapping mode to GL_CLAMP_TO_EDGE
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+	//initTextRendering("Textures/Fonts/Roboto-Bold.ttf");
 
-	// then re-configure capture framebuffer object and render screen-space quad with BRDF shader.
-	glBindFramebuffer(GL_FRAMEBUFFER, captureFBO);
-	glBindRenderbuffer(GL_RENDERBUFFER, captureRBO);
-	glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH_COMPONENT24, 512, 512);
-	glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, brdfLUTTexture, 0);
+	initTextRendering("Textures/Fonts/Cybergame-Regular Italic.ttf");
+	glm::mat4 projection = glm::ortho(0.0f, static_cast<float>(SCR_WIDTH), 0.0f, static_cast<float>(SCR_HEIGHT));
+	textShader.use();
 
-	glViewport(0, 0, 512, 512);
-	brdfShader.use();
-	glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
-	renderQuad();
+	glUniformMatrix4fv(glGetUniformLocation(textShader.ID, "projection"), 1, GL_FALSE, glm::value_ptr(projection));
 
-	glBindFramebuffer(GL_FRAMEBUFFER, 0);
+	initUIRendering();
+	int hudTextures = TextureCache::Get().NewOwner();
+	unsigned int healthBarTexture = TextureCache::Get().Acquire(uiImages[0], hudTextures);
+	unsigned int healthBarBorderTexture = TextureCache::Get().Acquire(uiImages[1], hudTextures);
+
+	unsigned int emptyCircleTexture = TextureCache::Get().Acquire(uiImages[2], hudTextures);
+	unsigned int fillCircletexture = TextureCache::Get().Acquire(uiImages[3], hudTextures);
+	for (DecodedImage& image : uiImages)
+		image = DecodedImage();
+	// every 2D texture the match uses is resident by now
+	TextureCache::Get().Report(std::cout);
+
+	// pbr: irradiance, pre-filter and BRDF maps, from the IBL cache when it matches the HDR
+	// -------------------------------------------------------------------------------------
+	if (ibl.hasCachedData())
+		ibl.uploadCache();
+	else
+		ibl.bake(hdrImage, equirectangularToCubemapShader, irradianceShader, prefilterShader, brdfShader);
+	hdrImage = DecodedImage();
+	unsigned int irradianceMap = ibl.getIrradianceMap();
+	unsigned int prefilterMap = ibl.getPrefilterMap();
+	unsigned int brdfLUTTexture = ibl.getBrdfLUT();
 
 	pbrShader.use();
 	for (int i = 0; i < 4; ++i) {
@@ -1339,24 +1977,36 @@ int main()
 		return -1; // error starting up the engine
 	}
 
-	 punchSound = soundEngine->addSoundSourceFromFile("Sounds/punch.mp3");
-	 kickSound = soundEngine->addSoundSourceFromFile("Sounds/kick.mp3");
 	 P1swishSound = soundEngine->addSoundSourceFromFile("Sounds/swish.mp3");
 	 P2swishSound = soundEngine->addSoundSourceFromFile("Sounds/swish.mp3");
 	 BGM = soundEngine->addSoundSourceFromFile("Sounds/Fight or Flight.mp3");
 	 introP1Sound = soundEngine->addSoundSourceFromFile("Sounds/IntroP1.mp3");
 	 crowdSound = soundEngine->addSoundSourceFromFile("Sounds/crowd.mp3");
 	 introP2Sound = soundEngine->addSoundSourceFromFile("Sounds/IntroP2.mp3");
+	// impact sounds named by the definitions, loaded now rather than on the first hit
+	for (const Fighter* fighter : { &fighterP1, &fighterP2 })
+		for (const FighterClip& clip : fighter->definition.clips)
+			if (!clip.impactSound.empty())
+				soundEngine->getSoundSource(clip.impactSound.c_str());
+
+	if (simCheck)
+	{
+		soundEngine->setSoundVolume(0.0f);
+		bool consistent = runSimulationCheck(60 * 60, characterAnimation);
+		soundEngine->stopAllSounds();
+		glfwTerminate();
+		return consistent ? 0 : 1;
+	}
 
 	
 	//INITIAL STATES FOR GAME INTRO
 	//---------------------------------------------------------------
 
-	player1_animator.PlayAnimation(&idleAnimationP1, nullptr, 0.0f, 0.0f, 0.0f);
-	player2_animator.PlayAnimation(&idleAnimationP2, nullptr, 0.0f, 0.0f, 0.0f);
+	fighterP1.PlayRole(ROLE_IDLE);
+	fighterP2.PlayRole(ROLE_IDLE);
 
-	player2Position = player2gamePosition;
-	player1Position = player1gamePosition;
+	fighterP2.position = player2gamePosition;
+	fighterP1.position = player1gamePosition;
 	camera.Yaw = gameCamYaw;
 	camera.Pitch = gameCamPitch;
 	camera.Position = gameCamPos;
@@ -1371,13 +2021,15 @@ int main()
 	introP1Sound->setDefaultVolume(0.5f);
 	introP1Sound->setDefaultVolume(0.5f);
 	crowdSound->setDefaultVolume(0.5f);
-	kickSound->setDefaultVolume(1.0f);
 	int scrWidth, scrHeight;
 	glfwGetFramebufferSize(window, &scrWidth, &scrHeight);
 	glViewport(0, 0, scrWidth, scrHeight);
 
 	// render loop
 	// -----------
+	// loading time is not owed to the simulation
+	lastFrame = glfwGetTime();
+	RenderState previousRenderState = captureRenderState();
 	while (!glfwWindowShouldClose(window))
 	{
 		// per-frame time logic
@@ -1393,9 +2045,29 @@ int main()
 		if (glfwGetKey(window, GLFW_KEY_ESCAPE) == GLFW_PRESS)
 			glfwSetWindowShouldClose(window, true);
 
+		// F1 dumps the profile counters gathered since the last dump
+		static bool profileKeyDown = false;
+		bool profileKeyPressed = glfwGetKey(window, GLFW_KEY_F1) == GLFW_PRESS;
+		if (profileKeyPressed && !profileKeyDown)
+			ProfileSection::Report(std::cout);
+		profileKeyDown = profileKeyPressed;
+
+		// simulation: every whole tick this frame's time covers
+		// ------------------------------------------------------
+		simInput = sampleInput(window);
+		int ticks = simClock.Advance(deltaTime);
+		for (int tick = 0; tick < ticks; tick++)
+		{
+			previousRenderState = captureRenderState();
+			simulateTick(simClock.GetStep());
+		}
 
-		player1_animator.UpdateAnimation(deltaTime);
-		player2_animator.UpdateAnimation(deltaTime);
+		// draw between the last two ticks, by the part of a tick already elapsed
+		float alpha = simClock.GetAlpha();
+		RenderState renderState = lerpRenderState(previousRenderState, captureRenderState(), alpha);
+		Camera renderCamera = makeRenderCamera(renderState);
+		characterAnimation.SelectLods(renderCamera.GetViewMatrix(), lodProjection(renderCamera));
+		characterAnimation.EvaluatePoses(alpha);
 
 		// render
 		// ------
@@ -1406,11 +2078,11 @@ int main()
 		pbrShader.use();
 
 		// view/projection transformations
-		glm::mat4 projection = glm::perspective(glm::radians(camera.Zoom), (float)SCR_WIDTH / (float)SCR_HEIGHT, near_plane, far_plane);
-		glm::mat4 view = camera.GetViewMatrix();
+		glm::mat4 projection = glm::perspective(glm::radians(renderCamera.Zoom), (float)SCR_WIDTH / (float)SCR_HEIGHT, near_plane, far_plane);
+		glm::mat4 view = renderCamera.GetViewMatrix();
 		pbrShader.setMat4("projection", projection);
 		pbrShader.setMat4("view", view);
-		pbrShader.setVec3("camPos", camera.Position);
+		pbrShader.setVec3("camPos", renderCamera.Position);
 
 		glActiveTexture(GL_TEXTURE0);
 		glBindTexture(GL_TEXTURE_CUBE_MAP, irradianceMap);
@@ -1436,8 +2108,8 @@ int main()
 		ourShader.use();
 
 		// view/projection transformations
-		projection = glm::perspective(glm::radians(camera.Zoom), (float)SCR_WIDTH / (float)SCR_HEIGHT, 0.1f, 100.0f);
-		view = camera.GetViewMatrix();
+		projection = glm::perspective(glm::radians(renderCamera.Zoom), (float)SCR_WIDTH / (float)SCR_HEIGHT, 0.1f, 100.0f);
+		view = renderCamera.GetViewMatrix();
 		ourShader.setMat4("projection", projection);
 		ourShader.setMat4("view", view);
 
@@ -1446,63 +2118,31 @@ int main()
 		ourShader.setMat4("projection", projection);
 		ourShader.setMat4("view", view);
 		glm::mat4 modelP1 = glm::mat4(1.0f);
-		modelP1 = glm::translate(modelP1, player1Position);
-		modelP1 = glm::scale(modelP1, glm::vec3(.55f, .55f, .55f));
+		modelP1 = glm::translate(modelP1, renderState.player1Position);
+		modelP1 = glm::scale(modelP1, glm::vec3(fighterP1.definition.modelScale));
 		ourShader.setMat4("model", modelP1);
 
-		auto transformsP1 = player1_animator.GetFinalBoneMatrices();
-		for (int i = 0; i < transformsP1.size(); ++i) {
-			ourShader.setMat4("finalBonesMatrices[" + std::to_string(i) + "]", transformsP1[i]);
-		}
-		player1.Draw(ourShader);
+		bonePalettes.upload(0);
+		fighterP1.model.Draw(ourShader);
 
 		// Before drawing player 2
 		ourShader.use();  // Ensure shader is active when setting uniforms
 		ourShader.setMat4("projection", projection);
 		ourShader.setMat4("view", view);
 		glm::mat4 modelP2 = glm::mat4(1.0f);
-		modelP2 = glm::translate(modelP2, player2Position);
+		modelP2 = glm::translate(modelP2, renderState.player2Position);
 		modelP2 = glm::rotate(modelP2, glm::radians(180.0f), glm::vec3(0.0f, 1.0f, 0.0f)); // Rotate 180 degrees around the y-axis
-		modelP2 = glm::scale(modelP2, glm::vec3(.6f, .6f, .6f));
+		modelP2 = glm::scale(modelP2, glm::vec3(fighterP2.definition.modelScale));
 		ourShader.setMat4("model", modelP2);
 
-		auto transformsP2 = player2_animator.GetFinalBoneMatrices();
-		for (int i = 0; i < transformsP2.size(); ++i) {
-			ourShader.setMat4("finalBonesMatrices[" + std::to_string(i) + "]", transformsP2[i]);
-		}
-		player2.Draw(ourShader);
+		bonePalettes.upload(1);
+		fighterP2.model.Draw(ourShader);
 
-		skybox.draw(view, projection);
+		crowdTime += deltaTime;
+		crowdP1.draw(crowdShader, view, projection, crowdTime);
+		crowdP2.draw(crowdShader, view, projection, crowdTime);
 
-		switch (currentState) {
-		case GAME_INTRO:
-		case INTRO_P1:
-			
-		case INTRO_P2:
-
-		case TRANSITION_TO_GAMEPLAY:
-			updateIntroCamera(window, deltaTime);
-			break;
-		case START_ROUND:
-			startCountdown();
-			if (soundEngine->isCurrentlyPlaying(BGM) == false)
-				soundEngine->play2D(BGM, true);
-			break;
-		case GAMEPLAY:
-			// Gameplay logic
-			updateCapsules();
-			handleCollisions(window, deltaTime);
-			UpdateStateP1(window, player1_animator, P1charState, blendAmountP1);
-			UpdateStateP2(window, player2_animator, P2charState, blendAmountP2);
-			updateGameplay();
-			
-			break;
-
-		case P1_WINS:
-		case P2_WINS:
-			updateEndCamera(window, deltaTime);
-			break;
-		}
+		skybox.draw(view, projection);
 
 		if (currentState >= GAMEPLAY) {
 			RenderHealthBars(UIShader, healthBarTexture, healthBarBorderTexture);
@@ -1516,8 +2156,18 @@ int main()
 		// -------------------------------------------------------------------------------
 		glfwSwapBuffers(window);
 		glfwPollEvents();
+
+		static ProfileCounter s_FrameAllocations("Heap allocations (main thread)");
+		static long long lastAllocationCount = AllocationCounter::GetThreadCount();
+		long long allocationCount = AllocationCounter::GetThreadCount();
+		s_FrameAllocations.Increment(allocationCount - lastAllocationCount);
+		lastAllocationCount = allocationCount;
+		ProfileSection::EndFrame();
 	}
 
+	fighterP1.animator.SetPaletteTarget(nullptr);
+	fighterP2.animator.SetPaletteTarget(nullptr);
+
 	// glfw: terminate, clearing all previously allocated GLFW resources.
 	// ------------------------------------------------------------------
 	glfwTerminate();
@@ -1530,16 +2180,10 @@ void processInput(GLFWwindow* window)
 {
 	
 
-	if (glfwGetKey(window, GLFW_KEY_1) == GLFW_PRESS)
-		player1_animator.PlayAnimation(&idleAnimationP1, NULL, 0.0f, 0.0f, 0.0f);
-	if (glfwGetKey(window, GLFW_KEY_2) == GLFW_PRESS)
-		player1_animator.PlayAnimation(&walkFrontAnimationP1, NULL, 0.0f, 0.0f, 0.0f);
-	if (glfwGetKey(window, GLFW_KEY_3) == GLFW_PRESS)
-		player1_animator.PlayAnimation(&punchAnimationP1, NULL, 0.0f, 0.0f, 0.0f);
-	if (glfwGetKey(window, GLFW_KEY_4) == GLFW_PRESS)
-		player1_animator.PlayAnimation(&kickAnimationP1, NULL, 0.0f, 0.0f, 0.0f);
-	if (glfwGetKey(window, GLFW_KEY_5) == GLFW_PRESS)
-		player1_animator.PlayAnimation(&walkBackAnimationP1, NULL, 0.0f, 0.0f, 0.0f);
+	// 1-9 play Player 1's clips in the order the definition lists them
+	for (int i = 0; i < 9 && i < (int)fighterP1.clips.size(); i++)
+		if (glfwGetKey(window, GLFW_KEY_1 + i) == GLFW_PRESS)
+			fighterP1.animator.PlayAnimation(&fighterP1.clips[i], NULL, 0.0f, 0.0f, 0.0f);
 	
 	
 	if (glfwGetKey(window, GLFW_KEY_I) == GLFW_PRESS)
@@ -1596,484 +2240,6 @@ void scroll_callback(GLFWwindow* window, double xoffset, double yoffset)
 }
 
 
-void UpdateStateP1(GLFWwindow* window, Animator& animator, AnimStateP1& charState, float& blendAmount)
-{
-	switch (charState) {
-	case P1_IDLE:
-		if (glfwGetKey(window, GLFW_KEY_D) == GLFW_PRESS) {
-			blendAmount = 0.0f;
-			player1Position.z += moveSpeed * deltaTime;
-			animator.PlayAnimation(&idleAnimationP1, &walkFrontAnimationP1, animator.m_CurrentTime, 0.0f, blendAmount);
-			charState = P1_IDLE_WALK_FRONT;
-		}
-		else if (glfwGetKey(window, GLFW_KEY_A) == GLFW_PRESS) {
-			blendAmount = 0.0f;
-			player1Position.z -= moveSpeed * deltaTime;
-			animator.PlayAnimation(&idleAnimationP1, &walkBackAnimationP1, animator.m_CurrentTime, 0.0f, blendAmount);
-			charState = P1_IDLE_WALK_BACK;
-		}
-		if (glfwGetKey(window, GLFW_KEY_V) == GLFW_PRESS) {
-			blendAmount = 0.0f;
-			animator.PlayAnimation(&idleAnimationP1, &punchAnimationP1, animator.m_CurrentTime, 0.0f, blendAmount);
-			charState = P1_IDLE_PUNCH;
-		}
-		if (glfwGetKey(window, GLFW_KEY_B) == GLFW_PRESS) {
-			blendAmount = 0.0f;
-			animator.PlayAnimation(&idleAnimationP1, &kickAnimationP1, animator.m_CurrentTime, 0.0f, blendAmount);
-			charState = P1_IDLE_KICK;
-		}
-		//printf("idle \n");
-		break;
-	case P1_IDLE_WALK_FRONT:
-		player1Position.z += moveSpeed * deltaTime;
-		blendAmount += blendRate;
-		blendAmount = fmod(blendAmount, 1.0f);
-		animator.PlayAnimation(&idleAnimationP1, &walkFrontAnimationP1, animator.m_CurrentTime, animator.m_CurrentTime2, blendAmount);
-		if (blendAmount > 0.9f) {
-			blendAmount = 0.0f;
-			float startTime = animator.m_CurrentTime2;
-			animator.PlayAnimation(&walkFrontAnimationP1, NULL, startTime, 0.0f, blendAmount);
-			charState = P1_WALK_FRONT;
-		}
-		//printf("idle_walk_front \n");
-		break;
-	case P1_IDLE_WALK_BACK:
-		player1Position.z -= moveSpeed * deltaTime;
-		blendAmount += blendRate;
-		blendAmount = fmod(blendAmount, 1.0f);
-		animator.PlayAnimation(&idleAnimationP1, &walkBackAnimationP1, animator.m_CurrentTime, animator.m_CurrentTime2, blendAmount);
-		if (blendAmount > 0.9f) {
-			blendAmount = 0.0f;
-			float startTime = animator.m_CurrentTime2;
-			animator.PlayAnimation(&walkBackAnimationP1, NULL, startTime, 0.0f, blendAmount);
-			charState = P1_WALK_BACK;
-		}
-		//printf("idle_walk_back \n");
-		break;
-	case P1_WALK_FRONT:
-		player1Position.z += moveSpeed * deltaTime;
-		animator.PlayAnimation(&walkFrontAnimationP1, NULL, animator.m_CurrentTime, animator.m_CurrentTime2, blendAmount);
-		if (glfwGetKey(window, GLFW_KEY_D) != GLFW_PRESS) {
-			charState = P1_WALK_FRONT_IDLE;
-
-		}
-		//printf("walking_front\n");
-		break;
-	case P1_WALK_BACK:
-		player1Position.z -= moveSpeed * deltaTime;
-		animator.PlayAnimation(&walkBackAnimationP1, NULL, animator.m_CurrentTime, animator.m_CurrentTime2, blendAmount);
-		if (glfwGetKey(window, GLFW_KEY_A) != GLFW_PRESS) {
-			charState = P1_WALK_BACK_IDLE;
-
-		}
-		//printf("walking_back\n");
-		break;
-	case P1_WALK_FRONT_IDLE:
-		blendAmount += blendRate;
-		blendAmount = fmod(blendAmount, 1.0f);
-		animator.PlayAnimation(&walkFrontAnimationP1, &idleAnimationP1, animator.m_CurrentTime, animator.m_CurrentTime2, blendAmount);
-		if (blendAmount > 0.9f) {
-			blendAmount = 0.0f;
-			float startTime = animator.m_CurrentTime2;
-			animator.PlayAnimation(&idleAnimationP1, NULL, startTime, 0.0f, blendAmount);
-			charState = P1_IDLE;
-		}
-		//printf("walk_front_idle \n");
-		break;
-	case P1_WALK_BACK_IDLE:
-		blendAmount += blendRate;
-		blendAmount = fmod(blendAmount, 1.0f);
-		animator.PlayAnimation(&walkBackAnimationP1, &idleAnimationP1, animator.m_CurrentTime, animator.m_CurrentTime2, blendAmount);
-		if (blendAmount > 0.9f) {
-			blendAmount = 0.0f;
-			float startTime = animator.m_CurrentTime2;
-			animator.PlayAnimation(&idleAnimationP1, NULL, startTime, 0.0f, blendAmount);
-			charState = P1_IDLE;
-		}
-		//printf("walk_back_idle \n");
-		break;
-	case P1_IDLE_PUNCH:
-		blendAmount += blendRate;
-		blendAmount = fmod(blendAmount, 1.0f);
-		animator.PlayAnimation(&idleAnimationP1, &punchAnimationP1, animator.m_CurrentTime, animator.m_CurrentTime2, blendAmount);
-		if (blendAmount > 0.9f) {
-			blendAmount = 0.0f;
-			float startTime = animator.m_CurrentTime2;
-			animator.PlayAnimation(&punchAnimationP1, NULL, startTime, 0.0f, blendAmount);
-			charState = P1_PUNCH_IDLE;
-		}
-
-		//printf("idle_punch\n")
-
-		break;
-	case P1_PUNCH_IDLE:
-		if (animator.m_CurrentTime > 0.6 * (punchAnimationP1.GetDuration() * 1.0f)) {
-			blendAmount += blendRate;
-			blendAmount = fmod(blendAmount, 1.0f);
-			animator.PlayAnimation(&punchAnimationP1, &idleAnimationP1, animator.m_CurrentTime, animator.m_CurrentTime2, blendAmount);
-			if (blendAmount > 0.8f) {
-				blendAmount = 0.0f;
-				float startTime = animator.m_CurrentTime2;
-				animator.PlayAnimation(&idleAnimationP1, NULL, startTime, 0.0f, blendAmount);
-				charState = P1_IDLE;
-			}
-			//printf("punch_idle \n");
-		}
-		else {
-			// punching
-			//printf("punching \n");
-		}
-		break;
-	case P1_IDLE_KICK:
-		blendAmount += blendRate;
-		blendAmount = fmod(blendAmount, 1.0f);
-		animator.PlayAnimation(&idleAnimationP1, &kickAnimationP1, animator.m_CurrentTime, animator.m_CurrentTime2, blendAmount);
-		if (blendAmount > 0.9f) {
-			blendAmount = 0.0f;
-			float startTime = animator.m_CurrentTime2;
-			animator.PlayAnimation(&kickAnimationP1, NULL, startTime, 0.0f, blendAmount);
-			charState = P1_KICK_IDLE;
-		}
-		//printf("idle_kick\n");
-		break;
-	case P1_KICK_IDLE:
-		if (animator.m_CurrentTime > 0.7f * kickAnimationP1.GetDuration()) {
-			blendAmount += blendRate;
-			blendAmount = fmod(blendAmount, 1.0f);
-			animator.PlayAnimation(&kickAnimationP1, &idleAnimationP1, animator.m_CurrentTime, animator.m_CurrentTime2, blendAmount);
-			if (blendAmount > 0.7f) {
-				blendAmount = 0.0f;
-				float startTime = animator.m_CurrentTime2;
-				animator.PlayAnimation(&idleAnimationP1, NULL, startTime, 0.0f, blendAmount);
-				charState = P1_IDLE;
-			}
-			//printf("kick_idle \n");
-		}
-		else {
-			// punching
-			//printf("kicking \n");
-		}
-		break;
-	case P1_IDLE_BLOCK:
-		blendAmount += blendRate * 2;
-		blendAmount = fmod(blendAmount, 1.0f);
-		animator.PlayAnimation(&idleAnimationP1, &blockAnimationP1, animator.m_CurrentTime, animator.m_CurrentTime2, blendAmount);
-		if (blendAmount > 0.7f) {
-			blendAmount = 0.0f;
-			float startTime = animator.m_CurrentTime2;
-			animator.PlayAnimation(&blockAnimationP1, NULL, startTime, 0.0f, blendAmount);
-			charState = P1_BLOCK_IDLE;
-		}
-		//printf("idle_block\n");
-		break;
-	case P1_BLOCK_IDLE:
-		if (animator.m_CurrentTime > 0.7f * (blockAnimationP1.GetDuration() * 0.5f)) {
-			blendAmount += blendRate;
-			blendAmount = fmod(blendAmount, 1.0f);
-			animator.PlayAnimation(&blockAnimationP1, &idleAnimationP1, animator.m_CurrentTime, animator.m_CurrentTime2, blendAmount);
-			if (blendAmount > 0.9f) {
-				blendAmount = 0.0f;
-				float startTime = animator.m_CurrentTime2;
-				animator.PlayAnimation(&idleAnimationP1, NULL, startTime, 0.0f, blendAmount);
-				charState = P1_IDLE;
-			}
-			//printf("block_idle \n");
-		}
-		else {
-			// punching
-			//printf("blocking \n");
-		}
-		break;
-	case P1_IDLE_HIT:
-		blendAmount += blendRate * 2;
-		blendAmount = fmod(blendAmount, 1.0f);
-		animator.PlayAnimation(&idleAnimationP1, &hitAnimationP1, animator.m_CurrentTime, animator.m_CurrentTime2, blendAmount);
-		if (blendAmount > 0.9f) {
-			blendAmount = 0.0f;
-			float startTime = animator.m_CurrentTime2;
-			animator.PlayAnimation(&hitAnimationP1, NULL, startTime, 0.0f, blendAmount);
-			charState = P1_HIT_IDLE;
-		}
-		if (P2charState == P2_IDLE_KICK)
-		{
-			if (soundEngine->isCurrentlyPlaying(kickSound) == false)
-			{
-				soundEngine->play2D(kickSound, false);
-			}
-		}
-		else
-		{
-			if (soundEngine->isCurrentlyPlaying(punchSound) == false)
-			{
-				soundEngine->play2D(punchSound, false);
-			}
-			
-		}
-		
-		//printf("idle_hit\n");
-		break;
-	case P1_HIT_IDLE:
-		if (animator.m_CurrentTime > 0.6f * hitAnimationP1.GetDuration()) {
-			blendAmount += blendRate;
-			blendAmount = fmod(blendAmount, 1.0f);
-			animator.PlayAnimation(&hitAnimationP1, &idleAnimationP1, animator.m_CurrentTime, animator.m_CurrentTime2, blendAmount);
-			if (blendAmount > 0.5f) {
-				blendAmount = 0.0f;
-				float startTime = animator.m_CurrentTime2;
-				animator.PlayAnimation(&idleAnimationP1, NULL, startTime, 0.0f, blendAmount);
-				charState = P1_IDLE;
-			}
-			//printf("hit_idle \n");
-		}
-		else {
-			// punching
-			//printf("blocking \n");
-		}
-		break;
-	}
-}
-
-
-	void UpdateStateP2(GLFWwindow* window, Animator& animator, AnimStateP2& charState, float& blendAmount)
-	{
-			
-		switch (charState) {
-		case P2_IDLE:
-			if (glfwGetKey(window, GLFW_KEY_LEFT) == GLFW_PRESS) {
-				blendAmount = 0.0f;
-				player2Position.z -= moveSpeed * deltaTime;
-				animator.PlayAnimation(&idleAnimationP2, &walkFrontAnimationP2, animator.m_CurrentTime, 0.0f, blendAmount);
-				charState = P2_IDLE_WALK_FRONT;
-			}
-			else if (glfwGetKey(window, GLFW_KEY_RIGHT) == GLFW_PRESS) {
-				blendAmount = 0.0f;
-				player2Position.z += moveSpeed * deltaTime;
-				animator.PlayAnimation(&idleAnimationP2, &walkBackAnimationP2, animator.m_CurrentTime, 0.0f, blendAmount);
-				charState = P2_IDLE_WALK_BACK;
-			}
-
-
-			
-			if (glfwGetKey(window, GLFW_KEY_KP_1) == GLFW_PRESS) {
-				blendAmount = 0.0f;
-				animator.PlayAnimation(&idleAnimationP2, &punchAnimationP2, animator.m_CurrentTime, 0.0f, blendAmount);
-				charState = P2_IDLE_PUNCH;
-			}
-			if (glfwGetKey(window, GLFW_KEY_KP_2) == GLFW_PRESS) {
-				blendAmount = 0.0f;
-				animator.PlayAnimation(&idleAnimationP2, &kickAnimationP2, animator.m_CurrentTime, 0.0f, blendAmount);
-				charState = P2_IDLE_KICK;
-			}
-			//printf("idle \n");
-			break;
-		case  P2_IDLE_WALK_FRONT:
-			player2Position.z -= moveSpeed * deltaTime;
-			blendAmount += blendRate;
-			blendAmount = fmod(blendAmount, 1.0f);
-			animator.PlayAnimation(&idleAnimationP2, &walkFrontAnimationP2, animator.m_CurrentTime, animator.m_CurrentTime2, blendAmount);
-			if (blendAmount > 0.9f) {
-				blendAmount = 0.0f;
-				float startTime = animator.m_CurrentTime2;
-				animator.PlayAnimation(&walkFrontAnimationP2, NULL, startTime, 0.0f, blendAmount);
-				charState = P2_WALK_FRONT;
-			}
-			//printf("idle_walk_front \n");
-			break;
-		case  P2_IDLE_WALK_BACK:
-			player2Position.z += moveSpeed * deltaTime;
-			blendAmount += blendRate;
-			blendAmount = fmod(blendAmount, 1.0f);
-			animator.PlayAnimation(&idleAnimationP2, &walkBackAnimationP2, animator.m_CurrentTime, animator.m_CurrentTime2, blendAmount);
-			if (blendAmount > 0.8f) {
-				blendAmount = 0.0f;
-				float startTime = animator.m_CurrentTime2;
-				animator.PlayAnimation(&walkBackAnimationP2, NULL, startTime, 0.0f, blendAmount);
-				charState = P2_WALK_BACK;
-			}
-			//printf("idle_walk_back \n");
-			break;
-		case  P2_WALK_FRONT:
-			player2Position.z -= moveSpeed * deltaTime;
-			animator.PlayAnimation(&walkFrontAnimationP2, NULL, animator.m_CurrentTime, animator.m_CurrentTime2, blendAmount);
-			if (glfwGetKey(window, GLFW_KEY_LEFT) != GLFW_PRESS) {
-				charState = P2_WALK_FRONT_IDLE;
-
-			}
-			//printf("walking_front\n");
-			break;
-		case  P2_WALK_BACK:
-			player2Position.z += moveSpeed * deltaTime;
-			animator.PlayAnimation(&walkBackAnimationP2, NULL, animator.m_CurrentTime, animator.m_CurrentTime2, blendAmount);
-			if (glfwGetKey(window, GLFW_KEY_RIGHT) != GLFW_PRESS) {
-				charState = P2_WALK_BACK_IDLE;
-
-			}
-			//printf("walking_back\n");
-			break;
-		case  P2_WALK_FRONT_IDLE:
-			blendAmount += blendRate;
-			blendAmount = fmod(blendAmount, 1.0f);
-			animator.PlayAnimation(&walkFrontAnimationP2, &idleAnimationP2, animator.m_CurrentTime, animator.m_CurrentTime2, blendAmount);
-			if (blendAmount > 0.8f) {
-				blendAmount = 0.0f;
-				float startTime = animator.m_CurrentTime2;
-				animator.PlayAnimation(&idleAnimationP2, NULL, startTime, 0.0f, blendAmount);
-				charState = P2_IDLE;
-			}
-			//printf("walk_front_idle \n");
-			break;
-		case  P2_WALK_BACK_IDLE:
-			blendAmount += blendRate;
-			blendAmount = fmod(blendAmount, 1.0f);
-			animator.PlayAnimation(&walkBackAnimationP2, &idleAnimationP2, animator.m_CurrentTime, animator.m_CurrentTime2, blendAmount);
-			if (blendAmount > 0.9f) {
-				blendAmount = 0.0f;
-				float startTime = animator.m_CurrentTime2;
-				animator.PlayAnimation(&idleAnimationP2, NULL, startTime, 0.0f, blendAmount);
-				charState = P2_IDLE;
-			}
-			//printf("walk_back_idle \n");
-			break;
-		case  P2_IDLE_PUNCH:
-			blendAmount += blendRate;
-			blendAmount = fmod(blendAmount, 1.0f);
-			animator.PlayAnimation(&idleAnimationP2, &punchAnimationP2, animator.m_CurrentTime, animator.m_CurrentTime2, blendAmount);
-			if (blendAmount > 0.8f) {
-				blendAmount = 0.0f;
-				float startTime = animator.m_CurrentTime2;
-				animator.PlayAnimation(&punchAnimationP2, NULL, startTime, 0.0f, blendAmount);
-				charState = P2_PUNCH_IDLE;
-			}
-			
-			//printf("idle_punch\n");
-			break;
-		case  P2_PUNCH_IDLE:
-			if (animator.m_CurrentTime > 0.65 * punchAnimationP2.GetDuration()) {
-				blendAmount += blendRate;
-				blendAmount = fmod(blendAmount, 1.0f);
-				animator.PlayAnimation(&punchAnimationP2, &idleAnimationP2, animator.m_CurrentTime, animator.m_CurrentTime2, blendAmount);
-				if (blendAmount > 0.7f) {
-					blendAmount = 0.0f;
-					float startTime = animator.m_CurrentTime2;
-					animator.PlayAnimation(&idleAnimationP2, NULL, startTime, 0.0f, blendAmount);
-					charState = P2_IDLE;
-				}
-				//printf("punch_idle \n");
-			}
-			else {
-				// punching
-				//printf("punching \n");
-			}
-			break;
-		case  P2_IDLE_KICK:
-			blendAmount += blendRate;
-			blendAmount = fmod(blendAmount, 1.0f);
-			animator.PlayAnimation(&idleAnimationP2, &kickAnimationP2, animator.m_CurrentTime, animator.m_CurrentTime2, blendAmount);
-			if (blendAmount > 0.9f) {
-				blendAmount = 0.0f;
-				float startTime = animator.m_CurrentTime2;
-				animator.PlayAnimation(&kickAnimationP2, NULL, startTime, 0.0f, blendAmount);
-				charState = P2_KICK_IDLE;
-			}
-			//printf("idle_kick\n");
-			break;
-		case  P2_KICK_IDLE:
-			if (animator.m_CurrentTime > 0.6f * kickAnimationP2.GetDuration()) {
-				blendAmount += blendRate;
-				blendAmount = fmod(blendAmount, 1.0f);
-				animator.PlayAnimation(&kickAnimationP2, &idleAnimationP2, animator.m_CurrentTime, animator.m_CurrentTime2, blendAmount);
-				if (blendAmount > 0.7f) {
-					blendAmount = 0.0f;
-					float startTime = animator.m_CurrentTime2;
-					animator.PlayAnimation(&idleAnimationP2, NULL, startTime, 0.0f, blendAmount);
-					charState = P2_IDLE;
-				}
-				//printf("kick_idle \n");
-			}
-			else {
-				// punching
-				//printf("kicking \n");
-			}
-			break;
-		case  P2_IDLE_BLOCK:
-			blendAmount += blendRate * 2;
-			blendAmount = fmod(blendAmount, 1.0f);
-			animator.PlayAnimation(&idleAnimationP2, &blockAnimationP2, animator.m_CurrentTime, animator.m_CurrentTime2, blendAmount);
-			if (blendAmount > 0.9f) {
-				blendAmount = 0.0f;
-				float startTime = animator.m_CurrentTime2;
-				animator.PlayAnimation(&blockAnimationP2, NULL, startTime, 0.0f, blendAmount);
-				charState = P2_BLOCK_IDLE;
-			}
-			//printf("idle_block\n");
-			break;
-		case  P2_BLOCK_IDLE:
-			if (animator.m_CurrentTime > 0.7f * blockAnimationP2.GetDuration()) {
-				blendAmount += blendRate;
-				blendAmount = fmod(blendAmount, 1.0f);
-				animator.PlayAnimation(&blockAnimationP2, &idleAnimationP2, animator.m_CurrentTime, animator.m_CurrentTime2, blendAmount);
-				if (blendAmount > 0.7f) {
-					blendAmount = 0.0f;
-					float startTime = animator.m_CurrentTime2;
-					animator.PlayAnimation(&idleAnimationP2, NULL, startTime, 0.0f, blendAmount);
-					charState = P2_IDLE;
-				}
-				//printf("block_idle \n");
-			}
-			else {
-				// punching
-				//printf("blocking \n");
-			}
-			break;
-		case  P2_IDLE_HIT:
-			blendAmount += blendRate * 2;
-			blendAmount = fmod(blendAmount, 1.0f);
-			animator.PlayAnimation(&idleAnimationP2, &hitAnimationP2, animator.m_CurrentTime, animator.m_CurrentTime2, blendAmount);
-			if (blendAmount > 0.9f) {
-				blendAmount = 0.0f;
-				float startTime = animator.m_CurrentTime2;
-				animator.PlayAnimation(&hitAnimationP2, NULL, startTime, 0.0f, blendAmount);
-				charState = P2_HIT_IDLE;
-			}
-			if (P1charState == P1_IDLE_KICK)
-			{
-				if (soundEngine->isCurrentlyPlaying(kickSound) == false)
-				{
-					soundEngine->play2D(kickSound, false);
-				}
-			}
-			else
-			{
-				if (soundEngine->isCurrentlyPlaying(punchSound) == false)
-				{
-					soundEngine->play2D(punchSound, false);
-				}
-
-			}
-			//printf("idle_hit\n");
-			break;
-		case  P2_HIT_IDLE:
-			if (animator.m_CurrentTime > 0.6f * hitAnimationP2.GetDuration()) {
-				blendAmount += blendRate;
-				blendAmount = fmod(blendAmount, 1.0f);
-				animator.PlayAnimation(&hitAnimationP2, &idleAnimationP2, animator.m_CurrentTime, animator.m_CurrentTime2, blendAmount);
-				if (blendAmount > 0.5f) {
-					blendAmount = 0.0f;
-					float startTime = animator.m_CurrentTime2;
-					animator.PlayAnimation(&idleAnimationP2, NULL, startTime, 0.0f, blendAmount);
-					charState = P2_IDLE;
-				}
-				//printf("hit_idle \n");
-			}
-			else {
-				// punching
-				//printf("blocking \n");
-			}
-			break;
-		}
-	}
-	
-	
 // renderCube() renders a 1x1 3D cube in NDC.
 // -------------------------------------------------
 unsigned int cubeVAO = 0;
@@ -2265,7 +2431,8 @@ void RenderText(Shader& shader, std::string text, float x, float y, float scale,
 	glUseProgram(shader.ID); // Use text shader
 	glEnable(GL_BLEND);
 	glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA); // Ensure proper blending for text
-	glUniform3f(glGetUniformLocation(shader.ID, "textColor"), color.x, color.y, color.z);
+	static Shader::Uniform textColorUniform("textColor");
+	shader.setVec3(textColorUniform, color);
 	glActiveTexture(GL_TEXTURE0);
 	glBindVertexArray(textVAO);
 
@@ -2300,41 +2467,6 @@ void RenderText(Shader& shader, std::string text, float x, float y, float scale,
 
 }
 
-unsigned int loadTexture(char const* path) {
-	unsigned int textureID;
-	glGenTextures(1, &textureID);
-
-	int width, height, nrComponents;
-	unsigned char* data = stbi_load(path, &width, &height, &nrComponents, 0);
-	if (data) {
-		GLenum format;
-		if (nrComponents == 1)
-			format = GL_RED;
-		else if (nrComponents == 3)
-			format = GL_RGB;
-		else if (nrComponents == 4)
-			format = GL_RGBA;
-
-		glBindTexture(GL_TEXTURE_2D, textureID);
-		glTexImage2D(GL_TEXTURE_2D, 0, format, width, height, 0, format, GL_UNSIGNED_BYTE, data);
-		glGenerateMipmap(GL_TEXTURE_2D);
-
-		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
-		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
-		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
-		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-
-		stbi_image_free(data);
-	}
-	else {
-		std::cout << "Texture failed to load at path: " << path << std::endl;
-		stbi_image_free(data);
-	}
-
-	return textureID;
-}
-
-
 void initUIRendering() {
 	float vertices[] = {
 		// Positions   // Texture Coords
@@ -2369,13 +2501,15 @@ void RenderUIElement(Shader& shader, unsigned int texture, float x, float y, flo
 
 	// Set up an orthographic projection for UI rendering
 	glm::mat4 projection = glm::ortho(0.0f, (float)SCR_WIDTH, 0.0f, (float)SCR_HEIGHT);
-	shader.setMat4("projection", projection);
+	static Shader::Uniform projectionUniform("projection");
+	shader.setMat4(projectionUniform, projection);
 
 	// Transform for positioning and scaling the UI element
 	glm::mat4 model = glm::mat4(1.0f);
 	model = glm::translate(model, glm::vec3(x, y, 0.0f));
 	model = glm::scale(model, glm::vec3(width, height, 1.0f));
-	shader.setMat4("model", model);
+	static Shader::Uniform modelUniform("model");
+	shader.setMat4(modelUniform, model);
 
 	// Bind texture and render the quad
 	glActiveTexture(GL_TEXTURE0);
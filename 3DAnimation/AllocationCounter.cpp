@@ -0,0 +1,90 @@
+// AllocationCounter.cpp
+#include "AllocationCounter.h"
+#include <cstdlib>
+#include <new>
+#ifdef _WIN32
+#include <malloc.h>
+#endif
+
+namespace
+{
+	thread_local long long t_Allocations = 0;
+
+	void* CountedAlloc(std::size_t size)
+	{
+		t_Allocations++;
+		void* p = std::malloc(size ? size : 1);
+		if (!p)
+			throw std::bad_alloc();
+		return p;
+	}
+
+	void* CountedAllocNoThrow(std::size_t size) noexcept
+	{
+		t_Allocations++;
+		return std::malloc(size ? size : 1);
+	}
+
+#ifdef __cpp_aligned_new
+	void* CountedAlignedAllocNoThrow(std::size_t size, std::align_val_t alignment) noexcept
+	{
+		t_Allocations++;
+		size = size ? size : 1;
+#ifdef _WIN32
+		return _aligned_malloc(size, (std::size_t)alignment);
+#else
+		void* p = nullptr;
+		std::size_t align = (std::size_t)alignment < sizeof(void*) ? sizeof(void*) : (std::size_t)alignment;
+		return posix_memalign(&p, align, size) == 0 ? p : nullptr;
+#endif
+	}
+
+	void* CountedAlignedAlloc(std::size_t size, std::align_val_t alignment)
+	{
+		void* p = CountedAlignedAllocNoThrow(size, alignment);
+		if (!p)
+			throw std::bad_alloc();
+		return p;
+	}
+
+	void AlignedFree(void* p) noexcept
+	{
+#ifdef _WIN32
+		_aligned_free(p);
+#else
+		std::free(p);
+#endif
+	}
+#endif
+}
+
+long long AllocationCounter::GetThreadCount()
+{
+	return t_Allocations;
+}
+
+void* operator new(std::size_t size) { return CountedAlloc(size); }
+void* operator new[](std::size_t size) { return CountedAlloc(size); }
+void* operator new(std::size_t size, const std::nothrow_t&) noexcept { return CountedAllocNoThrow(size); }
+void* operator new[](std::size_t size, const std::nothrow_t&) noexcept { return CountedAllocNoThrow(size); }
+void operator delete(void* p) noexcept { std::free(p); }
+void operator delete[](void* p) noexcept { std::free(p); }
+void operator delete(void* p, std::size_t) noexcept { std::free(p); }
+void operator delete[](void* p, std::size_t) noexcept { std::free(p); }
+void operator delete(void* p, const std::nothrow_t&) noexcept { std::free(p); }
+void operator delete[](void* p, const std::nothrow_t&) noexcept { std::free(p); }
+
+// over-aligned types (alignas above the default) come through these once the language
+// standard has them; their blocks need the matching aligned free
+#ifdef __cpp_aligned_new
+void* operator new(std::size_t size, std::align_val_t alignment) { return CountedAlignedAlloc(size, alignment); }
+void* operator new[](std::size_t size, std::align_val_t alignment) { return CountedAlignedAlloc(size, alignment); }
+void* operator new(std::size_t size, std::align_val_t alignment, const std::nothrow_t&) noexcept { return CountedAlignedAllocNoThrow(size, alignment); }
+void* operator new[](std::size_t size, std::align_val_t alignment, const std::nothrow_t&) noexcept { return CountedAlignedAllocNoThrow(size, alignment); }
+void operator delete(void* p, std::align_val_t) noexcept { AlignedFree(p); }
+void operator delete[](void* p, std::align_val_t) noexcept { AlignedFree(p); }
+void operator delete(void* p, std::size_t, std::align_val_t) noexcept { AlignedFree(p); }
+void operator delete[](void* p, std::size_t, std::align_val_t) noexcept { AlignedFree(p); }
+void operator delete(void* p, std::align_val_t, const std::nothrow_t&) noexcept { AlignedFree(p); }
+void operator delete[](void* p, std::align_val_t, const std::nothrow_t&) noexcept { AlignedFree(p); }
+#endif
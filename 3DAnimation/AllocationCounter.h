@@ -0,0 +1,29 @@
+#pragma once
+
+/* Global allocation hook. AllocationCounter.cpp replaces operator new/delete (plain, nothrow
+   and aligned) so every heap allocation bumps a per-thread counter; NoAllocationScope uses it
+   to assert that a hot path (e.g. steady-state Animator::UpdateAnimation) never touches the
+   heap. The assert is gone where NDEBUG is set; --alloc-check counts in every build. */
+
+#include <cassert>
+
+class AllocationCounter
+{
+public:
+	// allocations made by the calling thread since it started
+	static long long GetThreadCount();
+};
+
+class NoAllocationScope
+{
+public:
+	NoAllocationScope() : m_Start(AllocationCounter::GetThreadCount()) {}
+
+	~NoAllocationScope()
+	{
+		assert(AllocationCounter::GetThreadCount() == m_Start && "heap allocation inside a no-allocation scope");
+	}
+
+private:
+	long long m_Start;
+};
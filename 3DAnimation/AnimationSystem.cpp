@@ -0,0 +1,191 @@
+// AnimationSystem.cpp
+#include "AnimationSystem.h"
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+
+AnimationSystem::AnimationSystem(JobSystem* jobs)
+	: m_Jobs(jobs)
+{
+	// full detail down to a quarter of the viewport's height, the floor under 2%
+	m_LodLevels = {
+		{ 0.25f, 1, false },
+		{ 0.12f, 1, true },
+		{ 0.05f, 2, true },
+		{ 0.02f, 4, true },
+		{ 0.0f, 8, true },
+	};
+}
+
+int AnimationSystem::Add(Animator& animator, glm::mat4* palette, ProfileSection* section)
+{
+	Character character = { &animator, -1, section, glm::vec3(0.0f), 1.8f, false, 1.0f, -1 };
+	if (palette)
+		animator.SetPaletteTarget(palette);
+	else
+	{
+		int stride = animator.GetFinalBoneMatrices().size();
+		assert(m_PaletteStride == 0 || m_PaletteStride == stride);
+		m_PaletteStride = stride;
+		character.ownPalette = m_OwnPaletteCount++;
+
+		const glm::mat4* previous = m_Palettes.data();
+		m_Palettes.resize((size_t)m_OwnPaletteCount * m_PaletteStride);
+		// the array moved: everyone already in it writes to the new ranges from now on
+		if (m_Palettes.data() != previous)
+		{
+			for (const Character& other : m_Characters)
+			{
+				if (other.ownPalette >= 0)
+					other.animator->SetPaletteTarget(&m_Palettes[(size_t)other.ownPalette * m_PaletteStride]);
+			}
+		}
+		animator.SetPaletteTarget(&m_Palettes[(size_t)character.ownPalette * m_PaletteStride]);
+	}
+	m_Characters.push_back(character);
+	return (int)m_Characters.size() - 1;
+}
+
+void AnimationSystem::Clear()
+{
+	for (const Character& character : m_Characters)
+	{
+		if (character.ownPalette >= 0)
+			character.animator->SetPaletteTarget(nullptr);
+	}
+	m_Characters.clear();
+	m_LodOrder.clear();
+	m_Palettes.clear();
+	m_OwnPaletteCount = 0;
+	m_PaletteStride = 0;
+}
+
+void AnimationSystem::Advance(float dt)
+{
+	for (const Character& character : m_Characters)
+		character.animator->Advance(dt);
+}
+
+void AnimationSystem::SetPlacement(int character, const glm::vec3& position, float height)
+{
+	m_Characters[character].position = position;
+	m_Characters[character].height = height;
+}
+
+float AnimationSystem::EstimateBones(const Character& character, int level) const
+{
+	const Skeleton* skeleton = character.animator->GetSkeleton();
+	if (!skeleton)
+		return 0.0f;
+	if (level < 0)
+		return (float)skeleton->GetNodeCount();
+	const AnimationLodLevel& lod = m_LodLevels[level];
+	int nodes = skeleton->GetNodeCount() - (lod.reducedBones ? skeleton->GetDetailNodeCount() : 0);
+	return (float)nodes / lod.updateInterval;
+}
+
+void AnimationSystem::SelectLods(const glm::mat4& view, const glm::mat4& projection)
+{
+	int lastLevel = (int)m_LodLevels.size() - 1;
+	float estimate = 0.0f;
+	m_LodOrder.clear();
+	for (int i = 0; i < (int)m_Characters.size(); i++)
+	{
+		Character& character = m_Characters[i];
+		character.lodLevel = -1;
+		if (!character.fullQuality && lastLevel >= 0)
+		{
+			// projected height at the character's middle: height * focal length / depth, over
+			// the 2 units of clip space; anything behind the camera takes the floor level
+			glm::vec4 middle = view * glm::vec4(character.position + glm::vec3(0.0f, character.height * 0.5f, 0.0f), 1.0f);
+			float depth = -middle.z;
+			character.screenHeight = depth > 0.0f ? character.height * projection[1][1] * 0.5f / depth : 0.0f;
+			character.lodLevel = lastLevel;
+			for (int level = 0; level < lastLevel; level++)
+			{
+				if (character.screenHeight >= m_LodLevels[level].minScreenHeight)
+				{
+					character.lodLevel = level;
+					break;
+				}
+			}
+			m_LodOrder.push_back(i);
+		}
+		estimate += EstimateBones(character, character.lodLevel);
+	}
+
+	// over budget: one level at a time off the smallest characters, until it fits or every
+	// character that may drop is at the floor
+	if (m_BoneBudget > 0 && estimate > m_BoneBudget)
+	{
+		std::sort(m_LodOrder.begin(), m_LodOrder.end(), [this](int a, int b) {
+			return m_Characters[a].screenHeight < m_Characters[b].screenHeight;
+		});
+		bool lowered = true;
+		while (estimate > m_BoneBudget && lowered)
+		{
+			lowered = false;
+			for (int i : m_LodOrder)
+			{
+				Character& character = m_Characters[i];
+				if (character.lodLevel >= lastLevel)
+					continue;
+				estimate += EstimateBones(character, character.lodLevel + 1) - EstimateBones(character, character.lodLevel);
+				character.lodLevel++;
+				lowered = true;
+				if (estimate <= m_BoneBudget)
+					break;
+			}
+		}
+	}
+	m_EstimatedBones = (int)std::ceil(estimate);
+
+	for (int i = 0; i < (int)m_Characters.size(); i++)
+	{
+		const Character& character = m_Characters[i];
+		// the index staggers the sampled frames of characters on the same interval
+		if (character.lodLevel < 0)
+			character.animator->SetLod(1, false);
+		else
+			character.animator->SetLod(m_LodLevels[character.lodLevel].updateInterval, m_LodLevels[character.lodLevel].reducedBones, i);
+	}
+}
+
+void AnimationSystem::EvaluatePoses(float alpha)
+{
+	static ProfileSection s_Poses("Animation system: poses", "character");
+	int count = (int)m_Characters.size();
+	if (count == 0)
+		return;
+	ProfileScope profile(s_Poses, count);
+
+	int batches = std::min((int)GetThreadCount(), (count + m_MinBatchSize - 1) / m_MinBatchSize);
+	if (batches <= 1)
+	{
+		EvaluateBatch(0, count, alpha);
+		return;
+	}
+	for (int batch = 1; batch < batches; batch++)
+	{
+		int first = count * batch / batches;
+		int last = count * (batch + 1) / batches;
+		m_Jobs->Submit([this, first, last, alpha] { EvaluateBatch(first, last, alpha); });
+	}
+	EvaluateBatch(0, count / batches, alpha);
+	m_Jobs->WaitAll();
+}
+
+void AnimationSystem::EvaluateBatch(int first, int last, float alpha)
+{
+	for (int i = first; i < last; i++)
+	{
+		const Character& character = m_Characters[i];
+		if (character.section)
+		{
+			ProfileScope profile(*character.section);
+			character.animator->EvaluatePose(alpha);
+		}
+		else
+			character.animator->EvaluatePose(alpha);
+	}
+}
@@ -0,0 +1,109 @@
+#pragma once
+
+/* Poses every animated character in one call, spread over a JobSystem's workers.
+   Characters are split into contiguous batches, one per thread, and the calling thread takes
+   the first batch itself, so a system without workers (or with fewer characters than one
+   batch) runs serially with no job overhead. Palettes sit back to back in one array - the
+   system's own, or an external one such as BonePaletteBuffer's staging - so each batch
+   writes one contiguous range of it.
+   Only pose evaluation runs in parallel: Advance stays on the calling thread because event
+   listeners act on game state. Clips may be shared between characters, since sampling a clip
+   changes nothing in it.
+   SelectLods gives each character a level of detail from its height on screen: smaller
+   characters sample their pose less often and skip finger and face bones (see Animator::SetLod).
+   With a bone budget, the smallest characters drop further levels until the estimated bones
+   sampled per frame fit it. Characters marked full quality never drop a level. */
+
+#include <vector>
+#include <glm/glm.hpp>
+#include "animator.h"
+#include "JobSystem.h"
+#include "Profiler.h"
+
+// one level of detail: used by characters at least minScreenHeight of the viewport tall
+struct AnimationLodLevel
+{
+	float minScreenHeight;
+	int updateInterval;
+	bool reducedBones;
+};
+
+class AnimationSystem
+{
+public:
+	// jobs may be null for a serial system; it must outlive the system's EvaluatePoses calls
+	explicit AnimationSystem(JobSystem* jobs = nullptr);
+
+	AnimationSystem(const AnimationSystem&) = delete;
+	AnimationSystem& operator=(const AnimationSystem&) = delete;
+
+	// Adds a character and returns its index. With palette null the animator poses into the
+	// system's own array, which grows (and re-targets every animator using it) as needed;
+	// otherwise into palette, which must hold GetFinalBoneMatrices().size() matrices.
+	// section, if given, times this character's pose on its own.
+	int Add(Animator& animator, glm::mat4* palette = nullptr, ProfileSection* section = nullptr);
+
+	// drops every character and hands the animators back their own palettes
+	void Clear();
+
+	// simulation tick for every character, in the order they were added
+	void Advance(float dt);
+
+	// render frame: every character's pose, alpha of the way between the last two ticks
+	void EvaluatePoses(float alpha);
+
+	// characters a batch must have before another thread is brought in; 1 spreads everything
+	void SetMinBatchSize(int characters) { m_MinBatchSize = characters > 0 ? characters : 1; }
+
+	// level of detail inputs: where the character stands (its feet) and how tall it is, in
+	// world units; full quality keeps it at every bone, every frame
+	void SetPlacement(int character, const glm::vec3& position, float height);
+	void SetFullQuality(int character, bool fullQuality) { m_Characters[character].fullQuality = fullQuality; }
+
+	// levels from the finest down, by decreasing minScreenHeight; the last one is the floor
+	void SetLodLevels(const std::vector<AnimationLodLevel>& levels) { m_LodLevels = levels; }
+	const std::vector<AnimationLodLevel>& GetLodLevels() const { return m_LodLevels; }
+
+	// bones sampled per frame, estimated over all characters, that SelectLods keeps under by
+	// lowering the smallest characters' levels; 0 for no budget
+	void SetBoneBudget(int bonesPerFrame) { m_BoneBudget = bonesPerFrame; }
+
+	// render frame, before EvaluatePoses: picks and applies every character's level for the camera
+	void SelectLods(const glm::mat4& view, const glm::mat4& projection);
+
+	// level index of a character after SelectLods, -1 while it is kept at full quality
+	int GetLodLevel(int character) const { return m_Characters[character].lodLevel; }
+	int GetEstimatedBones() const { return m_EstimatedBones; }
+
+	int GetCount() const { return (int)m_Characters.size(); }
+	Animator& GetAnimator(int character) { return *m_Characters[character].animator; }
+	unsigned int GetThreadCount() const { return (m_Jobs ? m_Jobs->GetWorkerCount() : 0) + 1; }
+
+private:
+	struct Character
+	{
+		Animator* animator;
+		int ownPalette;             // index of its range in m_Palettes, -1 for an external palette
+		ProfileSection* section;
+		glm::vec3 position;
+		float height;
+		bool fullQuality;
+		float screenHeight;     // fraction of the viewport, from the last SelectLods
+		int lodLevel;
+	};
+
+	void EvaluateBatch(int first, int last, float alpha);
+	// bones a character samples per frame, on average, at a level (-1 for full quality)
+	float EstimateBones(const Character& character, int level) const;
+
+	JobSystem* m_Jobs;
+	std::vector<Character> m_Characters;
+	std::vector<glm::mat4> m_Palettes;   // back-to-back ranges for the characters without a palette
+	int m_OwnPaletteCount = 0;
+	int m_PaletteStride = 0;
+	int m_MinBatchSize = 4;
+	std::vector<AnimationLodLevel> m_LodLevels;
+	int m_BoneBudget = 0;
+	int m_EstimatedBones = 0;
+	std::vector<int> m_LodOrder;   // SelectLods scratch: characters from the smallest on screen
+};
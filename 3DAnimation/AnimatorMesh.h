@@ -43,6 +43,7 @@ public:
     vector<unsigned int> indices;
     vector<Texture>      textures;
     unsigned int VAO;
+    size_t indexCount;
 
     // constructor
     AnimatorMesh(vector<Vertex> vertices, vector<unsigned int> indices, vector<Texture> textures)
@@ -52,47 +53,78 @@ public:
         this->textures = textures;
 
         // now that we have all the required data, set the vertex buffers and its attribute pointers.
-        setupMesh();
+        setupMesh(this->vertices.data(), this->vertices.size(), this->indices.data(), this->indices.size());
+    }
+
+    // uploads straight from caller-owned arrays (e.g. a mapped asset cache) without keeping
+    // a CPU copy, so vertices and indices stay empty
+    AnimatorMesh(const Vertex* vertexData, size_t vertexCount, const unsigned int* indexData, size_t indexCount, vector<Texture> textures)
+    {
+        this->textures = textures;
+        setupMesh(vertexData, vertexCount, indexData, indexCount);
     }
 
     // render the mesh
     void Draw(Shader& shader)
     {
         // bind appropriate textures
-        unsigned int diffuseNr = 1;
-        unsigned int specularNr = 1;
-        unsigned int normalNr = 1;
-        unsigned int heightNr = 1;
+        const GLint* samplerLocations = resolveSamplers(shader);
         for (unsigned int i = 0; i < textures.size(); i++)
         {
             glActiveTexture(GL_TEXTURE0 + i); // active proper texture unit before binding
-            // retrieve texture number (the N in diffuse_textureN)
-            string number;
-            string name = textures[i].type;
-            if (name == "texture_diffuse")
-                number = std::to_string(diffuseNr++);
-            else if (name == "texture_specular")
-                number = std::to_string(specularNr++); // transfer unsigned int to string
-            else if (name == "texture_normal")
-                number = std::to_string(normalNr++); // transfer unsigned int to string
-            else if (name == "texture_height")
-                number = std::to_string(heightNr++); // transfer unsigned int to string
-
             // now set the sampler to the correct texture unit
-            glUniform1i(glGetUniformLocation(shader.ID, (name + number).c_str()), i);
+            glUniform1i(samplerLocations[i], i);
             // and finally bind the texture
             glBindTexture(GL_TEXTURE_2D, textures[i].id);
         }
 
         // draw mesh
         glBindVertexArray(VAO);
-        glDrawElements(GL_TRIANGLES, static_cast<unsigned int>(indices.size()), GL_UNSIGNED_INT, 0);
+        glDrawElements(GL_TRIANGLES, static_cast<unsigned int>(indexCount), GL_UNSIGNED_INT, 0);
         glBindVertexArray(0);
 
         // always good practice to set everything back to defaults once configured.
         glActiveTexture(GL_TEXTURE0);
     }
 
+    // one draw of instanceCount copies through a VAO from createInstancedVAO
+    void DrawInstanced(Shader& shader, unsigned int instancedVAO, int instanceCount)
+    {
+        const GLint* samplerLocations = resolveSamplers(shader);
+        for (unsigned int i = 0; i < textures.size(); i++)
+        {
+            glActiveTexture(GL_TEXTURE0 + i);
+            glUniform1i(samplerLocations[i], i);
+            glBindTexture(GL_TEXTURE_2D, textures[i].id);
+        }
+
+        glBindVertexArray(instancedVAO);
+        glDrawElementsInstanced(GL_TRIANGLES, static_cast<unsigned int>(indexCount), GL_UNSIGNED_INT, 0, instanceCount);
+        glBindVertexArray(0);
+        glActiveTexture(GL_TEXTURE0);
+    }
+
+    // A second VAO over the mesh's own vertex and index buffers that also feeds attributes 7
+    // and 8 from a buffer of two vec4s per instance. The mesh's VAO is left alone, so regular
+    // draws never see the per-instance attributes. The caller owns the returned VAO.
+    unsigned int createInstancedVAO(unsigned int instanceBuffer)
+    {
+        unsigned int instancedVAO;
+        glGenVertexArrays(1, &instancedVAO);
+        glBindVertexArray(instancedVAO);
+        setVertexAttributes();
+        glBindBuffer(GL_ARRAY_BUFFER, instanceBuffer);
+        for (int i = 0; i < 2; i++)
+        {
+            glEnableVertexAttribArray(7 + i);
+            glVertexAttribPointer(7 + i, 4, GL_FLOAT, GL_FALSE, 2 * sizeof(glm::vec4), (void*)(i * sizeof(glm::vec4)));
+            glVertexAttribDivisor(7 + i, 1);
+        }
+        glBindVertexArray(0);
+        glBindBuffer(GL_ARRAY_BUFFER, 0);
+        return instancedVAO;
+    }
+
     void DrawPBR(Shader& shader) {
         unsigned int albedoNr = 1, normalNr = 1, metallicNr = 1, roughnessNr = 1, aoNr = 1;
 
@@ -117,7 +149,7 @@ public:
         }
 
         glBindVertexArray(VAO);
-        glDrawElements(GL_TRIANGLES, static_cast<unsigned int>(indices.size()), GL_UNSIGNED_INT, 0);
+        glDrawElements(GL_TRIANGLES, static_cast<unsigned int>(indexCount), GL_UNSIGNED_INT, 0);
         glBindVertexArray(0);
         glActiveTexture(GL_TEXTURE0);
     }
@@ -125,10 +157,63 @@ public:
 private:
     // render data 
     unsigned int VBO, EBO;
+    // sampler uniform of each texture (diffuse_textureN etc.), and its location in each
+    // program the mesh is drawn with (the fighter shader and the crowd shader, say)
+    struct SamplerLocations {
+        unsigned int program;
+        vector<GLint> locations;
+    };
+    vector<string> samplerNames;
+    vector<SamplerLocations> samplerPrograms;
+
+    // the names only depend on the texture list, so they are built once, and their locations
+    // are looked up once per program; drawing with several shaders in turn never misses
+    const GLint* resolveSamplers(Shader& shader)
+    {
+        if (samplerNames.size() != textures.size())
+            buildSamplerNames();
+        for (const SamplerLocations& resolved : samplerPrograms)
+            if (resolved.program == shader.ID)
+                return resolved.locations.data();
+
+        SamplerLocations resolved;
+        resolved.program = shader.ID;
+        for (const string& name : samplerNames)
+            resolved.locations.push_back(shader.getUniformLocation(name));
+        samplerPrograms.push_back(resolved);
+        return samplerPrograms.back().locations.data();
+    }
+
+    void buildSamplerNames()
+    {
+        unsigned int diffuseNr = 1;
+        unsigned int specularNr = 1;
+        unsigned int normalNr = 1;
+        unsigned int heightNr = 1;
+        samplerNames.clear();
+        samplerPrograms.clear();
+        for (unsigned int i = 0; i < textures.size(); i++)
+        {
+            // retrieve texture number (the N in diffuse_textureN)
+            string number;
+            string name = textures[i].type;
+            if (name == "texture_diffuse")
+                number = std::to_string(diffuseNr++);
+            else if (name == "texture_specular")
+                number = std::to_string(specularNr++); // transfer unsigned int to string
+            else if (name == "texture_normal")
+                number = std::to_string(normalNr++); // transfer unsigned int to string
+            else if (name == "texture_height")
+                number = std::to_string(heightNr++); // transfer unsigned int to string
+            samplerNames.push_back(name + number);
+        }
+    }
 
     // initializes all the buffer objects/arrays
-    void setupMesh()
+    void setupMesh(const Vertex* vertexData, size_t vertexCount, const unsigned int* indexData, size_t indexCount)
     {
+        this->indexCount = indexCount;
+
         // create buffers/arrays
         glGenVertexArrays(1, &VAO);
         glGenBuffers(1, &VBO);
@@ -140,10 +225,20 @@ private:
         // A great thing about structs is that their memory layout is sequential for all its items.
         // The effect is that we can simply pass a pointer to the struct and it translates perfectly to a glm::vec3/2 array which
         // again translates to 3/2 floats which translates to a byte array.
-        glBufferData(GL_ARRAY_BUFFER, vertices.size() * sizeof(Vertex), &vertices[0], GL_STATIC_DRAW);
+        glBufferData(GL_ARRAY_BUFFER, vertexCount * sizeof(Vertex), vertexData, GL_STATIC_DRAW);
 
         glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, EBO);
-        glBufferData(GL_ELEMENT_ARRAY_BUFFER, indices.size() * sizeof(unsigned int), &indices[0], GL_STATIC_DRAW);
+        glBufferData(GL_ELEMENT_ARRAY_BUFFER, indexCount * sizeof(unsigned int), indexData, GL_STATIC_DRAW);
+
+        setVertexAttributes();
+        glBindVertexArray(0);
+    }
+
+    // points attributes 0-6 of the bound VAO at VBO and attaches EBO to it
+    void setVertexAttributes()
+    {
+        glBindBuffer(GL_ARRAY_BUFFER, VBO);
+        glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, EBO);
 
         // set the vertex attribute pointers
         // vertex Positions
@@ -168,6 +263,5 @@ private:
         // weights
         glEnableVertexAttribArray(6);
         glVertexAttribPointer(6, 4, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)offsetof(Vertex, m_Weights));
-        glBindVertexArray(0);
     }
 };
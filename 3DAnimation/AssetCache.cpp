@@ -0,0 +1,247 @@
+// AssetCache.cpp
+#include "AssetCache.h"
+#include <fstream>
+#include <iostream>
+#include <sys/types.h>
+#include <sys/stat.h>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+
+namespace
+{
+	const uint32_t CacheMagic = 0x43575757; // "WWWC"
+
+	// 48 bytes, so the payload - and every 16-byte aligned array in it - stays aligned in the mapping
+	struct CacheHeader
+	{
+		uint32_t magic;
+		uint32_t version;
+		uint32_t kind;
+		uint32_t reserved;
+		uint64_t sourceSize;
+		int64_t sourceModified;
+		uint64_t payloadSize;
+		uint64_t padding;
+	};
+	static_assert(sizeof(CacheHeader) % 16 == 0, "cache payload must start 16-byte aligned");
+
+	bool HeaderMatches(const CacheHeader& header, AssetCache::Kind kind, uint64_t sourceSize, int64_t sourceModified, uint64_t fileSize)
+	{
+		return header.magic == CacheMagic && header.version == AssetCache::Version && header.kind == (uint32_t)kind
+			&& header.sourceSize == sourceSize && header.sourceModified == sourceModified
+			&& header.payloadSize == fileSize - sizeof(header);
+	}
+
+	bool s_Cooking = false;
+}
+
+bool AssetCache::GetSourceStamp(const std::string& path, uint64_t& size, int64_t& modified)
+{
+#ifdef _WIN32
+	struct _stat64 info;
+	if (_stat64(path.c_str(), &info) != 0)
+		return false;
+#else
+	struct stat info;
+	if (stat(path.c_str(), &info) != 0)
+		return false;
+#endif
+	size = (uint64_t)info.st_size;
+	modified = (int64_t)info.st_mtime;
+	return true;
+}
+
+uint64_t AssetCache::HashFile(const std::string& path)
+{
+	MappedFile file(path);
+	if (!file.GetData())
+		return 0;
+
+	const uint64_t prime = 1099511628211ull;
+	uint64_t hash = 14695981039346656037ull;
+	const char* bytes = file.GetData();
+	size_t i = 0;
+	for (; i + sizeof(uint64_t) <= file.GetSize(); i += sizeof(uint64_t))
+	{
+		uint64_t word;
+		std::memcpy(&word, bytes + i, sizeof(word));
+		hash = (hash ^ word) * prime;
+	}
+	for (; i < file.GetSize(); i++)
+		hash = (hash ^ (unsigned char)bytes[i]) * prime;
+	return hash;
+}
+
+void AssetCache::SetCooking(bool cooking) { s_Cooking = cooking; }
+bool AssetCache::IsCooking() { return s_Cooking; }
+
+bool AssetCache::IsCurrent(const std::string& sourcePath, Kind kind)
+{
+	uint64_t sourceSize = 0;
+	int64_t sourceModified = 0;
+	if (s_Cooking || !GetSourceStamp(sourcePath, sourceSize, sourceModified))
+		return false;
+
+	std::ifstream file(CachePath(sourcePath), std::ios::binary | std::ios::ate);
+	if (!file)
+		return false;
+	uint64_t fileSize = (uint64_t)file.tellg();
+	CacheHeader header;
+	file.seekg(0);
+	if (fileSize < sizeof(header) || !file.read(reinterpret_cast<char*>(&header), sizeof(header)))
+		return false;
+	return HeaderMatches(header, kind, sourceSize, sourceModified, fileSize);
+}
+
+ProfileCounter& AssetCache::Hits()
+{
+	static ProfileCounter counter("Asset cache hits");
+	return counter;
+}
+
+ProfileCounter& AssetCache::Misses()
+{
+	static ProfileCounter counter("Asset cache misses");
+	return counter;
+}
+
+ProfileCounter& AssetCache::Written()
+{
+	static ProfileCounter counter("Asset caches written");
+	return counter;
+}
+
+bool MappedFile::Open(const std::string& path)
+{
+	Close();
+#ifdef _WIN32
+	HANDLE file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, NULL);
+	if (file == INVALID_HANDLE_VALUE)
+		return false;
+	LARGE_INTEGER size;
+	if (!GetFileSizeEx(file, &size) || size.QuadPart == 0)
+	{
+		CloseHandle(file);
+		return false;
+	}
+	HANDLE mapping = CreateFileMappingA(file, NULL, PAGE_READONLY, 0, 0, NULL);
+	const void* view = mapping ? MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0) : NULL;
+	if (!view)
+	{
+		if (mapping)
+			CloseHandle(mapping);
+		CloseHandle(file);
+		return false;
+	}
+	m_File = file;
+	m_Mapping = mapping;
+	m_Data = static_cast<const char*>(view);
+	m_Size = (size_t)size.QuadPart;
+#else
+	int file = open(path.c_str(), O_RDONLY);
+	if (file < 0)
+		return false;
+	struct stat info;
+	if (fstat(file, &info) != 0 || info.st_size == 0)
+	{
+		close(file);
+		return false;
+	}
+	void* view = mmap(nullptr, (size_t)info.st_size, PROT_READ, MAP_PRIVATE, file, 0);
+	if (view == MAP_FAILED)
+	{
+		close(file);
+		return false;
+	}
+	m_File = file;
+	m_Data = static_cast<const char*>(view);
+	m_Size = (size_t)info.st_size;
+#endif
+	return true;
+}
+
+void MappedFile::Close()
+{
+#ifdef _WIN32
+	if (m_Data)
+		UnmapViewOfFile(m_Data);
+	if (m_Mapping)
+		CloseHandle(m_Mapping);
+	if (m_File)
+		CloseHandle(m_File);
+	m_Mapping = nullptr;
+	m_File = nullptr;
+#else
+	if (m_Data)
+		munmap(const_cast<char*>(m_Data), m_Size);
+	if (m_File >= 0)
+		close(m_File);
+	m_File = -1;
+#endif
+	m_Data = nullptr;
+	m_Size = 0;
+}
+
+bool CacheWriter::Save(const std::string& sourcePath, AssetCache::Kind kind) const
+{
+	CacheHeader header = {};
+	header.magic = CacheMagic;
+	header.version = AssetCache::Version;
+	header.kind = kind;
+	header.payloadSize = m_Payload.size();
+	if (!AssetCache::GetSourceStamp(sourcePath, header.sourceSize, header.sourceModified))
+		return false;
+
+	std::string cachePath = AssetCache::CachePath(sourcePath);
+	std::ofstream file(cachePath, std::ios::binary | std::ios::trunc);
+	file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+	file.write(m_Payload.data(), m_Payload.size());
+	if (!file)
+	{
+		std::cout << "ERROR::ASSET_CACHE::WRITE_FAILED " << cachePath << std::endl;
+		return false;
+	}
+	AssetCache::Written().Increment();
+	std::cout << "Cooked " << cachePath << " (" << sizeof(header) + m_Payload.size() << " bytes)" << std::endl;
+	return true;
+}
+
+bool CacheReader::Open(const std::string& sourcePath, AssetCache::Kind kind)
+{
+	m_Valid = false;
+	if (AssetCache::IsCooking())
+		return false;
+
+	uint64_t sourceSize = 0;
+	int64_t sourceModified = 0;
+	bool opened = AssetCache::GetSourceStamp(sourcePath, sourceSize, sourceModified)
+		&& m_File.Open(AssetCache::CachePath(sourcePath))
+		&& m_File.GetSize() >= sizeof(CacheHeader);
+	if (opened)
+	{
+		CacheHeader header;
+		std::memcpy(&header, m_File.GetData(), sizeof(header));
+		m_Valid = HeaderMatches(header, kind, sourceSize, sourceModified, m_File.GetSize());
+		m_Offset = sizeof(header);
+		m_End = m_File.GetSize();
+	}
+
+	if (!m_Valid)
+	{
+		if (opened)
+			std::cout << "Asset cache for " << sourcePath << " is stale, parsing the source" << std::endl;
+		m_File.Close();
+		AssetCache::Misses().Increment();
+		return false;
+	}
+	AssetCache::Hits().Increment();
+	return true;
+}
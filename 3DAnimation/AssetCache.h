@@ -0,0 +1,173 @@
+#pragma once
+
+/* Compiled binary cache for models and animation clips.
+   "--cook" loads every asset from its source file through Assimp and writes a
+   <source>.wwc file next to it. Later launches memory-map that file and hand its arrays
+   straight to GL / the clip buffers instead of parsing the source again.
+   Each cache records the format version and the source file's size and modification time.
+   If either differs, the cache is ignored and the source is parsed as before. */
+
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <vector>
+#include "Profiler.h"
+
+namespace AssetCache
+{
+	enum Kind : uint32_t
+	{
+		SkinnedModel = 1,
+		StaticModel = 2,
+		AnimationClip = 3,
+		IBLMaps = 4
+	};
+
+	// bump whenever anything written by a Save*Cache function changes shape
+	const uint32_t Version = 2;   // 2: clip caches carry the compressed keys
+
+	inline std::string CachePath(const std::string& sourcePath) { return sourcePath + ".wwc"; }
+
+	// size and modification time every cooked file is stamped with; false if the source is missing
+	bool GetSourceStamp(const std::string& path, uint64_t& size, int64_t& modified);
+
+	// FNV-1a of a whole file, for caches keyed by content rather than by timestamp; 0 if unreadable
+	uint64_t HashFile(const std::string& path);
+
+	// set by "--cook": loaders then skip existing caches and write fresh ones after parsing
+	void SetCooking(bool cooking);
+	bool IsCooking();
+
+	// header-only check that CacheReader::Open would accept the cache; counts neither hit nor miss
+	bool IsCurrent(const std::string& sourcePath, Kind kind);
+
+	ProfileCounter& Hits();
+	ProfileCounter& Misses();
+	ProfileCounter& Written();
+}
+
+// Read-only memory mapping of a whole file; empty if the file could not be opened.
+class MappedFile
+{
+public:
+	MappedFile() = default;
+	explicit MappedFile(const std::string& path) { Open(path); }
+	~MappedFile() { Close(); }
+
+	MappedFile(const MappedFile&) = delete;
+	MappedFile& operator=(const MappedFile&) = delete;
+
+	bool Open(const std::string& path);
+	void Close();
+
+	const char* GetData() const { return m_Data; }
+	size_t GetSize() const { return m_Size; }
+
+private:
+	const char* m_Data = nullptr;
+	size_t m_Size = 0;
+#ifdef _WIN32
+	void* m_File = nullptr;
+	void* m_Mapping = nullptr;
+#else
+	int m_File = -1;
+#endif
+};
+
+// Builds a cache file in memory. Arrays start on 16-byte boundaries so the reader can hand
+// out pointers into the mapping for any vertex or matrix type.
+class CacheWriter
+{
+public:
+	template <typename T>
+	void Write(const T& value)
+	{
+		Append(&value, sizeof(T));
+	}
+
+	template <typename T>
+	void WriteArray(const T* values, size_t count)
+	{
+		Align();
+		Append(values, sizeof(T) * count);
+	}
+
+	void WriteString(const std::string& text)
+	{
+		Write((uint32_t)text.size());
+		Append(text.data(), text.size());
+	}
+
+	// writes header + payload to CachePath(sourcePath), stamped with the source's size and mtime
+	bool Save(const std::string& sourcePath, AssetCache::Kind kind) const;
+
+private:
+	void Append(const void* data, size_t size)
+	{
+		const char* bytes = static_cast<const char*>(data);
+		m_Payload.insert(m_Payload.end(), bytes, bytes + size);
+	}
+
+	void Align()
+	{
+		while (m_Payload.size() % 16 != 0)
+			m_Payload.push_back(0);
+	}
+
+	std::vector<char> m_Payload;
+};
+
+// Walks a mapped cache file in the order its CacheWriter wrote it. Arrays and strings point
+// into the mapping, so they are only valid while the reader is alive.
+class CacheReader
+{
+public:
+	// maps CachePath(sourcePath) and checks it against the source; false means parse the source
+	bool Open(const std::string& sourcePath, AssetCache::Kind kind);
+
+	template <typename T>
+	T Read()
+	{
+		T value = T();
+		if (const char* data = Take(sizeof(T)))
+			std::memcpy(&value, data, sizeof(T));
+		return value;
+	}
+
+	// null once the file is exhausted; check before use
+	template <typename T>
+	const T* ReadArray(size_t count)
+	{
+		m_Offset = (m_Offset + 15) & ~size_t(15);
+		return reinterpret_cast<const T*>(Take(sizeof(T) * count));
+	}
+
+	std::string ReadString()
+	{
+		uint32_t length = Read<uint32_t>();
+		const char* data = Take(length);
+		return data ? std::string(data, length) : std::string();
+	}
+
+	// true while every read so far stayed inside the file
+	bool IsValid() const { return m_Valid; }
+
+private:
+	// a truncated or corrupt file fails here, and every read after it fails too
+	const char* Take(size_t size)
+	{
+		if (!m_Valid || m_Offset > m_End || size > m_End - m_Offset)
+		{
+			m_Valid = false;
+			return nullptr;
+		}
+		const char* data = m_File.GetData() + m_Offset;
+		m_Offset += size;
+		return data;
+	}
+
+	MappedFile m_File;
+	size_t m_Offset = 0;
+	size_t m_End = 0;
+	bool m_Valid = false;
+};
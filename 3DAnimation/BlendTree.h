@@ -0,0 +1,290 @@
+#pragma once
+
+/* Layered blend tree: any number of clips, mixed per layer and stacked layer over layer.
+   A layer holds weighted inputs and either overrides the layers below it (by its weight, times
+   a per-node mask weight) or adds its offset from a captured reference pose on top of them.
+   Evaluate samples every active input exactly once per driven node, straight into the layer's
+   accumulator, so the cost is one SampleChannel per (input, node) the layer actually uses.
+   Inputs and layers under the prune weight are skipped without being sampled at all, and a
+   masked layer never samples the nodes outside its mask - an upper-body punch over a walk
+   only pays for the spine and arms.
+   All inputs must be clips bound to the same model, i.e. share one Skeleton. */
+
+#include <algorithm>
+#include <cassert>
+#include <string>
+#include <vector>
+#include <glm/glm.hpp>
+#include <glm/gtc/quaternion.hpp>
+#include "animation.h"
+#include "skeleton.h"
+#include "pose.h"
+
+enum class BlendLayerMode
+{
+	Override,   // blends the layers below towards this layer's pose
+	Additive    // adds this layer's offset from its reference pose to the layers below
+};
+
+struct BlendInput
+{
+	Animation* clip;
+	float time;                 // in ticks, like the animator's clocks
+	float weight;               // relative to the other inputs of its layer
+	float tickAdvance = 0.0f;   // ticks the last Advance moved time by
+	bool startedFresh = true;   // reports an event sitting exactly on its start time
+	std::vector<KeyCursors> cursors;   // per clip channel, so the raw key lookup steps forward
+};
+
+struct BlendLayer
+{
+	BlendLayerMode mode = BlendLayerMode::Override;
+	float weight = 1.0f;
+	std::vector<BlendInput> inputs;
+	std::vector<float> mask;                // weight per node; empty means the whole skeleton
+	std::vector<BonePose> reference;        // Additive: pose the offsets are measured from
+	std::vector<unsigned char> hasReference;
+};
+
+class BlendTree
+{
+public:
+	// layers evaluate in the order they are added, each on top of the ones before it
+	int AddLayer(BlendLayerMode mode = BlendLayerMode::Override, float weight = 1.0f)
+	{
+		BlendLayer layer;
+		layer.mode = mode;
+		layer.weight = weight;
+		m_Layers.push_back(layer);
+		return (int)m_Layers.size() - 1;
+	}
+
+	// returns the input's index in its layer; time is in seconds
+	int AddInput(int layer, Animation* clip, float weight = 1.0f, float time = 0.0f)
+	{
+		if (!m_Skeleton)
+		{
+			m_Skeleton = &clip->GetSkeleton();
+			m_BoneOffsets = &clip->GetBoneOffsets();
+			// sized here, so Evaluate never allocates
+			m_Accumulators.resize(m_Skeleton->GetNodeCount());
+			m_Pose.resize(m_Skeleton->GetNodeCount());
+			m_Driven.resize(m_Skeleton->GetNodeCount());
+		}
+		assert(&clip->GetSkeleton() == m_Skeleton);
+
+		BlendInput input = { clip, time * clip->GetTicksPerSecond(), weight };
+		input.cursors.resize(clip->GetChannelCount());
+		m_Layers[layer].inputs.push_back(input);
+		return (int)m_Layers[layer].inputs.size() - 1;
+	}
+
+	void SetInputWeight(int layer, int input, float weight) { m_Layers[layer].inputs[input].weight = weight; }
+	void SetLayerWeight(int layer, float weight) { m_Layers[layer].weight = weight; }
+
+	// Limits a layer to rootNode and everything below it, e.g. "mixamorig_Spine" for the upper
+	// body. Returns false (and leaves the layer unmasked) if the skeleton has no such node.
+	bool SetLayerMask(int layer, const Skeleton& skeleton, const std::string& rootNode, float weight = 1.0f)
+	{
+		int root = skeleton.FindNode(rootNode);
+		if (root < 0)
+			return false;
+
+		std::vector<float>& mask = m_Layers[layer].mask;
+		mask.assign(skeleton.GetNodeCount(), 0.0f);
+		const int* parents = skeleton.GetParents();
+		mask[root] = weight;
+		// parents precede children, so a subtree is everything whose parent is already in it
+		for (int node = root + 1; node < skeleton.GetNodeCount(); node++)
+		{
+			if (parents[node] >= root && mask[parents[node]] > 0.0f)
+				mask[node] = weight;
+		}
+		return true;
+	}
+
+	void ClearLayerMask(int layer) { m_Layers[layer].mask.clear(); }
+
+	// captures the pose an additive layer's offsets are measured from, typically the first
+	// frame of the additive clip itself; time is in seconds
+	void SetAdditiveReference(int layer, Animation* clip, float time = 0.0f)
+	{
+		assert(&clip->GetSkeleton() == m_Skeleton);
+		BlendLayer& target = m_Layers[layer];
+		int nodeCount = m_Skeleton->GetNodeCount();
+		target.reference.assign(nodeCount, BonePose());
+		target.hasReference.assign(nodeCount, 0);
+		for (int node = 0; node < nodeCount; node++)
+		{
+			int channel = clip->GetChannelForNode(node);
+			if (channel < 0)
+				continue;
+			clip->SampleChannel(channel, time * clip->GetTicksPerSecond(), target.reference[node]);
+			target.hasReference[node] = 1;
+		}
+	}
+
+	// inputs and layers weighing less than this are neither sampled nor reported
+	void SetPruneWeight(float weight) { m_PruneWeight = weight; }
+
+	// Moves every input's clock on by dt seconds, pruned ones included so a clip coming back
+	// in stays in step. report(clip, from, to, wrapped, includeFrom) is called for the inputs
+	// that count towards the pose, with the same arguments Animation::ForEachEventCrossed takes.
+	template <typename Reporter>
+	void Advance(float dt, Reporter report)
+	{
+		for (BlendLayer& layer : m_Layers)
+		{
+			for (BlendInput& input : layer.inputs)
+			{
+				float duration = input.clip->GetDuration();
+				float previousTime = input.time;
+				input.tickAdvance = input.clip->GetTicksPerSecond() * dt * input.clip->GetSpeed();
+				input.time += input.tickAdvance;
+				bool wrapped = input.time >= duration;
+				input.time = fmod(input.time, duration);
+				if (layer.weight >= m_PruneWeight && input.weight >= m_PruneWeight)
+				{
+					report(*input.clip, previousTime, input.time, wrapped, input.startedFresh);
+					input.startedFresh = false;
+				}
+			}
+		}
+	}
+
+	// Builds the local pose alpha of the way from the previous Advance to the latest one.
+	// Afterwards GetPose()[node] holds the node's local pose wherever IsDriven(node); nodes no
+	// layer drives keep their bind transform. A node an override layer reaches first takes that
+	// layer's pose outright, and additive layers only offset nodes a layer below them drives.
+	// Nodes flagged in skipNodes (one flag per node, or null) are never sampled.
+	void Evaluate(float alpha, const unsigned char* skipNodes = nullptr)
+	{
+		m_SampledChannels = 0;
+		m_PrunedInputs = 0;
+		if (!m_Skeleton)
+			return;
+		int nodeCount = m_Skeleton->GetNodeCount();
+		std::fill(m_Driven.begin(), m_Driven.end(), (unsigned char)0);
+
+		for (BlendLayer& layer : m_Layers)
+		{
+			float totalWeight = 0.0f;
+			for (const BlendInput& input : layer.inputs)
+			{
+				if (input.weight >= m_PruneWeight)
+					totalWeight += input.weight;
+			}
+			if (layer.weight < m_PruneWeight || totalWeight <= 0.0f)
+			{
+				m_PrunedInputs += (int)layer.inputs.size();
+				continue;
+			}
+
+			const float* mask = layer.mask.empty() ? nullptr : layer.mask.data();
+			std::fill(m_Accumulators.begin(), m_Accumulators.end(), PoseAccumulator());
+			for (BlendInput& input : layer.inputs)
+			{
+				if (input.weight < m_PruneWeight)
+				{
+					m_PrunedInputs++;
+					continue;
+				}
+				float weight = input.weight / totalWeight;
+				float time = WrapTime(input.time - (1.0f - alpha) * input.tickAdvance, input.clip->GetDuration());
+				for (int node = 0; node < nodeCount; node++)
+				{
+					if ((mask && mask[node] <= 0.0f) || (skipNodes && skipNodes[node]))
+						continue;
+					int channel = input.clip->GetChannelForNode(node);
+					if (channel < 0)
+						continue;
+					BonePose pose;
+					input.clip->SampleChannel(channel, time, pose, input.cursors.data());
+					m_SampledChannels++;
+					Accumulate(m_Accumulators[node], pose, weight);
+				}
+			}
+
+			for (int node = 0; node < nodeCount; node++)
+			{
+				const PoseAccumulator& accumulator = m_Accumulators[node];
+				if (accumulator.weight <= 0.0f)
+					continue;
+				// inputs without a track for this node drop out, the rest share its weight
+				BonePose pose;
+				pose.translation = accumulator.translation / accumulator.weight;
+				pose.rotation = glm::normalize(accumulator.rotation);
+				pose.scale = accumulator.scale / accumulator.weight;
+				float weight = layer.weight * (mask ? mask[node] : 1.0f);
+
+				if (layer.mode == BlendLayerMode::Override)
+				{
+					if (!m_Driven[node])
+						m_Pose[node] = pose;
+					else
+						PoseMath::Blend(m_Pose[node], pose, glm::min(weight, 1.0f), m_Pose[node]);
+					m_Driven[node] = 1;
+				}
+				else if (m_Driven[node] && !layer.hasReference.empty() && layer.hasReference[node])
+					ApplyAdditive(m_Pose[node], layer.reference[node], pose, weight);
+			}
+		}
+	}
+
+	const Skeleton* GetSkeleton() const { return m_Skeleton; }
+	const std::vector<AffineTransform>& GetBoneOffsets() const { return *m_BoneOffsets; }
+	const BonePose* GetPose() const { return m_Pose.data(); }
+	bool IsDriven(int node) const { return m_Driven[node] != 0; }
+	int GetLayerCount() const { return (int)m_Layers.size(); }
+	const BlendLayer& GetLayer(int layer) const { return m_Layers[layer]; }
+
+	// from the last Evaluate: channels sampled, and inputs skipped for weighing too little
+	int GetSampledChannels() const { return m_SampledChannels; }
+	int GetPrunedInputs() const { return m_PrunedInputs; }
+
+private:
+	// weighted sum of the inputs sampled so far for one node
+	struct PoseAccumulator
+	{
+		glm::vec3 translation = glm::vec3(0.0f);
+		glm::quat rotation = glm::quat(0.0f, 0.0f, 0.0f, 0.0f);
+		glm::vec3 scale = glm::vec3(0.0f);
+		float weight = 0.0f;
+	};
+
+	static void Accumulate(PoseAccumulator& accumulator, const BonePose& pose, float weight)
+	{
+		// q and -q are the same rotation; keep every input on the first one's side so the
+		// normalized sum does not cancel out
+		float side = glm::dot(accumulator.rotation, pose.rotation) < 0.0f ? -1.0f : 1.0f;
+		accumulator.translation += pose.translation * weight;
+		accumulator.rotation = accumulator.rotation + pose.rotation * (weight * side);
+		accumulator.scale += pose.scale * weight;
+		accumulator.weight += weight;
+	}
+
+	// adds weight x (pose - reference) to base, in the node's local space
+	static void ApplyAdditive(BonePose& base, const BonePose& reference, const BonePose& pose, float weight)
+	{
+		glm::quat delta = glm::inverse(reference.rotation) * pose.rotation;
+		base.translation += (pose.translation - reference.translation) * weight;
+		base.rotation = glm::normalize(base.rotation * glm::slerp(glm::quat(1.0f, 0.0f, 0.0f, 0.0f), delta, weight));
+		base.scale *= glm::mix(glm::vec3(1.0f), pose.scale / reference.scale, weight);
+	}
+
+	static float WrapTime(float time, float duration)
+	{
+		time = fmod(time, duration);
+		return time < 0.0f ? time + duration : time;
+	}
+
+	std::vector<BlendLayer> m_Layers;
+	const Skeleton* m_Skeleton = nullptr;
+	const std::vector<AffineTransform>* m_BoneOffsets = nullptr;
+	std::vector<PoseAccumulator> m_Accumulators;
+	std::vector<BonePose> m_Pose;
+	std::vector<unsigned char> m_Driven;
+	float m_PruneWeight = 0.01f;
+	int m_SampledChannels = 0;
+	int m_PrunedInputs = 0;
+};
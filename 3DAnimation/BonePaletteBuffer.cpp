@@ -0,0 +1,55 @@
+// BonePaletteBuffer.cpp
+#include "BonePaletteBuffer.h"
+#include <iostream>
+
+BonePaletteBuffer::BonePaletteBuffer(int characterCount, int bonesPerCharacter)
+    : characterCount(characterCount), bonesPerCharacter(bonesPerCharacter) {
+    GLint alignment = 0;
+    glGetIntegerv(GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT, &alignment);
+    // alignments are powers of two, so padding to whole matrices keeps every range aligned
+    GLint matrixBytes = (GLint)sizeof(glm::mat4);
+    GLint granularity = alignment > matrixBytes ? alignment : matrixBytes;
+    GLint strideBytes = (bonesPerCharacter * matrixBytes + granularity - 1) / granularity * granularity;
+    strideMatrices = strideBytes / matrixBytes;
+
+    staging.assign(strideMatrices * characterCount, glm::mat4(1.0f));
+
+    glGenBuffers(1, &paletteUBO);
+    glBindBuffer(GL_UNIFORM_BUFFER, paletteUBO);
+    glBufferData(GL_UNIFORM_BUFFER, staging.size() * sizeof(glm::mat4), staging.data(), GL_DYNAMIC_DRAW);
+    glBindBuffer(GL_UNIFORM_BUFFER, 0);
+
+    std::cout << "Bone palette UBO: " << characterCount << " characters x " << strideBytes << " bytes" << std::endl;
+}
+
+BonePaletteBuffer::~BonePaletteBuffer() {
+    glDeleteBuffers(1, &paletteUBO);
+}
+
+void BonePaletteBuffer::bindBlock(unsigned int shaderProgram, const char* blockName) {
+    unsigned int blockIndex = glGetUniformBlockIndex(shaderProgram, blockName);
+    if (blockIndex == GL_INVALID_INDEX) {
+        std::cout << "ERROR::BONE_PALETTE::BLOCK_NOT_FOUND " << blockName << std::endl;
+        return;
+    }
+    glUniformBlockBinding(shaderProgram, blockIndex, BindingPoint);
+}
+
+glm::mat4* BonePaletteBuffer::getStaging(int character) {
+    return &staging[character * strideMatrices];
+}
+
+void BonePaletteBuffer::upload(int character) {
+    GLintptr offset = (GLintptr)character * strideMatrices * sizeof(glm::mat4);
+    GLsizeiptr size = (GLsizeiptr)bonesPerCharacter * sizeof(glm::mat4);
+
+    // glBufferSubData needs a buffer bound to a target; the indexed bind below sets that too
+    glBindBufferRange(GL_UNIFORM_BUFFER, BindingPoint, paletteUBO, offset, size);
+    glBufferSubData(GL_UNIFORM_BUFFER, offset, size, getStaging(character));
+    GLCalls().Increment(2);
+}
+
+ProfileCounter& BonePaletteBuffer::GLCalls() {
+    static ProfileCounter counter("GL palette calls");
+    return counter;
+}
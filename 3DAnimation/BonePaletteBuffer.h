@@ -0,0 +1,39 @@
+#pragma once
+
+/* Skinning palettes for every animated character in one uniform buffer.
+   Each character owns an aligned range of the buffer plus a CPU staging copy that its
+   Animator writes into directly (Animator::SetPaletteTarget). Uploading a character is one
+   glBufferSubData of its range and one glBindBufferRange onto the shader's block binding. */
+
+#include <vector>
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+#include "Profiler.h"
+
+class BonePaletteBuffer {
+public:
+    // uniform block binding point shared by every skinning shader
+    static const unsigned int BindingPoint = 0;
+
+    BonePaletteBuffer(int characterCount, int bonesPerCharacter);
+    ~BonePaletteBuffer();
+
+    // wires the program's palette block to BindingPoint; load time only
+    void bindBlock(unsigned int shaderProgram, const char* blockName = "BonePalette");
+
+    // bonesPerCharacter matrices the character's animator can write into
+    glm::mat4* getStaging(int character);
+
+    // sends the character's staged palette to the GPU and binds it for the next draw
+    void upload(int character);
+
+    // every GL call made for skinning palettes, reported through the profiler
+    static ProfileCounter& GLCalls();
+
+private:
+    unsigned int paletteUBO;
+    int characterCount;
+    int bonesPerCharacter;
+    int strideMatrices; // per-character stride, padded to GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT
+    std::vector<glm::mat4> staging;
+};
@@ -0,0 +1,300 @@
+// ClipCompression.cpp
+#include "ClipCompression.h"
+#include <algorithm>
+#include <cmath>
+
+namespace
+{
+	const float QuantizedMax = 65535.0f;
+	// smallest-three components lie within +-1/sqrt(2); 15 bits each
+	const float SmallestThreeRange = 0.70710678f;
+	const float SmallestThreeMax = 32767.0f;
+
+	// normalized lerp on the shorter arc, which is also what sampling does between two keys
+	glm::quat Nlerp(const glm::quat& a, const glm::quat& b, float weight)
+	{
+		float side = glm::dot(a, b) < 0.0f ? -1.0f : 1.0f;
+		return glm::normalize(a * (1.0f - weight) + b * (weight * side));
+	}
+
+	float AngleBetween(const glm::quat& a, const glm::quat& b)
+	{
+		float cosHalfAngle = glm::min(1.0f, std::abs(glm::dot(glm::normalize(a), glm::normalize(b))));
+		return glm::degrees(2.0f * std::acos(cosHalfAngle));
+	}
+
+	// Indices of the keys to keep: the first, the last, and every key where a straight
+	// interpolation from the previous kept key stops reproducing the keys in between within
+	// tolerance. All keys within tolerance of the first one collapse to just the first. A track
+	// without keys keeps none.
+	template <typename Value, typename Interpolate, typename Distance>
+	std::vector<int> ReduceKeys(const float* times, const Value* values, int count, float tolerance, Interpolate interpolate, Distance distance)
+	{
+		if (count <= 0)
+			return std::vector<int>();
+		std::vector<int> kept(1, 0);
+		bool constant = true;
+		for (int i = 1; i < count && constant; i++)
+			constant = distance(values[0], values[i]) <= tolerance;
+		if (constant)
+			return kept;
+
+		int anchor = 0;
+		for (int end = 2; end < count; end++)
+		{
+			for (int key = anchor + 1; key < end; key++)
+			{
+				float weight = (times[key] - times[anchor]) / (times[end] - times[anchor]);
+				if (distance(interpolate(values[anchor], values[end], weight), values[key]) > tolerance)
+				{
+					anchor = end - 1;
+					kept.push_back(anchor);
+					break;
+				}
+			}
+		}
+		kept.push_back(count - 1);
+		return kept;
+	}
+
+	void EncodeRotation(glm::quat rotation, uint16_t* out)
+	{
+		rotation = glm::normalize(rotation);
+		float components[4] = { rotation.x, rotation.y, rotation.z, rotation.w };
+		int largest = 0;
+		for (int i = 1; i < 4; i++)
+		{
+			if (std::abs(components[i]) > std::abs(components[largest]))
+				largest = i;
+		}
+		// q and -q are the same rotation, so the dropped component can always be positive
+		float sign = components[largest] < 0.0f ? -1.0f : 1.0f;
+
+		int written = 0;
+		for (int i = 0; i < 4; i++)
+		{
+			if (i == largest)
+				continue;
+			float normalized = glm::clamp(components[i] * sign / SmallestThreeRange, -1.0f, 1.0f);
+			out[written++] = (uint16_t)std::lround((normalized * 0.5f + 0.5f) * SmallestThreeMax);
+		}
+		// the index of the dropped component rides in the top bits of the first two values
+		out[0] |= (uint16_t)((largest >> 1) << 15);
+		out[1] |= (uint16_t)((largest & 1) << 15);
+	}
+
+	glm::quat DecodeRotation(const uint16_t* in)
+	{
+		int largest = ((in[0] >> 15) << 1) | (in[1] >> 15);
+		float smallest[3];
+		float sumOfSquares = 0.0f;
+		for (int i = 0; i < 3; i++)
+		{
+			smallest[i] = ((in[i] & 0x7FFF) / SmallestThreeMax * 2.0f - 1.0f) * SmallestThreeRange;
+			sumOfSquares += smallest[i] * smallest[i];
+		}
+
+		float components[4];
+		int read = 0;
+		for (int i = 0; i < 4; i++)
+			components[i] = i == largest ? std::sqrt(glm::max(0.0f, 1.0f - sumOfSquares)) : smallest[read++];
+		return glm::quat(components[3], components[0], components[1], components[2]);
+	}
+}
+
+void CompressedClip::Reset(float duration)
+{
+	m_Tracks.clear();
+	m_Times.clear();
+	m_Values.clear();
+	m_TimeScale = duration > 0.0f ? QuantizedMax / duration : 0.0f;
+	m_SourceKeys = 0;
+	m_ConstantTracks = 0;
+}
+
+void CompressedClip::AddChannel(const Bone& bone, const CompressionTolerance& tolerance)
+{
+	AddVectorTrack(bone.m_PositionTimes, bone.m_Positions, bone.GetNumPositionKeys(), tolerance.position, glm::vec3(0.0f));
+	AddRotationTrack(bone.m_RotationTimes, bone.m_Rotations, bone.GetNumRotationKeys(), tolerance.rotation);
+	AddVectorTrack(bone.m_ScaleTimes, bone.m_Scales, bone.GetNumScalingKeys(), tolerance.scale, glm::vec3(1.0f));
+}
+
+void CompressedClip::AddKeyTimes(const float* times, const std::vector<int>& kept)
+{
+	for (int key : kept)
+		m_Times.push_back((uint16_t)std::lround(glm::clamp(times[key] * m_TimeScale, 0.0f, QuantizedMax)));
+	if (kept.size() == 1)
+		m_ConstantTracks++;
+}
+
+void CompressedClip::AddEmptyTrack(const glm::vec3& rangeMin, const uint16_t* value)
+{
+	Track track = { (uint32_t)m_Times.size(), 1, rangeMin, glm::vec3(0.0f) };
+	m_Times.push_back(0);
+	m_Values.insert(m_Values.end(), value, value + 3);
+	m_ConstantTracks++;
+	m_Tracks.push_back(track);
+}
+
+void CompressedClip::AddVectorTrack(const float* times, const glm::vec3* values, int count, float tolerance, const glm::vec3& rest)
+{
+	Track track = { (uint32_t)m_Times.size(), 0, glm::vec3(0.0f), glm::vec3(0.0f) };
+	std::vector<int> kept = ReduceKeys(times, values, count, tolerance,
+		[](const glm::vec3& a, const glm::vec3& b, float weight) { return glm::mix(a, b, weight); },
+		[](const glm::vec3& a, const glm::vec3& b) { return glm::length(a - b); });
+	if (kept.empty())
+	{
+		const uint16_t zero[3] = { 0, 0, 0 };
+		AddEmptyTrack(rest, zero);
+		return;
+	}
+	AddKeyTimes(times, kept);
+	m_SourceKeys += count;
+	track.keyCount = (uint32_t)kept.size();
+
+	glm::vec3 rangeMax = values[kept[0]];
+	track.rangeMin = values[kept[0]];
+	for (int key : kept)
+	{
+		track.rangeMin = glm::min(track.rangeMin, values[key]);
+		rangeMax = glm::max(rangeMax, values[key]);
+	}
+	track.rangeStep = (rangeMax - track.rangeMin) / QuantizedMax;
+
+	for (int key : kept)
+	{
+		for (int axis = 0; axis < 3; axis++)
+		{
+			float step = track.rangeStep[axis];
+			float quantized = step > 0.0f ? (values[key][axis] - track.rangeMin[axis]) / step : 0.0f;
+			m_Values.push_back((uint16_t)std::lround(glm::clamp(quantized, 0.0f, QuantizedMax)));
+		}
+	}
+	m_Tracks.push_back(track);
+}
+
+void CompressedClip::AddRotationTrack(const float* times, const glm::quat* values, int count, float tolerance)
+{
+	Track track = { (uint32_t)m_Times.size(), 0, glm::vec3(0.0f), glm::vec3(0.0f) };
+	std::vector<int> kept = ReduceKeys(times, values, count, tolerance, Nlerp, AngleBetween);
+	if (kept.empty())
+	{
+		uint16_t identity[3];
+		EncodeRotation(glm::quat(1.0f, 0.0f, 0.0f, 0.0f), identity);
+		AddEmptyTrack(glm::vec3(0.0f), identity);
+		return;
+	}
+	AddKeyTimes(times, kept);
+	m_SourceKeys += count;
+	track.keyCount = (uint32_t)kept.size();
+
+	for (int key : kept)
+	{
+		uint16_t encoded[3];
+		EncodeRotation(values[key], encoded);
+		m_Values.insert(m_Values.end(), encoded, encoded + 3);
+	}
+	m_Tracks.push_back(track);
+}
+
+size_t CompressedClip::GetBytes() const
+{
+	return m_Tracks.size() * sizeof(Track) + m_Times.size() * sizeof(uint16_t) + m_Values.size() * sizeof(uint16_t);
+}
+
+int CompressedClip::FindKey(const Track& track, float animationTime, float& weight) const
+{
+	weight = 0.0f;
+	if (track.keyCount == 1)
+		return 0;
+
+	const uint16_t* times = m_Times.data() + track.firstKey;
+	float time = animationTime * m_TimeScale;
+	// last key at or before time, clamped to the first/last segment
+	int low = 0;
+	int high = (int)track.keyCount - 2;
+	while (low < high)
+	{
+		int mid = (low + high) / 2;
+		if (time < times[mid + 1])
+			high = mid;
+		else
+			low = mid + 1;
+	}
+	float span = (float)(times[low + 1] - times[low]);
+	weight = span > 0.0f ? glm::clamp((time - times[low]) / span, 0.0f, 1.0f) : 0.0f;
+	return low;
+}
+
+glm::vec3 CompressedClip::SampleVector(const Track& track, float animationTime) const
+{
+	float weight;
+	int key = FindKey(track, animationTime, weight);
+	const uint16_t* a = &m_Values[(track.firstKey + key) * 3];
+	glm::vec3 value = track.rangeMin + glm::vec3(a[0], a[1], a[2]) * track.rangeStep;
+	if (weight == 0.0f)
+		return value;
+	const uint16_t* b = a + 3;
+	return glm::mix(value, track.rangeMin + glm::vec3(b[0], b[1], b[2]) * track.rangeStep, weight);
+}
+
+glm::quat CompressedClip::SampleRotation(const Track& track, float animationTime) const
+{
+	float weight;
+	int key = FindKey(track, animationTime, weight);
+	const uint16_t* a = &m_Values[(track.firstKey + key) * 3];
+	glm::quat value = DecodeRotation(a);
+	if (weight == 0.0f)
+		return value;
+	return Nlerp(value, DecodeRotation(a + 3), weight);
+}
+
+void CompressedClip::Sample(int channel, float animationTime, BonePose& out) const
+{
+	const Track* tracks = &m_Tracks[channel * TRACKS_PER_CHANNEL];
+	out.translation = SampleVector(tracks[TRACK_TRANSLATION], animationTime);
+	out.rotation = SampleRotation(tracks[TRACK_ROTATION], animationTime);
+	out.scale = SampleVector(tracks[TRACK_SCALE], animationTime);
+}
+
+void CompressedClip::Write(CacheWriter& writer) const
+{
+	writer.Write(m_TimeScale);
+	writer.Write((int32_t)m_SourceKeys);
+	writer.Write((int32_t)m_ConstantTracks);
+	writer.Write((uint32_t)m_Tracks.size());
+	writer.Write((uint32_t)m_Times.size());
+	writer.Write((uint32_t)m_Values.size());
+	writer.WriteArray(m_Tracks.data(), m_Tracks.size());
+	writer.WriteArray(m_Times.data(), m_Times.size());
+	writer.WriteArray(m_Values.data(), m_Values.size());
+}
+
+bool CompressedClip::Read(CacheReader& reader)
+{
+	float timeScale = reader.Read<float>();
+	int sourceKeys = reader.Read<int32_t>();
+	int constantTracks = reader.Read<int32_t>();
+	uint32_t trackCount = reader.Read<uint32_t>();
+	uint32_t timeCount = reader.Read<uint32_t>();
+	uint32_t valueCount = reader.Read<uint32_t>();
+	const Track* tracks = reader.ReadArray<Track>(trackCount);
+	const uint16_t* times = reader.ReadArray<uint16_t>(timeCount);
+	const uint16_t* values = reader.ReadArray<uint16_t>(valueCount);
+	Reset(0.0f);
+	if (!reader.IsValid() || valueCount != timeCount * 3)
+		return false;
+	for (uint32_t i = 0; i < trackCount; i++)
+	{
+		if (tracks[i].keyCount == 0 || tracks[i].firstKey + tracks[i].keyCount > timeCount)
+			return false;
+	}
+
+	m_Tracks.assign(tracks, tracks + trackCount);
+	m_Times.assign(times, times + timeCount);
+	m_Values.assign(values, values + valueCount);
+	m_TimeScale = timeScale;
+	m_SourceKeys = sourceKeys;
+	m_ConstantTracks = constantTracks;
+	return true;
+}
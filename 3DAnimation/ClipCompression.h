@@ -0,0 +1,88 @@
+#pragma once
+
+/* Compressed key storage for animation clips.
+   Every channel keeps three tracks (translation, rotation, scale). A track whose keys all sit
+   within tolerance of its first key collapses to that one key. Other tracks drop every key that
+   interpolating its kept neighbours reproduces within tolerance. The keys left are quantized to
+   8 bytes each: a 16-bit time over the clip's duration plus three 16-bit values. Rotations use
+   smallest-three (the largest component is rebuilt from the other three, 15 bits each);
+   translations and scales are quantized over the track's own range.
+   Sampling decodes only the two keys around the requested time.
+   The result can be written to a clip's asset cache with Write and read back with Read, so a
+   cooked clip doesn't have to be reduced again at startup. */
+
+#include <cstdint>
+#include <vector>
+#include <glm/glm.hpp>
+#include <glm/gtc/quaternion.hpp>
+#include "bone.h"
+#include "pose.h"
+#include "AssetCache.h"
+
+// how far a compressed track may stray from the source keys, in bone space
+struct CompressionTolerance : PoseTolerance
+{
+	CompressionTolerance()
+	{
+		position = 0.01f;
+		rotation = 0.1f;
+		scale = 0.001f;
+	}
+
+	bool operator==(const CompressionTolerance& other) const
+	{
+		return position == other.position && rotation == other.rotation && scale == other.scale;
+	}
+};
+
+class CompressedClip
+{
+public:
+	// clears the clip; key times are quantized over [0, duration] ticks
+	void Reset(float duration);
+
+	// appends the compressed tracks of one source channel; channels keep the order they are added in
+	void AddChannel(const Bone& bone, const CompressionTolerance& tolerance);
+
+	// local pose of one channel at animationTime (in ticks)
+	void Sample(int channel, float animationTime, BonePose& out) const;
+
+	// the whole clip as laid out in memory; Read returns false (and leaves the clip empty) if the
+	// cache ran out part-way
+	void Write(CacheWriter& writer) const;
+	bool Read(CacheReader& reader);
+
+	bool IsEmpty() const { return m_Tracks.empty(); }
+	size_t GetBytes() const;
+	int GetKeyCount() const { return (int)m_Times.size(); }
+	int GetSourceKeyCount() const { return m_SourceKeys; }
+	int GetConstantTrackCount() const { return m_ConstantTracks; }
+
+private:
+	enum TrackKind { TRACK_TRANSLATION, TRACK_ROTATION, TRACK_SCALE, TRACKS_PER_CHANNEL };
+
+	struct Track
+	{
+		uint32_t firstKey;      // into m_Times, and x3 into m_Values
+		uint32_t keyCount;
+		glm::vec3 rangeMin;     // translation / scale: value = rangeMin + quantized * rangeStep
+		glm::vec3 rangeStep;
+	};
+
+	// rest is what a track without any keys holds
+	void AddVectorTrack(const float* times, const glm::vec3* values, int count, float tolerance, const glm::vec3& rest);
+	void AddRotationTrack(const float* times, const glm::quat* values, int count, float tolerance);
+	void AddEmptyTrack(const glm::vec3& rangeMin, const uint16_t* value);
+	void AddKeyTimes(const float* times, const std::vector<int>& kept);
+	// key before animationTime and how far towards the next one it is
+	int FindKey(const Track& track, float animationTime, float& weight) const;
+	glm::vec3 SampleVector(const Track& track, float animationTime) const;
+	glm::quat SampleRotation(const Track& track, float animationTime) const;
+
+	std::vector<Track> m_Tracks;        // TRACKS_PER_CHANNEL per channel
+	std::vector<uint16_t> m_Times;
+	std::vector<uint16_t> m_Values;     // three per key
+	float m_TimeScale = 0.0f;           // ticks to quantized time
+	int m_SourceKeys = 0;
+	int m_ConstantTracks = 0;
+};
@@ -0,0 +1,142 @@
+#pragma once
+
+/* Loads a fighter's clips as one batch through a single reused Assimp importer.
+   Clips with a current asset cache skip Assimp entirely. The rest are imported with
+   Animation::ImportFlags (no post-processing), bound to the model's skeleton, and released
+   before the next one is read, so only one clip scene is ever alive. Cache, import and bind
+   times are recorded per clip in the profiler.
+   At startup Import + Bind replace Load: every clip is imported on a job system worker with
+   its own importer, and Bind then binds them on the calling thread in the order they were
+   added, so bone ids come out exactly as Load assigns them. */
+
+#include <string>
+#include <vector>
+#include <chrono>
+#include <iostream>
+#include <memory>
+#include <assimp/Importer.hpp>
+#include <assimp/scene.h>
+#include "animation.h"
+#include "model_animation.h"
+#include "Profiler.h"
+#include "JobSystem.h"
+#include "AssetCache.h"
+
+class ClipLoader
+{
+public:
+	// queues a clip; nothing is read until Load or Import
+	void Add(Animation& clip, const std::string& path, float speed = 1.0f)
+	{
+		m_Pending.push_back({ &clip, path, speed, nullptr, nullptr });
+	}
+
+	// imports every queued clip against model and clears the queue; returns false if any failed
+	bool Load(ModelAnim& model)
+	{
+		auto batchStart = std::chrono::high_resolution_clock::now();
+		bool allLoaded = true;
+		for (const PendingClip& pending : m_Pending)
+		{
+			{
+				ProfileScope profile(CacheSection());
+				if (pending.clip->LoadCache(pending.path, &model, pending.speed))
+					continue;
+			}
+
+			const aiScene* scene;
+			{
+				ProfileScope profile(ImportSection());
+				scene = m_Importer.ReadFile(pending.path, Animation::ImportFlags);
+			}
+			if (!scene || !scene->mRootNode || scene->mNumAnimations == 0)
+			{
+				std::cout << "ERROR::CLIP_LOADER:: " << pending.path << ": " << m_Importer.GetErrorString() << std::endl;
+				allLoaded = false;
+				continue;
+			}
+			{
+				ProfileScope profile(BindSection());
+				pending.clip->loadAnimation(scene, pending.path, &model, pending.speed);
+			}
+			m_Importer.FreeScene();
+		}
+
+		auto elapsed = std::chrono::high_resolution_clock::now() - batchStart;
+		std::cout << "Loaded " << m_Pending.size() << " clips in "
+			<< std::chrono::duration_cast<std::chrono::milliseconds>(elapsed).count() << " ms" << std::endl;
+		m_Pending.clear();
+		return allLoaded;
+	}
+
+	// queues an Assimp import of every clip without a current cache; clips must not be added
+	// until Bind has run
+	void Import(JobSystem& jobs)
+	{
+		for (PendingClip& pending : m_Pending)
+		{
+			if (AssetCache::IsCurrent(pending.path, AssetCache::AnimationClip))
+				continue;
+			PendingClip* target = &pending;
+			jobs.Submit([target]
+			{
+				ProfileScope profile(ImportSection());
+				target->importer.reset(new Assimp::Importer());
+				target->scene = target->importer->ReadFile(target->path, Animation::ImportFlags);
+			});
+		}
+	}
+
+	// once the import jobs have finished: binds every clip against model in the order it was
+	// added, releases the scenes and clears the queue; returns false if any failed
+	bool Bind(ModelAnim& model)
+	{
+		bool allLoaded = true;
+		for (PendingClip& pending : m_Pending)
+		{
+			if (!pending.importer)
+			{
+				{
+					ProfileScope profile(CacheSection());
+					if (pending.clip->LoadCache(pending.path, &model, pending.speed))
+						continue;
+				}
+				// the cache went stale after Import checked it; read the source here instead
+				ProfileScope profile(ImportSection());
+				pending.importer.reset(new Assimp::Importer());
+				pending.scene = pending.importer->ReadFile(pending.path, Animation::ImportFlags);
+			}
+			if (!pending.scene || !pending.scene->mRootNode || pending.scene->mNumAnimations == 0)
+			{
+				std::cout << "ERROR::CLIP_LOADER:: " << pending.path << ": " << pending.importer->GetErrorString() << std::endl;
+				allLoaded = false;
+				continue;
+			}
+			{
+				ProfileScope profile(BindSection());
+				pending.clip->loadAnimation(pending.scene, pending.path, &model, pending.speed);
+			}
+		}
+		std::cout << "Bound " << m_Pending.size() << " clips" << std::endl;
+		m_Pending.clear();
+		return allLoaded;
+	}
+
+private:
+	struct PendingClip
+	{
+		Animation* clip;
+		std::string path;
+		float speed;
+		std::unique_ptr<Assimp::Importer> importer; // owns scene; set only by Import / Bind
+		const aiScene* scene;
+	};
+
+	// shared by Load, Import and Bind; Import records from worker threads
+	static ProfileSection& CacheSection() { static ProfileSection section("Clip cache lookup", "clip"); return section; }
+	static ProfileSection& ImportSection() { static ProfileSection section("Clip import (assimp)", "clip"); return section; }
+	static ProfileSection& BindSection() { static ProfileSection section("Clip bind", "clip"); return section; }
+
+	Assimp::Importer m_Importer;
+	std::vector<PendingClip> m_Pending;
+};
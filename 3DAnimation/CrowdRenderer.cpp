@@ -0,0 +1,145 @@
+// CrowdRenderer.cpp
+#include "CrowdRenderer.h"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <iostream>
+#include "animator.h"
+
+CrowdRenderer::CrowdRenderer(ModelAnim& model, float modelScale)
+    : model(model), modelScale(modelScale), boneCount(0) {
+    glGenBuffers(1, &instanceBuffer);
+    // VAOs of our own, so the fighter draws through the meshes' VAOs never read instance data
+    for (AnimatorMesh& mesh : model.meshes)
+        meshVAOs.push_back(mesh.createInstancedVAO(instanceBuffer));
+}
+
+CrowdRenderer::~CrowdRenderer() {
+    if (!meshVAOs.empty())
+        glDeleteVertexArrays((GLsizei)meshVAOs.size(), meshVAOs.data());
+    glDeleteBuffers(1, &instanceBuffer);
+    if (boneTexture)
+        glDeleteTextures(1, &boneTexture);
+}
+
+const std::vector<CrowdClip>& CrowdRenderer::bake(const std::vector<Animation*>& sourceClips, float frameRate) {
+    auto bakeStart = std::chrono::high_resolution_clock::now();
+    clips.clear();
+
+    // the clips pose through an animator of their own, straight from its palette
+    Animator animator(nullptr);
+    BonePalette palette = animator.GetFinalBoneMatrices();
+    boneCount = std::min(model.GetBoneCount(), palette.size());
+    std::vector<glm::vec4> texels;
+    int rows = 0;
+    for (Animation* clip : sourceClips) {
+        float seconds = clip->GetDuration() / clip->GetTicksPerSecond();
+        CrowdClip baked = { rows, std::max(1, (int)std::lround(seconds * frameRate)), frameRate };
+        animator.PlayAnimation(clip, nullptr, 0.0f, 0.0f, 0.0f);
+        for (int frame = 0; frame < baked.frameCount; frame++) {
+            animator.CalculateBoneTransforms(frame / frameRate * clip->GetTicksPerSecond(), 0.0f);
+            for (int bone = 0; bone < boneCount; bone++) {
+                const glm::mat4& m = palette[bone];
+                for (int row = 0; row < 3; row++)
+                    texels.push_back(glm::vec4(m[0][row], m[1][row], m[2][row], m[3][row]));
+            }
+        }
+        clips.push_back(baked);
+        rows += baked.frameCount;
+    }
+
+    GLint maxSize = 0;
+    glGetIntegerv(GL_MAX_TEXTURE_SIZE, &maxSize);
+    if (rows == 0 || rows > maxSize || boneCount * 3 > maxSize) {
+        std::cout << "ERROR::CROWD:: " << rows << " frames of " << boneCount << " bones do not fit a " << maxSize << " texture" << std::endl;
+        clips.clear();
+        return clips;
+    }
+
+    if (!boneTexture)
+        glGenTextures(1, &boneTexture);
+    glBindTexture(GL_TEXTURE_2D, boneTexture);
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA32F, boneCount * 3, rows, 0, GL_RGBA, GL_FLOAT, texels.data());
+    // texelFetch only: no filtering, no mips
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    glBindTexture(GL_TEXTURE_2D, 0);
+    textureBytes = texels.size() * sizeof(glm::vec4);
+
+    auto elapsed = std::chrono::high_resolution_clock::now() - bakeStart;
+    std::cout << "Crowd bone texture: " << clips.size() << " clips, " << rows << " frames x " << boneCount << " bones, "
+        << textureBytes << " bytes, baked in " << std::chrono::duration_cast<std::chrono::milliseconds>(elapsed).count() << " ms" << std::endl;
+    return clips;
+}
+
+std::vector<CrowdInstance> CrowdRenderer::arrange(int count, const glm::vec3& center, float innerRadius, float arcStart, float arcEnd) const {
+    const float seatSpacing = 0.8f;
+    const float rowSpacing = 0.9f;
+    const float rowRise = 0.3f;     // tiered stands, so back rows see over front rows
+    std::vector<CrowdInstance> instances;
+    if (clips.empty())
+        return instances;
+
+    // fixed-seed LCG: the same crowd every run
+    uint32_t seed = 0x5EA75u;
+    auto random = [&seed]() {
+        seed = seed * 1664525u + 1013904223u;
+        return (seed >> 8) / 16777216.0f;
+    };
+
+    instances.reserve(count);
+    for (int row = 0; (int)instances.size() < count; row++) {
+        float radius = innerRadius + row * rowSpacing;
+        int seats = std::max(1, (int)((arcEnd - arcStart) * radius / seatSpacing));
+        for (int seat = 0; seat < seats && (int)instances.size() < count; seat++) {
+            float angle = arcStart + (arcEnd - arcStart) * (seat + 0.5f) / seats;
+            glm::vec3 position = center + glm::vec3(std::sin(angle) * radius, row * rowRise, std::cos(angle) * radius);
+            position += glm::vec3(random() - 0.5f, 0.0f, random() - 0.5f) * 0.2f;
+            glm::vec3 toCenter = center - position;
+
+            const CrowdClip& clip = clips[std::min((int)(random() * clips.size()), (int)clips.size() - 1)];
+            CrowdInstance instance;
+            instance.placement = glm::vec4(position, std::atan2(toCenter.x, toCenter.z));
+            instance.playback = glm::vec4((float)clip.firstRow, (float)clip.frameCount, random() * clip.frameCount,
+                clip.frameRate * (0.85f + 0.3f * random()));
+            instances.push_back(instance);
+        }
+    }
+    return instances;
+}
+
+void CrowdRenderer::setInstances(const std::vector<CrowdInstance>& instances) {
+    glBindBuffer(GL_ARRAY_BUFFER, instanceBuffer);
+    glBufferData(GL_ARRAY_BUFFER, instances.size() * sizeof(CrowdInstance), instances.data(), GL_STATIC_DRAW);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+    instanceCount = (int)instances.size();
+}
+
+void CrowdRenderer::draw(Shader& shader, const glm::mat4& view, const glm::mat4& projection, float time) {
+    if (instanceCount == 0 || !boneTexture)
+        return;
+
+    static Shader::Uniform projectionUniform("projection");
+    static Shader::Uniform viewUniform("view");
+    static Shader::Uniform modelScaleUniform("modelScale");
+    static Shader::Uniform timeUniform("time");
+    static Shader::Uniform boneTextureUniform("boneTexture");
+    shader.use();
+    shader.setMat4(projectionUniform, projection);
+    shader.setMat4(viewUniform, view);
+    shader.setFloat(modelScaleUniform, modelScale);
+    shader.setFloat(timeUniform, time);
+    shader.setInt(boneTextureUniform, BoneTextureUnit);
+    glActiveTexture(GL_TEXTURE0 + BoneTextureUnit);
+    glBindTexture(GL_TEXTURE_2D, boneTexture);
+
+    for (size_t i = 0; i < meshVAOs.size(); i++)
+        model.meshes[i].DrawInstanced(shader, meshVAOs[i], instanceCount);
+
+    glActiveTexture(GL_TEXTURE0 + BoneTextureUnit);
+    glBindTexture(GL_TEXTURE_2D, 0);
+    glActiveTexture(GL_TEXTURE0);
+}
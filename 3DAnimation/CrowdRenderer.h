@@ -0,0 +1,71 @@
+#pragma once
+
+/* Instanced audience for the arena.
+   The clips spectators play are baked once, at load, into a bone-matrix texture: one row per
+   frame, three RGBA32F texels (the rows of the bone's 3x4 skinning matrix) per bone. Each
+   spectator is two vec4s of instance data - placement, and which rows to play at what phase
+   and rate - so a whole crowd of one rig is one instanced draw per mesh. The vertex shader
+   picks the frame from the time and skins from the texture, and nothing about a spectator
+   is touched on the CPU after setInstances. */
+
+#include <vector>
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+#include <learnopengl/shader.h>
+#include "model_animation.h"
+#include "animation.h"
+
+// per-instance data, attributes 7 and 8 of crowd.vs
+struct CrowdInstance {
+    glm::vec4 placement;    // xyz position, w yaw in radians (0 faces +z)
+    glm::vec4 playback;     // x first row, y frame count, z phase in frames, w frames per second
+};
+
+// rows one baked clip occupies in the bone texture
+struct CrowdClip {
+    int firstRow;
+    int frameCount;
+    float frameRate;
+};
+
+class CrowdRenderer {
+public:
+    // model must outlive the renderer; its meshes are drawn instanced
+    CrowdRenderer(ModelAnim& model, float modelScale);
+    ~CrowdRenderer();
+
+    CrowdRenderer(const CrowdRenderer&) = delete;
+    CrowdRenderer& operator=(const CrowdRenderer&) = delete;
+
+    // GL thread: samples every clip at frameRate into the bone texture, one clip after the
+    // other; clips must be bound to the renderer's model. Returns the clips' rows in order.
+    const std::vector<CrowdClip>& bake(const std::vector<Animation*>& clips, float frameRate = 30.0f);
+
+    // Fills rows of seats on an arc around center, facing it, from innerRadius outwards, over
+    // the angles [arcStart, arcEnd] (radians, 0 towards +z). Spectators get a baked clip, phase
+    // and rate from a fixed seed, so the same count always gives the same crowd.
+    std::vector<CrowdInstance> arrange(int count, const glm::vec3& center, float innerRadius, float arcStart, float arcEnd) const;
+
+    // GL thread: replaces the instance buffer
+    void setInstances(const std::vector<CrowdInstance>& instances);
+
+    // GL thread: one instanced draw per mesh; time in seconds drives every spectator
+    void draw(Shader& shader, const glm::mat4& view, const glm::mat4& projection, float time);
+
+    int getInstanceCount() const { return instanceCount; }
+    size_t getTextureBytes() const { return textureBytes; }
+
+    // texture unit the bone texture is bound to, past any the meshes use
+    static const int BoneTextureUnit = 15;
+
+private:
+    ModelAnim& model;
+    float modelScale;
+    int boneCount;
+    unsigned int boneTexture = 0;
+    unsigned int instanceBuffer = 0;
+    std::vector<unsigned int> meshVAOs;     // per model mesh: its buffers plus the instance attributes
+    int instanceCount = 0;
+    size_t textureBytes = 0;
+    std::vector<CrowdClip> clips;
+};
@@ -0,0 +1,306 @@
+// Fighter.cpp
+#include "Fighter.h"
+#include <cmath>
+#include <iostream>
+#include "Json.h"
+
+namespace
+{
+	const char* const InputNames[INPUT_COUNT] = { "forward", "back", "punch", "kick", "block" };
+	const char* const RoleNames[ROLE_COUNT] = { "intro", "idle", "victory", "defeat" };
+	const char* const CueNames[CUE_COUNT] = { "swish" };
+
+	int FindInput(const std::string& inputName)
+	{
+		for (int i = 0; i < INPUT_COUNT; i++)
+		{
+			if (inputName == InputNames[i])
+				return i;
+		}
+		return -1;
+	}
+
+	int FindCue(const std::string& cueName)
+	{
+		for (int i = 0; i < CUE_COUNT; i++)
+		{
+			if (cueName == CueNames[i])
+				return i;
+		}
+		return -1;
+	}
+
+	// "forward" / "back" / absent
+	bool ReadMove(const JsonValue& value, int& move)
+	{
+		if (value.IsNull())
+			move = 0;
+		else if (value.AsString() == "forward")
+			move = 1;
+		else if (value.AsString() == "back")
+			move = -1;
+		else
+			return false;
+		return true;
+	}
+}
+
+int FighterDefinition::FindClip(const std::string& clipName) const
+{
+	for (size_t i = 0; i < clips.size(); i++)
+	{
+		if (clips[i].name == clipName)
+			return (int)i;
+	}
+	return -1;
+}
+
+int FighterDefinition::FindState(const std::string& stateName) const
+{
+	for (size_t i = 0; i < states.size(); i++)
+	{
+		if (states[i].name == stateName)
+			return (int)i;
+	}
+	return -1;
+}
+
+bool FighterDefinition::Load(const std::string& path)
+{
+	auto fail = [&path](const std::string& message) {
+		std::cout << "ERROR::FIGHTER:: " << path << ": " << message << std::endl;
+		return false;
+	};
+
+	JsonValue root;
+	std::string error;
+	if (!JsonValue::ParseFile(path, root, error))
+		return fail(error);
+	if (!root.IsObject())
+		return fail("expected an object");
+
+	*this = FighterDefinition();
+	name = root["name"].IsString() ? root["name"].AsString() : path;
+	modelPath = root["model"].AsString();
+	if (modelPath.empty())
+		return fail("no model");
+	modelScale = root["scale"].AsFloat(modelScale);
+	walkSpeed = root["walkSpeed"].AsFloat(walkSpeed);
+	const JsonValue& hitbox = root["hitbox"];
+	hitboxBottom = hitbox["bottom"].AsFloat(hitboxBottom);
+	hitboxTop = hitbox["top"].AsFloat(hitboxTop);
+	hitboxRadius = hitbox["radius"].AsFloat(hitboxRadius);
+	const JsonValue& tolerance = root["compression"];
+	compression.position = tolerance["position"].AsFloat(compression.position);
+	compression.rotation = tolerance["rotation"].AsFloat(compression.rotation);
+	compression.scale = tolerance["scale"].AsFloat(compression.scale);
+	const JsonValue& bakeLimit = root["bakeTolerance"];
+	bakeTolerance.position = bakeLimit["position"].AsFloat(bakeTolerance.position);
+	bakeTolerance.rotation = bakeLimit["rotation"].AsFloat(bakeTolerance.rotation);
+	bakeTolerance.scale = bakeLimit["scale"].AsFloat(bakeTolerance.scale);
+
+	// clips, in the order they are bound to the model
+	for (const JsonValue& entry : root["clips"].GetElements())
+	{
+		FighterClip clip;
+		clip.name = entry["name"].AsString();
+		clip.path = entry["file"].AsString();
+		if (clip.name.empty() || clip.path.empty())
+			return fail("every clip needs a name and a file");
+		if (FindClip(clip.name) >= 0)
+			return fail("clip \"" + clip.name + "\" is declared twice");
+		clip.speed = entry["speed"].AsFloat(clip.speed);
+		clip.bakeRate = entry["bake"].AsFloat(clip.bakeRate);
+		clip.compress = entry["compress"].AsBool(clip.compress);
+
+		const JsonValue& attack = entry["attack"];
+		clip.knockback = attack["knockback"].AsFloat(clip.knockback);
+		clip.hitStop = attack["hitStop"].AsFloat(clip.hitStop);
+		clip.impactSound = attack["impactSound"].AsString();
+		for (const JsonValue& strike : attack["strikes"].GetElements())
+		{
+			if (!strike["time"].IsNumber() || !strike["damage"].IsNumber())
+				return fail("strikes on clip \"" + clip.name + "\" need a time and a damage");
+			FighterStrike compiled = { strike["time"].AsFloat(), strike["damage"].AsInt() };
+			clip.strikes.push_back(compiled);
+		}
+		for (const JsonValue& sound : entry["sounds"].GetElements())
+		{
+			int cue = FindCue(sound["cue"].AsString());
+			if (!sound["time"].IsNumber() || cue < 0)
+				return fail("sounds on clip \"" + clip.name + "\" need a time and a known cue");
+			FighterSound compiled = { sound["time"].AsFloat(), cue };
+			clip.sounds.push_back(compiled);
+		}
+		clips.push_back(clip);
+	}
+	for (int role = 0; role < ROLE_COUNT; role++)
+	{
+		roleClips[role] = FindClip(RoleNames[role]);
+		if (roleClips[role] < 0)
+			return fail(std::string("no \"") + RoleNames[role] + "\" clip");
+	}
+
+	// states: names first, so they can refer to each other in any order
+	const std::vector<JsonValue>& stateEntries = root["states"].GetElements();
+	for (const JsonValue& entry : stateEntries)
+	{
+		FighterState state;
+		state.name = entry["name"].AsString();
+		if (state.name.empty())
+			return fail("every state needs a name");
+		if (FindState(state.name) >= 0)
+			return fail("state \"" + state.name + "\" is declared twice");
+		states.push_back(state);
+	}
+
+	for (size_t i = 0; i < stateEntries.size(); i++)
+	{
+		const JsonValue& entry = stateEntries[i];
+		FighterState& state = states[i];
+		const std::string where = "state \"" + state.name + "\": ";
+
+		state.clip = FindClip(entry["clip"].AsString());
+		if (state.clip < 0)
+			return fail(where + "unknown clip \"" + entry["clip"].AsString() + "\"");
+		if (!ReadMove(entry["move"], state.move))
+			return fail(where + "move must be \"forward\" or \"back\"");
+
+		if (entry.Has("from"))
+		{
+			state.fromClip = FindClip(entry["from"].AsString());
+			if (state.fromClip < 0)
+				return fail(where + "unknown clip \"" + entry["from"].AsString() + "\"");
+			state.blendScale = entry["rate"].AsFloat(state.blendScale);
+			state.threshold = entry["threshold"].AsFloat(0.9f);
+			state.exitAfter = entry["after"].AsFloat(state.exitAfter);
+			// the blend wraps at 1, so a crossfade has to finish below it
+			if (state.blendScale <= 0.0f || state.threshold <= 0.0f || state.threshold >= 1.0f)
+				return fail(where + "a crossfade needs a positive rate and a threshold between 0 and 1");
+			state.next = FindState(entry["next"].AsString());
+			if (state.next < 0)
+				return fail(where + "a crossfade needs a next state");
+		}
+
+		if (entry.Has("hold"))
+		{
+			state.holdInput = FindInput(entry["hold"].AsString());
+			state.releaseState = FindState(entry["release"].AsString());
+			if (state.holdInput < 0 || state.releaseState < 0)
+				return fail(where + "hold needs a known input and a release state");
+		}
+
+		state.firstTransition = (int)transitions.size();
+		for (const JsonValue& transitionEntry : entry["transitions"].GetElements())
+		{
+			FighterTransition transition;
+			transition.input = FindInput(transitionEntry["input"].AsString());
+			transition.state = FindState(transitionEntry["to"].AsString());
+			if (transition.input < 0 || transition.state < 0)
+				return fail(where + "a transition needs a known input and state");
+			transitions.push_back(transition);
+		}
+		state.transitionCount = (int)transitions.size() - state.firstTransition;
+	}
+
+	idleState = FindState(root["idleState"].AsString());
+	hitState = FindState(root["hitState"].AsString());
+	blockState = FindState(root["blockState"].AsString());
+	if (idleState < 0 || hitState < 0 || blockState < 0)
+		return fail("idleState, hitState and blockState must name states");
+	return true;
+}
+
+namespace FighterRuntime
+{
+	void QueueClips(Fighter& fighter, ClipLoader& loader)
+	{
+		const std::vector<FighterClip>& clips = fighter.definition.clips;
+		fighter.clips.clear();
+		fighter.clips.resize(clips.size());
+		for (size_t i = 0; i < clips.size(); i++)
+			loader.Add(fighter.clips[i], clips[i].path, clips[i].speed);
+	}
+
+	void FinishLoading(Fighter& fighter)
+	{
+		const std::vector<FighterClip>& clips = fighter.definition.clips;
+		for (size_t i = 0; i < clips.size(); i++)
+		{
+			for (const FighterStrike& strike : clips[i].strikes)
+				fighter.clips[i].AddDamageKeyframe(strike.time, strike.damage);
+			for (const FighterSound& sound : clips[i].sounds)
+				fighter.clips[i].AddEvent({ sound.time, AnimationEventType::Sound, sound.cue });
+			// the table is checked against the raw keys, so it is baked before they go
+			if (clips[i].bakeRate > 0.0f)
+				fighter.clips[i].Bake(clips[i].bakeRate, fighter.definition.bakeTolerance);
+			if (clips[i].compress)
+				fighter.clips[i].Compress(fighter.definition.compression);
+		}
+	}
+
+	void Reset(Fighter& fighter)
+	{
+		const FighterDefinition& definition = fighter.definition;
+		fighter.animator.PlayAnimation(&fighter.clips[definition.states[definition.idleState].clip], nullptr, 0.0f, 0.0f, 0.0f);
+		EnterState(fighter, definition.idleState);
+	}
+
+	void EnterState(Fighter& fighter, int state)
+	{
+		fighter.state = state;
+		fighter.blendAmount = 0.0f;
+
+		// a crossfade sets up the animator itself on its first tick; a plain state only has
+		// to make sure its clip is the one playing
+		const FighterState& entered = fighter.definition.states[state];
+		Animation* clip = &fighter.clips[entered.clip];
+		if (entered.fromClip < 0 && fighter.animator.getCurrentAnimation() != clip)
+			fighter.animator.PlayAnimation(clip, nullptr, 0.0f, 0.0f, 0.0f);
+	}
+
+	void Tick(Fighter& fighter, const bool* held, float blendRate, float dt)
+	{
+		const FighterDefinition& definition = fighter.definition;
+		const FighterState& state = definition.states[fighter.state];
+		Animator& animator = fighter.animator;
+
+		fighter.position.z += fighter.facing * state.move * definition.walkSpeed * dt;
+
+		if (state.holdInput >= 0 && !held[state.holdInput])
+		{
+			EnterState(fighter, state.releaseState);
+			return;
+		}
+		for (int i = 0; i < state.transitionCount; i++)
+		{
+			const FighterTransition& transition = definition.transitions[state.firstTransition + i];
+			if (held[transition.input])
+			{
+				EnterState(fighter, transition.state);
+				// a walk takes its first step on the tick it is pressed
+				fighter.position.z += fighter.facing * definition.states[transition.state].move * definition.walkSpeed * dt;
+				return;
+			}
+		}
+		if (state.fromClip < 0)
+			return;
+
+		Animation* from = &fighter.clips[state.fromClip];
+		Animation* to = &fighter.clips[state.clip];
+		bool fromPlaying = animator.getCurrentAnimation() == from;
+		float fromTime = fromPlaying ? animator.getCurrentTime() : 0.0f;
+		// an exit crossfade lets its part of the clip play out first; once started it carries on
+		if (state.exitAfter > 0.0f && fromPlaying && fighter.blendAmount == 0.0f && fromTime <= state.exitAfter * from->GetDuration())
+			return;
+
+		fighter.blendAmount = fmod(fighter.blendAmount + blendRate * state.blendScale, 1.0f);
+		float toTime = animator.getCurrentAnimation2() == to ? animator.getCurrentTime2() : 0.0f;
+		animator.PlayAnimation(from, to, fromTime, toTime, fighter.blendAmount);
+		if (fighter.blendAmount > state.threshold)
+		{
+			animator.PlayAnimation(to, nullptr, toTime, 0.0f, 0.0f);
+			EnterState(fighter, state.next);
+		}
+	}
+}
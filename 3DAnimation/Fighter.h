@@ -0,0 +1,169 @@
+#pragma once
+
+/* Data-driven fighters. Each fighter is declared in a JSON file under Fighters/. The file gives
+   the model, the clips with their playback speeds and their strike and sound events, the
+   hitbox, and the moves as a state machine. Load compiles it into flat arrays: every name
+   becomes an index, and each state's transitions sit next to each other. A tick is then only
+   array lookups.
+   Both fighters in a match step through the same FighterRuntime::Tick, so adding a fighter
+   takes a new file and no code. */
+
+#include <string>
+#include <vector>
+#include <glm/glm.hpp>
+#include "animation.h"
+#include "animator.h"
+#include "model_animation.h"
+#include "ClipLoader.h"
+
+// the inputs a move reacts to; each player slot binds its own keys to them
+enum FighterInput
+{
+	INPUT_FORWARD,
+	INPUT_BACK,
+	INPUT_PUNCH,
+	INPUT_KICK,
+	INPUT_BLOCK,
+	INPUT_COUNT
+};
+
+// clips the match flow plays outside the move state machine
+enum FighterRole
+{
+	ROLE_INTRO,
+	ROLE_IDLE,
+	ROLE_VICTORY,
+	ROLE_DEFEAT,
+	ROLE_COUNT
+};
+
+// sounds a clip's Sound events can ask for; the game picks each player slot's source for them
+enum FighterSoundCue
+{
+	CUE_SWISH,
+	CUE_COUNT
+};
+
+struct FighterStrike
+{
+	float time;   // seconds into the clip
+	int damage;
+};
+
+struct FighterSound
+{
+	float time;   // seconds into the clip
+	int cue;      // FighterSoundCue
+};
+
+struct FighterClip
+{
+	std::string name;
+	std::string path;
+	float speed = 1.0f;
+	float bakeRate = 0.0f;              // pose table rate in Hz; 0 samples the keyframes
+	bool compress = true;               // keys within the definition's compression tolerance
+	std::vector<FighterStrike> strikes;
+	std::vector<FighterSound> sounds;
+	// what a strike of this clip does when it connects
+	float knockback = 1.0f;             // defender push, in multiples of the match knockback
+	float hitStop = 0.0f;               // seconds
+	std::string impactSound;
+};
+
+struct FighterTransition
+{
+	int input;
+	int state;
+};
+
+// A state either plays clip, or crossfades to it from fromClip and moves on to next when the
+// blend passes threshold.
+struct FighterState
+{
+	std::string name;
+	int clip = -1;
+	int fromClip = -1;          // -1: no crossfade
+	float blendScale = 1.0f;    // crossfade speed, in multiples of the match blend rate
+	float threshold = 1.0f;
+	float exitAfter = 0.0f;     // part of fromClip that plays out before the crossfade starts
+	int next = -1;
+	int move = 0;               // +1 walks forward, -1 back, every tick spent in the state
+	int holdInput = -1;         // the state lasts while this input is held...
+	int releaseState = -1;      // ...and goes here once it isn't
+	int firstTransition = 0;    // transitions[firstTransition, +transitionCount), first held wins
+	int transitionCount = 0;
+};
+
+struct FighterDefinition
+{
+	std::string name;
+	std::string modelPath;
+	float modelScale = 1.0f;
+	float walkSpeed = 0.9f;
+	// capsule from bottom to top above the fighter's position
+	float hitboxBottom = 0.4f;
+	float hitboxTop = 1.2f;
+	float hitboxRadius = 0.5f;
+	CompressionTolerance compression;
+	// a baked pose table that strays further than this from the raw keys is dropped
+	PoseTolerance bakeTolerance = { 0.1f, 1.0f, 0.01f };
+
+	std::vector<FighterClip> clips;
+	std::vector<FighterState> states;
+	std::vector<FighterTransition> transitions;
+	int roleClips[ROLE_COUNT] = { -1, -1, -1, -1 };
+	int idleState = -1;
+	int hitState = -1;      // entered when a strike connects
+	int blockState = -1;    // entered when a strike is blocked
+
+	// reads and compiles a definition file; prints what is wrong and returns false on failure
+	bool Load(const std::string& path);
+
+	int FindClip(const std::string& clipName) const;
+	int FindState(const std::string& stateName) const;
+};
+
+// One fighter in the match: its definition plus everything the runtime steps each tick.
+struct Fighter
+{
+	FighterDefinition definition;
+	ModelAnim model;
+	std::vector<Animation> clips;   // one per definition clip, sized once so the addresses stay put
+	Animator animator{ nullptr };
+	glm::vec3 position = glm::vec3(0.0f);
+	float facing = 1.0f;            // +1 faces +z, -1 faces -z
+	int keys[INPUT_COUNT];          // key bound to each input
+	int state = -1;
+	float blendAmount = 0.0f;
+
+	Animation& RoleClip(FighterRole role) { return clips[definition.roleClips[role]]; }
+
+	// restarts one of the match flow clips on its own
+	void PlayRole(FighterRole role)
+	{
+		animator.PlayAnimation(&RoleClip(role), nullptr, 0.0f, 0.0f, 0.0f);
+	}
+
+	// index into definition.clips of one of this fighter's clips, e.g. from an animation event
+	int ClipIndex(const Animation& clip) const { return (int)(&clip - clips.data()); }
+};
+
+namespace FighterRuntime
+{
+	// sizes fighter.clips and queues every one of them on loader
+	void QueueClips(Fighter& fighter, ClipLoader& loader);
+
+	// once the clips are bound: adds the strike events, bakes the clips that ask for it against
+	// their raw keys, then compresses the keys
+	void FinishLoading(Fighter& fighter);
+
+	// back to the idle state with no crossfade in progress
+	void Reset(Fighter& fighter);
+
+	void EnterState(Fighter& fighter, int state);
+
+	// one simulation tick of the move state machine. held[input] says which inputs are down,
+	// blendRate is the crossfade progress per tick of a state with blendScale 1.
+	void Tick(Fighter& fighter, const bool* held, float blendRate, float dt);
+}
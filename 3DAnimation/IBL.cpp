@@ -0,0 +1,323 @@
+// IBL.cpp
+#include "IBL.h"
+#include "AssetCache.h"
+#include "Profiler.h"
+#include <cmath>
+#include <iostream>
+#include <glm/glm.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+
+// unit cube / NDC quad helpers shared with the main render loop (3DAnimation.cpp)
+void renderCube();
+void renderQuad();
+
+namespace {
+    size_t cubemapTexels(int size, int mips) {
+        size_t texels = 0;
+        for (int mip = 0; mip < mips; ++mip) {
+            size_t mipSize = (size_t)(size >> mip);
+            texels += mipSize * mipSize * 6;
+        }
+        return texels;
+    }
+
+    void setCubemapParameters(GLenum minFilter) {
+        glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+        glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+        glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_R, GL_CLAMP_TO_EDGE);
+        glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MIN_FILTER, minFilter);
+        glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    }
+}
+
+IBLMaps::IBLMaps(const std::string& hdrPath, const IBLSettings& settings)
+    : hdrPath(hdrPath), settings(settings) {
+}
+
+IBLMaps::~IBLMaps() {
+    glDeleteTextures(1, &irradianceMap);
+    glDeleteTextures(1, &prefilterMap);
+    glDeleteTextures(1, &brdfLUT);
+}
+
+bool IBLMaps::readCache() {
+    hdrHash = AssetCache::HashFile(hdrPath);
+
+    CacheReader reader;
+    if (!reader.Open(hdrPath, AssetCache::IBLMaps))
+        return false;
+
+    // the stamp only says the file is unchanged; the hash and settings say it was baked the same way
+    IBLSettings cached = reader.Read<IBLSettings>();
+    uint64_t cachedHash = reader.Read<uint64_t>();
+    if (cachedHash != hdrHash || cached.environmentSize != settings.environmentSize
+        || cached.irradianceSize != settings.irradianceSize || cached.prefilterSize != settings.prefilterSize
+        || cached.prefilterMips != settings.prefilterMips || cached.brdfSize != settings.brdfSize) {
+        std::cout << "IBL cache for " << hdrPath << " was baked from another HDR or settings, rebaking" << std::endl;
+        return false;
+    }
+
+    size_t irradianceCount = cubemapTexels(settings.irradianceSize, 1) * 3;
+    size_t prefilterCount = cubemapTexels(settings.prefilterSize, settings.prefilterMips) * 3;
+    size_t brdfCount = (size_t)settings.brdfSize * settings.brdfSize * 2;
+    const uint16_t* irradiance = reader.ReadArray<uint16_t>(irradianceCount);
+    const uint16_t* prefilter = reader.ReadArray<uint16_t>(prefilterCount);
+    const uint16_t* brdf = reader.ReadArray<uint16_t>(brdfCount);
+    if (!reader.IsValid()) {
+        std::cout << "ERROR::ASSET_CACHE:: corrupt cache for " << hdrPath << std::endl;
+        return false;
+    }
+    irradianceData.assign(irradiance, irradiance + irradianceCount);
+    prefilterData.assign(prefilter, prefilter + prefilterCount);
+    brdfData.assign(brdf, brdf + brdfCount);
+    return true;
+}
+
+void IBLMaps::uploadCache() {
+    static ProfileSection s_IBLUpload("Startup: IBL upload (cached)", "bake");
+    ProfileScope profile(s_IBLUpload);
+
+    createTextures();
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+    uploadCubemap(irradianceMap, settings.irradianceSize, 1, irradianceData.data());
+    uploadCubemap(prefilterMap, settings.prefilterSize, settings.prefilterMips, prefilterData.data());
+    glBindTexture(GL_TEXTURE_2D, brdfLUT);
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_RG16F, settings.brdfSize, settings.brdfSize, 0, GL_RG, GL_HALF_FLOAT, brdfData.data());
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+
+    releaseData();
+}
+
+void IBLMaps::bake(const DecodedImage& hdr, Shader& equirectangularToCubemapShader, Shader& irradianceShader, Shader& prefilterShader, Shader& brdfShader) {
+    static ProfileSection s_IBLBake("Startup: IBL bake", "bake");
+    ProfileScope profile(s_IBLBake);
+
+    // pbr: setup framebuffer
+    // ----------------------
+    unsigned int captureFBO;
+    unsigned int captureRBO;
+    glGenFramebuffers(1, &captureFBO);
+    glGenRenderbuffers(1, &captureRBO);
+
+    glBindFramebuffer(GL_FRAMEBUFFER, captureFBO);
+    glBindRenderbuffer(GL_RENDERBUFFER, captureRBO);
+    glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH_COMPONENT24, settings.environmentSize, settings.environmentSize);
+    glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_RENDERBUFFER, captureRBO);
+
+    // pbr: load the HDR environment map
+    // ---------------------------------
+    unsigned int hdrTexture = 0;
+    if (hdr.IsValid() && hdr.isFloat) {
+        glGenTextures(1, &hdrTexture);
+        glBindTexture(GL_TEXTURE_2D, hdrTexture);
+        glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB16F, hdr.width, hdr.height, 0, GL_RGB, GL_FLOAT, hdr.pixels); // note how we specify the texture's data value to be float
+
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+
+        std::cout << "HDR Loaded: Width = " << hdr.width << ", Height = " << hdr.height << ", Components = " << hdr.components << std::endl;
+    }
+    else {
+        std::cout << "Failed to load HDR image." << std::endl;
+    }
+
+    // pbr: setup cubemap to render to and attach to framebuffer
+    // ---------------------------------------------------------
+    unsigned int envCubemap;
+    glGenTextures(1, &envCubemap);
+    glBindTexture(GL_TEXTURE_CUBE_MAP, envCubemap);
+    for (unsigned int i = 0; i < 6; ++i) {
+        glTexImage2D(GL_TEXTURE_CUBE_MAP_POSITIVE_X + i, 0, GL_RGB16F, settings.environmentSize, settings.environmentSize, 0, GL_RGB, GL_FLOAT, nullptr);
+    }
+    setCubemapParameters(GL_LINEAR_MIPMAP_LINEAR); // enable pre-filter mipmap sampling (combatting visible dots artifact)
+
+    // pbr: set up projection and view matrices for capturing data onto the 6 cubemap face directions
+    // ----------------------------------------------------------------------------------------------
+    glm::mat4 captureProjection = glm::perspective(glm::radians(90.0f), 1.0f, 0.1f, 10.0f);
+    glm::mat4 captureViews[] = {
+        glm::lookAt(glm::vec3(0.0f, 0.0f, 0.0f), glm::vec3(1.0f,  0.0f,  0.0f), glm::vec3(0.0f, -1.0f,  0.0f)),
+        glm::lookAt(glm::vec3(0.0f, 0.0f, 0.0f), glm::vec3(-1.0f,  0.0f,  0.0f), glm::vec3(0.0f, -1.0f,  0.0f)),
+        glm::lookAt(glm::vec3(0.0f, 0.0f, 0.0f), glm::vec3(0.0f,  1.0f,  0.0f), glm::vec3(0.0f,  0.0f,  1.0f)),
+        glm::lookAt(glm::vec3(0.0f, 0.0f, 0.0f), glm::vec3(0.0f, -1.0f,  0.0f), glm::vec3(0.0f,  0.0f, -1.0f)),
+        glm::lookAt(glm::vec3(0.0f, 0.0f, 0.0f), glm::vec3(0.0f,  0.0f,  1.0f), glm::vec3(0.0f, -1.0f,  0.0f)),
+        glm::lookAt(glm::vec3(0.0f, 0.0f, 0.0f), glm::vec3(0.0f,  0.0f, -1.0f), glm::vec3(0.0f, -1.0f,  0.0f))
+    };
+
+    // pbr: convert HDR equirectangular environment map to cubemap equivalent
+    // ----------------------------------------------------------------------
+    equirectangularToCubemapShader.use();
+    equirectangularToCubemapShader.setInt("equirectangularMap", 0);
+    equirectangularToCubemapShader.setMat4("projection", captureProjection);
+    glActiveTexture(GL_TEXTURE0);
+    glBindTexture(GL_TEXTURE_2D, hdrTexture);
+
+    glViewport(0, 0, settings.environmentSize, settings.environmentSize); // don't forget to configure the viewport to the capture dimensions.
+    glBindFramebuffer(GL_FRAMEBUFFER, captureFBO);
+    for (unsigned int i = 0; i < 6; ++i) {
+        equirectangularToCubemapShader.setMat4("view", captureViews[i]);
+        glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_CUBE_MAP_POSITIVE_X + i, envCubemap, 0);
+        glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+
+        renderCube();
+    }
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+
+    // then let OpenGL generate mipmaps from first mip face (combatting visible dots artifact)
+    glBindTexture(GL_TEXTURE_CUBE_MAP, envCubemap);
+    glGenerateMipmap(GL_TEXTURE_CUBE_MAP);
+
+    // pbr: allocate the irradiance, pre-filter and BRDF targets
+    // ---------------------------------------------------------
+    createTextures();
+    uploadCubemap(irradianceMap, settings.irradianceSize, 1, nullptr);
+    uploadCubemap(prefilterMap, settings.prefilterSize, settings.prefilterMips, nullptr);
+    glBindTexture(GL_TEXTURE_2D, brdfLUT);
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_RG16F, settings.brdfSize, settings.brdfSize, 0, GL_RG, GL_FLOAT, 0);
+
+    // pbr: solve diffuse integral by convolution to create an irradiance (cube)map.
+    // -----------------------------------------------------------------------------
+    glBindFramebuffer(GL_FRAMEBUFFER, captureFBO);
+    glBindRenderbuffer(GL_RENDERBUFFER, captureRBO);
+    glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH_COMPONENT24, settings.irradianceSize, settings.irradianceSize);
+
+    irradianceShader.use();
+    irradianceShader.setInt("environmentMap", 0);
+    irradianceShader.setMat4("projection", captureProjection);
+    glActiveTexture(GL_TEXTURE0);
+    glBindTexture(GL_TEXTURE_CUBE_MAP, envCubemap);
+
+    glViewport(0, 0, settings.irradianceSize, settings.irradianceSize); // don't forget to configure the viewport to the capture dimensions.
+    for (unsigned int i = 0; i < 6; ++i) {
+        irradianceShader.setMat4("view", captureViews[i]);
+        glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_CUBE_MAP_POSITIVE_X + i, irradianceMap, 0);
+        glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+
+        renderCube();
+    }
+
+    // pbr: run a quasi monte-carlo simulation on the environment lighting to create a prefilter (cube)map.
+    // ----------------------------------------------------------------------------------------------------
+    prefilterShader.use();
+    prefilterShader.setInt("environmentMap", 0);
+    prefilterShader.setMat4("projection", captureProjection);
+    glActiveTexture(GL_TEXTURE0);
+    glBindTexture(GL_TEXTURE_CUBE_MAP, envCubemap);
+
+    for (int mip = 0; mip < settings.prefilterMips; ++mip) {
+        // reisze framebuffer according to mip-level size.
+        int mipSize = settings.prefilterSize >> mip;
+        glBindRenderbuffer(GL_RENDERBUFFER, captureRBO);
+        glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH_COMPONENT24, mipSize, mipSize);
+        glViewport(0, 0, mipSize, mipSize);
+
+        float roughness = (float)mip / (float)(settings.prefilterMips - 1);
+        prefilterShader.setFloat("roughness", roughness);
+        for (unsigned int i = 0; i < 6; ++i) {
+            prefilterShader.setMat4("view", captureViews[i]);
+            glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_CUBE_MAP_POSITIVE_X + i, prefilterMap, mip);
+
+            glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+            renderCube();
+        }
+    }
+
+    // pbr: generate a 2D LUT from the BRDF equations used.
+    // ----------------------------------------------------
+    glBindRenderbuffer(GL_RENDERBUFFER, captureRBO);
+    glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH_COMPONENT24, settings.brdfSize, settings.brdfSize);
+    glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, brdfLUT, 0);
+
+    glViewport(0, 0, settings.brdfSize, settings.brdfSize);
+    brdfShader.use();
+    glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+    renderQuad();
+
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+
+    // the intermediates only exist to feed the passes above
+    glDeleteTextures(1, &envCubemap);
+    if (hdrTexture)
+        glDeleteTextures(1, &hdrTexture);
+    glDeleteRenderbuffers(1, &captureRBO);
+    glDeleteFramebuffers(1, &captureFBO);
+
+    if (hdrTexture) {
+        readBack();
+        writeCache();
+        releaseData();
+    }
+}
+
+void IBLMaps::createTextures() {
+    glGenTextures(1, &irradianceMap);
+    glGenTextures(1, &prefilterMap);
+    glGenTextures(1, &brdfLUT);
+
+    glBindTexture(GL_TEXTURE_2D, brdfLUT);
+    // be sure to set wrapping mode to GL_CLAMP_TO_EDGE
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+}
+
+void IBLMaps::uploadCubemap(unsigned int texture, int size, int mips, const uint16_t* data) {
+    glBindTexture(GL_TEXTURE_CUBE_MAP, texture);
+    for (int mip = 0; mip < mips; ++mip) {
+        int mipSize = size >> mip;
+        for (unsigned int i = 0; i < 6; ++i) {
+            glTexImage2D(GL_TEXTURE_CUBE_MAP_POSITIVE_X + i, mip, GL_RGB16F, mipSize, mipSize, 0, GL_RGB, GL_HALF_FLOAT, data);
+            if (data)
+                data += (size_t)mipSize * mipSize * 3;
+        }
+    }
+    // only the levels the bake renders exist, so the texture is complete without glGenerateMipmap
+    glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MAX_LEVEL, mips - 1);
+    setCubemapParameters(mips > 1 ? GL_LINEAR_MIPMAP_LINEAR : GL_LINEAR);
+}
+
+void IBLMaps::readBack() {
+    irradianceData.resize(cubemapTexels(settings.irradianceSize, 1) * 3);
+    prefilterData.resize(cubemapTexels(settings.prefilterSize, settings.prefilterMips) * 3);
+    brdfData.resize((size_t)settings.brdfSize * settings.brdfSize * 2);
+
+    glPixelStorei(GL_PACK_ALIGNMENT, 1);
+    uint16_t* irradiance = irradianceData.data();
+    glBindTexture(GL_TEXTURE_CUBE_MAP, irradianceMap);
+    for (unsigned int i = 0; i < 6; ++i) {
+        glGetTexImage(GL_TEXTURE_CUBE_MAP_POSITIVE_X + i, 0, GL_RGB, GL_HALF_FLOAT, irradiance);
+        irradiance += (size_t)settings.irradianceSize * settings.irradianceSize * 3;
+    }
+    uint16_t* prefilter = prefilterData.data();
+    glBindTexture(GL_TEXTURE_CUBE_MAP, prefilterMap);
+    for (int mip = 0; mip < settings.prefilterMips; ++mip) {
+        int mipSize = settings.prefilterSize >> mip;
+        for (unsigned int i = 0; i < 6; ++i) {
+            glGetTexImage(GL_TEXTURE_CUBE_MAP_POSITIVE_X + i, mip, GL_RGB, GL_HALF_FLOAT, prefilter);
+            prefilter += (size_t)mipSize * mipSize * 3;
+        }
+    }
+    glBindTexture(GL_TEXTURE_2D, brdfLUT);
+    glGetTexImage(GL_TEXTURE_2D, 0, GL_RG, GL_HALF_FLOAT, brdfData.data());
+    glPixelStorei(GL_PACK_ALIGNMENT, 4);
+}
+
+void IBLMaps::releaseData() {
+    // swapped out rather than cleared, which would keep the capacity for the whole session
+    std::vector<uint16_t>().swap(irradianceData);
+    std::vector<uint16_t>().swap(prefilterData);
+    std::vector<uint16_t>().swap(brdfData);
+}
+
+// cache layout: settings, HDR hash, irradiance faces, prefilter mips (six faces each), BRDF LUT
+bool IBLMaps::writeCache() const {
+    CacheWriter writer;
+    writer.Write(settings);
+    writer.Write(hdrHash ? hdrHash : AssetCache::HashFile(hdrPath));
+    writer.WriteArray(irradianceData.data(), irradianceData.size());
+    writer.WriteArray(prefilterData.data(), prefilterData.size());
+    writer.WriteArray(brdfData.data(), brdfData.size());
+    return writer.Save(hdrPath, AssetCache::IBLMaps);
+}
@@ -0,0 +1,68 @@
+#pragma once
+
+/* Image-based lighting maps for the PBR shader, baked from an equirectangular HDR.
+   The bake is deterministic: cubemap conversion, irradiance convolution, specular prefilter
+   and BRDF LUT. Its results are read back and stored in <hdr>.wwc, keyed by a hash of the HDR
+   file and the bake settings. Later runs upload that file and skip every render pass, and
+   "--bake-ibl" refreshes it headlessly. */
+
+#include <cstdint>
+#include <string>
+#include <vector>
+#include <glad/glad.h>
+#include <learnopengl/shader.h>
+#include "ImageData.h"
+
+struct IBLSettings {
+    int environmentSize = 512;
+    int irradianceSize = 32;
+    int prefilterSize = 128;
+    int prefilterMips = 5;   // roughness 0..1 across the levels; pbr.fs samples up to LOD 4
+    int brdfSize = 512;
+};
+
+class IBLMaps {
+public:
+    explicit IBLMaps(const std::string& hdrPath, const IBLSettings& settings = IBLSettings());
+    ~IBLMaps();
+
+    IBLMaps(const IBLMaps&) = delete;
+    IBLMaps& operator=(const IBLMaps&) = delete;
+
+    // worker-safe: hashes the HDR and reads a matching cache into memory; false means bake
+    bool readCache();
+
+    // GL thread: uploads what readCache read
+    void uploadCache();
+
+    // GL thread: renders every map from the decoded HDR (flipped, float) and writes the cache
+    void bake(const DecodedImage& hdr, Shader& equirectangularToCubemap, Shader& irradiance, Shader& prefilter, Shader& brdf);
+
+    bool hasCachedData() const { return !brdfData.empty(); }
+    const std::string& getHdrPath() const { return hdrPath; }
+    unsigned int getIrradianceMap() const { return irradianceMap; }
+    unsigned int getPrefilterMap() const { return prefilterMap; }
+    unsigned int getBrdfLUT() const { return brdfLUT; }
+
+private:
+    void createTextures();
+    void uploadCubemap(unsigned int texture, int size, int mips, const uint16_t* data);
+    // half-float texels straight from the GPU, so a reload is bit-identical to the bake
+    void readBack();
+    bool writeCache() const;
+    // frees the texel copies once they are on the GPU and in the cache file
+    void releaseData();
+
+    std::string hdrPath;
+    IBLSettings settings;
+    uint64_t hdrHash = 0;
+
+    unsigned int irradianceMap = 0;
+    unsigned int prefilterMap = 0;
+    unsigned int brdfLUT = 0;
+
+    // RGB16F cube faces (+X..-Z, every prefilter mip after the faces of the previous one) and RG16F LUT
+    std::vector<uint16_t> irradianceData;
+    std::vector<uint16_t> prefilterData;
+    std::vector<uint16_t> brdfData;
+};
@@ -0,0 +1,155 @@
+// ImageData.cpp
+#include "ImageData.h"
+#include "Profiler.h"
+#include <glad/glad.h>
+#include <stb_image.h>
+#include <cstring>
+#include <vector>
+#include <iostream>
+
+DecodedImage::~DecodedImage()
+{
+	if (pixels)
+		stbi_image_free(pixels);
+}
+
+DecodedImage::DecodedImage(DecodedImage&& other)
+{
+	*this = std::move(other);
+}
+
+DecodedImage& DecodedImage::operator=(DecodedImage&& other)
+{
+	if (this != &other)
+	{
+		if (pixels)
+			stbi_image_free(pixels);
+		path = std::move(other.path);
+		width = other.width;
+		height = other.height;
+		components = other.components;
+		isFloat = other.isFloat;
+		flipped = other.flipped;
+		contentHash = other.contentHash;
+		pixels = other.pixels;
+		other.pixels = nullptr;
+		compressedFormat = other.compressedFormat;
+		blocks = std::move(other.blocks);
+		levelSizes = std::move(other.levelSizes);
+	}
+	return *this;
+}
+
+DecodedImage DecodeImage(const std::string& path, bool flipVertically, bool asFloat)
+{
+	DecodedImage image;
+	image.path = path;
+	image.isFloat = asFloat;
+	if (asFloat)
+		image.pixels = stbi_loadf(path.c_str(), &image.width, &image.height, &image.components, 0);
+	else
+		image.pixels = stbi_load(path.c_str(), &image.width, &image.height, &image.components, 0);
+	image.flipped = flipVertically;
+	if (!image.pixels)
+		return image;
+
+	size_t rowBytes = (size_t)image.width * image.components * (asFloat ? sizeof(float) : 1);
+	if (flipVertically)
+	{
+		std::vector<unsigned char> row(rowBytes);
+		unsigned char* pixels = static_cast<unsigned char*>(image.pixels);
+		for (int top = 0, bottom = image.height - 1; top < bottom; top++, bottom--)
+		{
+			std::memcpy(row.data(), pixels + top * rowBytes, rowBytes);
+			std::memcpy(pixels + top * rowBytes, pixels + bottom * rowBytes, rowBytes);
+			std::memcpy(pixels + bottom * rowBytes, row.data(), rowBytes);
+		}
+	}
+	image.contentHash = HashImageContents(image);
+	return image;
+}
+
+// FNV-1a over 64-bit words; only used to spot identical textures, so speed beats mixing quality
+uint64_t HashImageContents(const DecodedImage& image)
+{
+	const uint64_t prime = 1099511628211ull;
+	uint64_t hash = 14695981039346656037ull;
+	uint64_t layout[] = { (uint64_t)image.width, (uint64_t)image.height, (uint64_t)image.components,
+		(uint64_t)image.isFloat, (uint64_t)image.compressedFormat };
+	for (uint64_t value : layout)
+		hash = (hash ^ value) * prime;
+
+	const unsigned char* bytes = image.IsCompressed() ? image.blocks.data() : static_cast<const unsigned char*>(image.pixels);
+	size_t byteCount = image.IsCompressed() ? image.blocks.size()
+		: (size_t)image.width * image.height * image.components * (image.isFloat ? sizeof(float) : 1);
+	if (!bytes)
+		return hash;
+	size_t i = 0;
+	for (; i + sizeof(uint64_t) <= byteCount; i += sizeof(uint64_t))
+	{
+		uint64_t word;
+		std::memcpy(&word, bytes + i, sizeof(word));
+		hash = (hash ^ word) * prime;
+	}
+	for (; i < byteCount; i++)
+		hash = (hash ^ bytes[i]) * prime;
+	return hash;
+}
+
+unsigned int CreateTexture2D(const DecodedImage& image)
+{
+	static ProfileSection s_RawUpload("Texture upload (raw + mipgen)", "texture");
+	static ProfileSection s_CompressedUpload("Texture upload (cooked)", "texture");
+
+	if (!image.IsValid())
+	{
+		std::cout << "Texture failed to load at path: " << image.path << std::endl;
+		return 0;
+	}
+
+	if (image.IsCompressed())
+	{
+		ProfileScope profile(s_CompressedUpload);
+		unsigned int textureID;
+		glGenTextures(1, &textureID);
+		glBindTexture(GL_TEXTURE_2D, textureID);
+		const unsigned char* level = image.blocks.data();
+		int width = image.width, height = image.height;
+		for (size_t i = 0; i < image.levelSizes.size(); i++)
+		{
+			glCompressedTexImage2D(GL_TEXTURE_2D, (GLint)i, image.compressedFormat, width, height, 0, image.levelSizes[i], level);
+			level += image.levelSizes[i];
+			width = width > 1 ? width / 2 : 1;
+			height = height > 1 ? height / 2 : 1;
+		}
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, (GLint)image.levelSizes.size() - 1);
+
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+		return textureID;
+	}
+
+	ProfileScope profile(s_RawUpload);
+
+	GLenum format = GL_RGB;
+	if (image.components == 1)
+		format = GL_RED;
+	else if (image.components == 3)
+		format = GL_RGB;
+	else if (image.components == 4)
+		format = GL_RGBA;
+
+	unsigned int textureID;
+	glGenTextures(1, &textureID);
+	glBindTexture(GL_TEXTURE_2D, textureID);
+	glTexImage2D(GL_TEXTURE_2D, 0, format, image.width, image.height, 0, format, GL_UNSIGNED_BYTE, image.pixels);
+	glGenerateMipmap(GL_TEXTURE_2D);
+
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+	return textureID;
+}
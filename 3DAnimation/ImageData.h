@@ -0,0 +1,47 @@
+#pragma once
+
+/* Decoded image pixels, split from GL texture creation so decoding can run on a worker.
+   stb_image's flip switch is one global, which workers can't share, so DecodeImage
+   always decodes unflipped and flips the rows itself. */
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+struct DecodedImage
+{
+	DecodedImage() = default;
+	~DecodedImage();
+	DecodedImage(DecodedImage&& other);
+	DecodedImage& operator=(DecodedImage&& other);
+	DecodedImage(const DecodedImage&) = delete;
+	DecodedImage& operator=(const DecodedImage&) = delete;
+
+	bool IsValid() const { return pixels != nullptr || !blocks.empty(); }
+	bool IsCompressed() const { return compressedFormat != 0; }
+
+	std::string path;
+	int width = 0;
+	int height = 0;
+	int components = 0;
+	bool isFloat = false;   // pixels are floats (HDR) rather than bytes
+	bool flipped = false;   // rows were flipped after decoding
+	uint64_t contentHash = 0; // of size, layout and pixels, computed by DecodeImage off the GL thread
+	void* pixels = nullptr; // owned; released with stbi_image_free
+
+	// cooked textures (see TextureCook.h) carry block-compressed mip levels instead of pixels
+	unsigned int compressedFormat = 0;  // GL internal format; 0 for plain pixels
+	std::vector<unsigned char> blocks;  // every mip level back to back, level 0 first
+	std::vector<uint32_t> levelSizes;
+};
+
+// thread-safe as long as nothing turns stb_image's global flip on while workers decode
+DecodedImage DecodeImage(const std::string& path, bool flipVertically, bool asFloat = false);
+
+// hash of size, layout and pixel (or block) data, for spotting identical textures
+uint64_t HashImageContents(const DecodedImage& image);
+
+// GL thread: mipmapped, repeating 2D texture in the image's own channel layout, as
+// TextureFromFile and loadTexture always created them. Cooked images upload their stored
+// mip levels as they are. 0 if the image failed to decode.
+unsigned int CreateTexture2D(const DecodedImage& image);
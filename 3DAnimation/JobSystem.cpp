@@ -0,0 +1,96 @@
+// JobSystem.cpp
+#include "JobSystem.h"
+
+unsigned int JobSystem::DefaultWorkerCount()
+{
+	unsigned int hardwareThreads = std::thread::hardware_concurrency();
+	return hardwareThreads > 1 ? hardwareThreads - 1 : 1;
+}
+
+JobSystem::JobSystem(unsigned int workerCount)
+{
+	for (unsigned int i = 0; i < workerCount; i++)
+		m_Workers.emplace_back(&JobSystem::WorkerLoop, this);
+}
+
+JobSystem::~JobSystem()
+{
+	{
+		std::lock_guard<std::mutex> lock(m_Mutex);
+		m_Stopping = true;
+	}
+	m_WorkReady.notify_all();
+	for (std::thread& worker : m_Workers)
+		worker.join();
+}
+
+void JobSystem::Submit(std::function<void()> job)
+{
+	{
+		std::lock_guard<std::mutex> lock(m_Mutex);
+		m_Jobs.push_back(std::move(job));
+		m_Unfinished++;
+	}
+	m_WorkReady.notify_one();
+}
+
+void JobSystem::PostToMain(std::function<void()> completion)
+{
+	{
+		std::lock_guard<std::mutex> lock(m_Mutex);
+		m_Completions.push_back(std::move(completion));
+	}
+	m_Progress.notify_all();
+}
+
+int JobSystem::RunCompletions()
+{
+	std::deque<std::function<void()>> ready;
+	{
+		std::lock_guard<std::mutex> lock(m_Mutex);
+		ready.swap(m_Completions);
+	}
+	for (std::function<void()>& completion : ready)
+		completion();
+	return (int)ready.size();
+}
+
+void JobSystem::WaitAll()
+{
+	for (;;)
+	{
+		{
+			std::unique_lock<std::mutex> lock(m_Mutex);
+			m_Progress.wait(lock, [this] { return !m_Completions.empty() || m_Unfinished == 0; });
+			// a job posts its completions before it counts as finished, so nothing can follow
+			if (m_Completions.empty() && m_Unfinished == 0)
+				return;
+		}
+		// completions may submit follow-up jobs; the loop simply keeps waiting for those too
+		RunCompletions();
+	}
+}
+
+void JobSystem::WorkerLoop()
+{
+	for (;;)
+	{
+		std::function<void()> job;
+		{
+			std::unique_lock<std::mutex> lock(m_Mutex);
+			m_WorkReady.wait(lock, [this] { return m_Stopping || !m_Jobs.empty(); });
+			if (m_Jobs.empty())
+				return;
+			job = std::move(m_Jobs.front());
+			m_Jobs.pop_front();
+		}
+
+		job();
+
+		{
+			std::lock_guard<std::mutex> lock(m_Mutex);
+			m_Unfinished--;
+		}
+		m_Progress.notify_all();
+	}
+}
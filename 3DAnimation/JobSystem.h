@@ -0,0 +1,52 @@
+#pragma once
+
+/* Worker pool for CPU-side asset work plus a completion queue back to the GL context thread.
+   Jobs must not touch OpenGL. Anything that needs GL is posted with PostToMain and runs on
+   the context thread inside RunCompletions / WaitAll, in the order it was posted. */
+
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+class JobSystem
+{
+public:
+	// one worker per hardware thread, leaving the context thread its own core
+	static unsigned int DefaultWorkerCount();
+
+	explicit JobSystem(unsigned int workerCount = DefaultWorkerCount());
+	~JobSystem();
+
+	JobSystem(const JobSystem&) = delete;
+	JobSystem& operator=(const JobSystem&) = delete;
+
+	// queues CPU work for any worker
+	void Submit(std::function<void()> job);
+
+	// queues GL work for the context thread; callable from jobs and from the context thread
+	void PostToMain(std::function<void()> completion);
+
+	// context thread only: runs every completion queued so far, returns how many ran
+	int RunCompletions();
+
+	// context thread only: returns once every submitted job has finished and every completion
+	// they posted has run, running completions as they arrive so uploads overlap parsing
+	void WaitAll();
+
+	unsigned int GetWorkerCount() const { return (unsigned int)m_Workers.size(); }
+
+private:
+	void WorkerLoop();
+
+	std::vector<std::thread> m_Workers;
+	std::mutex m_Mutex;
+	std::condition_variable m_WorkReady;
+	std::condition_variable m_Progress;
+	std::deque<std::function<void()>> m_Jobs;
+	std::deque<std::function<void()>> m_Completions;
+	int m_Unfinished = 0; // jobs queued or running
+	bool m_Stopping = false;
+};
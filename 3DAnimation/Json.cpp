@@ -0,0 +1,298 @@
+// Json.cpp
+#include "Json.h"
+#include <cstdlib>
+#include <fstream>
+#include <sstream>
+
+// recursive descent over the document text; position only ever moves forward
+class JsonParser
+{
+public:
+	explicit JsonParser(const std::string& text) : m_Text(text) {}
+
+	bool ParseDocument(JsonValue& out, std::string& error)
+	{
+		SkipWhitespace();
+		if (!ParseValue(out, 0))
+		{
+			error = m_Error;
+			return false;
+		}
+		SkipWhitespace();
+		if (m_Position != m_Text.size())
+		{
+			Fail("unexpected text after the document");
+			error = m_Error;
+			return false;
+		}
+		return true;
+	}
+
+private:
+	// deep enough for any data file, shallow enough that a corrupt one can't exhaust the stack
+	static const int MaxDepth = 64;
+
+	bool ParseValue(JsonValue& out, int depth)
+	{
+		if (depth > MaxDepth)
+			return Fail("nested too deeply");
+		if (m_Position >= m_Text.size())
+			return Fail("unexpected end of file");
+
+		char c = m_Text[m_Position];
+		if (c == '{')
+			return ParseObject(out, depth);
+		if (c == '[')
+			return ParseArray(out, depth);
+		if (c == '"')
+		{
+			out.m_Type = JsonValue::String;
+			return ParseString(out.m_String);
+		}
+		if (c == '-' || (c >= '0' && c <= '9'))
+			return ParseNumber(out);
+		if (Match("true"))
+		{
+			out.m_Type = JsonValue::Bool;
+			out.m_Bool = true;
+			return true;
+		}
+		if (Match("false"))
+		{
+			out.m_Type = JsonValue::Bool;
+			out.m_Bool = false;
+			return true;
+		}
+		if (Match("null"))
+		{
+			out.m_Type = JsonValue::Null;
+			return true;
+		}
+		return Fail("expected a value");
+	}
+
+	bool ParseObject(JsonValue& out, int depth)
+	{
+		out.m_Type = JsonValue::Object;
+		m_Position++;
+		SkipWhitespace();
+		if (Peek() == '}')
+		{
+			m_Position++;
+			return true;
+		}
+		for (;;)
+		{
+			SkipWhitespace();
+			if (Peek() != '"')
+				return Fail("expected a member name");
+			out.m_Members.emplace_back();
+			if (!ParseString(out.m_Members.back().first))
+				return false;
+			SkipWhitespace();
+			if (Peek() != ':')
+				return Fail("expected ':'");
+			m_Position++;
+			SkipWhitespace();
+			if (!ParseValue(out.m_Members.back().second, depth + 1))
+				return false;
+			SkipWhitespace();
+			char c = Peek();
+			m_Position++;
+			if (c == '}')
+				return true;
+			if (c != ',')
+			{
+				m_Position--;
+				return Fail("expected ',' or '}'");
+			}
+		}
+	}
+
+	bool ParseArray(JsonValue& out, int depth)
+	{
+		out.m_Type = JsonValue::Array;
+		m_Position++;
+		SkipWhitespace();
+		if (Peek() == ']')
+		{
+			m_Position++;
+			return true;
+		}
+		for (;;)
+		{
+			SkipWhitespace();
+			out.m_Elements.emplace_back();
+			if (!ParseValue(out.m_Elements.back(), depth + 1))
+				return false;
+			SkipWhitespace();
+			char c = Peek();
+			m_Position++;
+			if (c == ']')
+				return true;
+			if (c != ',')
+			{
+				m_Position--;
+				return Fail("expected ',' or ']'");
+			}
+		}
+	}
+
+	bool ParseString(std::string& out)
+	{
+		m_Position++;
+		while (m_Position < m_Text.size())
+		{
+			char c = m_Text[m_Position++];
+			if (c == '"')
+				return true;
+			if ((unsigned char)c < 0x20)
+				return Fail("control character in string");
+			if (c != '\\')
+			{
+				out += c;
+				continue;
+			}
+			if (m_Position >= m_Text.size())
+				break;
+			char escape = m_Text[m_Position++];
+			switch (escape)
+			{
+			case '"': out += '"'; break;
+			case '\\': out += '\\'; break;
+			case '/': out += '/'; break;
+			case 'b': out += '\b'; break;
+			case 'f': out += '\f'; break;
+			case 'n': out += '\n'; break;
+			case 'r': out += '\r'; break;
+			case 't': out += '\t'; break;
+			case 'u':
+			{
+				if (m_Position + 4 > m_Text.size())
+					return Fail("truncated \\u escape");
+				char* end = nullptr;
+				std::string hex = m_Text.substr(m_Position, 4);
+				unsigned long code = std::strtoul(hex.c_str(), &end, 16);
+				if (end != hex.c_str() + 4)
+					return Fail("bad \\u escape");
+				m_Position += 4;
+				// UTF-8 for the basic plane; surrogate pairs never appear in our data files
+				if (code < 0x80)
+					out += (char)code;
+				else if (code < 0x800)
+				{
+					out += (char)(0xC0 | (code >> 6));
+					out += (char)(0x80 | (code & 0x3F));
+				}
+				else
+				{
+					out += (char)(0xE0 | (code >> 12));
+					out += (char)(0x80 | ((code >> 6) & 0x3F));
+					out += (char)(0x80 | (code & 0x3F));
+				}
+				break;
+			}
+			default:
+				m_Position--;
+				return Fail("unknown escape");
+			}
+		}
+		return Fail("unterminated string");
+	}
+
+	bool ParseNumber(JsonValue& out)
+	{
+		const char* start = m_Text.c_str() + m_Position;
+		char* end = nullptr;
+		double number = std::strtod(start, &end);
+		if (end == start)
+			return Fail("bad number");
+		out.m_Type = JsonValue::Number;
+		out.m_Number = number;
+		m_Position += end - start;
+		return true;
+	}
+
+	bool Match(const char* literal)
+	{
+		size_t length = std::char_traits<char>::length(literal);
+		if (m_Text.compare(m_Position, length, literal) != 0)
+			return false;
+		m_Position += length;
+		return true;
+	}
+
+	char Peek() const { return m_Position < m_Text.size() ? m_Text[m_Position] : '\0'; }
+
+	void SkipWhitespace()
+	{
+		while (m_Position < m_Text.size() && (m_Text[m_Position] == ' ' || m_Text[m_Position] == '\t'
+			|| m_Text[m_Position] == '\n' || m_Text[m_Position] == '\r'))
+			m_Position++;
+	}
+
+	bool Fail(const char* message)
+	{
+		int line = 1;
+		int column = 1;
+		for (size_t i = 0; i < m_Position && i < m_Text.size(); i++)
+		{
+			if (m_Text[i] == '\n')
+			{
+				line++;
+				column = 1;
+			}
+			else
+				column++;
+		}
+		std::ostringstream error;
+		error << "line " << line << ", column " << column << ": " << message;
+		m_Error = error.str();
+		return false;
+	}
+
+	const std::string& m_Text;
+	size_t m_Position = 0;
+	std::string m_Error;
+};
+
+const JsonValue& JsonValue::operator[](const std::string& key) const
+{
+	static const JsonValue s_Null;
+	for (const auto& member : m_Members)
+	{
+		if (member.first == key)
+			return member.second;
+	}
+	return s_Null;
+}
+
+bool JsonValue::Has(const std::string& key) const
+{
+	for (const auto& member : m_Members)
+	{
+		if (member.first == key)
+			return true;
+	}
+	return false;
+}
+
+bool JsonValue::Parse(const std::string& text, JsonValue& out, std::string& error)
+{
+	out = JsonValue();
+	JsonParser parser(text);
+	return parser.ParseDocument(out, error);
+}
+
+bool JsonValue::ParseFile(const std::string& path, JsonValue& out, std::string& error)
+{
+	std::ifstream file(path, std::ios::binary);
+	if (!file)
+	{
+		error = "could not open the file";
+		return false;
+	}
+	std::ostringstream text;
+	text << file.rdbuf();
+	return Parse(text.str(), out, error);
+}
@@ -0,0 +1,62 @@
+#pragma once
+
+/* Minimal JSON reader for the data files the game loads at startup (fighter definitions).
+   It builds a small tree of JsonValues; objects keep their members in file order, so arrays of
+   named entries and objects read back the way they were written. Parse failures report the
+   line and column of the offending character. */
+
+#include <string>
+#include <utility>
+#include <vector>
+
+class JsonValue
+{
+public:
+	enum Type
+	{
+		Null,
+		Bool,
+		Number,
+		String,
+		Array,
+		Object
+	};
+
+	Type GetType() const { return m_Type; }
+	bool IsNull() const { return m_Type == Null; }
+	bool IsNumber() const { return m_Type == Number; }
+	bool IsString() const { return m_Type == String; }
+	bool IsArray() const { return m_Type == Array; }
+	bool IsObject() const { return m_Type == Object; }
+
+	// the value, or fallback if this is not of that type
+	bool AsBool(bool fallback = false) const { return m_Type == Bool ? m_Bool : fallback; }
+	double AsNumber(double fallback = 0.0) const { return m_Type == Number ? m_Number : fallback; }
+	float AsFloat(float fallback = 0.0f) const { return m_Type == Number ? (float)m_Number : fallback; }
+	int AsInt(int fallback = 0) const { return m_Type == Number ? (int)m_Number : fallback; }
+	const std::string& AsString() const { return m_String; }
+
+	// array elements; empty for anything but an array
+	const std::vector<JsonValue>& GetElements() const { return m_Elements; }
+
+	// object members in file order; empty for anything but an object
+	const std::vector<std::pair<std::string, JsonValue>>& GetMembers() const { return m_Members; }
+
+	// the member called key, or a shared null value if there is none
+	const JsonValue& operator[](const std::string& key) const;
+	bool Has(const std::string& key) const;
+
+	// parses a whole document; on failure returns false and describes the problem in error
+	static bool Parse(const std::string& text, JsonValue& out, std::string& error);
+	static bool ParseFile(const std::string& path, JsonValue& out, std::string& error);
+
+private:
+	friend class JsonParser;
+
+	Type m_Type = Null;
+	bool m_Bool = false;
+	double m_Number = 0.0;
+	std::string m_String;
+	std::vector<JsonValue> m_Elements;
+	std::vector<std::pair<std::string, JsonValue>> m_Members;
+};
@@ -43,7 +43,7 @@ void Player::update(float deltaTime) {
     // Additional update logic here
 }
 
-std::vector<glm::mat4> Player::GetFinalBoneMatrices() {
+BonePalette Player::GetFinalBoneMatrices() const {
     return animator.GetFinalBoneMatrices();
 }
 
@@ -35,7 +35,7 @@ public:
     void updateAnimation(float deltaTime);
     void setAnimation(const std::string& animName);
     void update(float deltaTime);
-    std::vector<glm::mat4>GetFinalBoneMatrices();
+    BonePalette GetFinalBoneMatrices() const;
     void draw(Shader& shader);
     void processInput(int key);
     void changeState(AnimState newState);
@@ -0,0 +1,155 @@
+#pragma once
+
+/* Lightweight named timers and counters for in-game profiling.
+   Sections are declared once as statics and chain themselves into a global list,
+   so timing a hot path costs two clock reads and two atomic adds - no lookups or allocations. */
+
+#include <atomic>
+#include <chrono>
+#include <iostream>
+#include <iomanip>
+#include <mutex>
+
+// A named event count. Unlike sections, counters are always reported - including when they
+// stay at zero, which is usually the point of having them.
+class ProfileCounter
+{
+public:
+	explicit ProfileCounter(const char* name);
+
+	void Increment(long long count = 1) { m_Count.fetch_add(count, std::memory_order_relaxed); }
+	long long GetCount() const { return m_Count; }
+
+private:
+	friend class ProfileSection;
+
+	const char* m_Name;
+	std::atomic<long long> m_Count;
+	ProfileCounter* m_Next;
+};
+
+class ProfileSection
+{
+public:
+	explicit ProfileSection(const char* name, const char* unit = "call")
+		: m_Name(name), m_Unit(unit), m_Nanoseconds(0), m_Count(0)
+	{
+		// function-local statics can be first reached on a loader worker
+		std::lock_guard<std::mutex> lock(RegistryMutex());
+		m_Next = Head();
+		Head() = this;
+	}
+
+	void Add(long long nanoseconds, long long count = 1)
+	{
+		m_Nanoseconds.fetch_add(nanoseconds, std::memory_order_relaxed);
+		m_Count.fetch_add(count, std::memory_order_relaxed);
+	}
+
+	void Reset()
+	{
+		m_Nanoseconds = 0;
+		m_Count = 0;
+	}
+
+	const char* GetName() const { return m_Name; }
+	long long GetNanoseconds() const { return m_Nanoseconds; }
+	long long GetCount() const { return m_Count; }
+
+	// call once per rendered frame so counters can be reported as per-frame averages
+	static void EndFrame() { Frames()++; }
+
+	// prints every section that has been hit since the last reset, then clears them
+	static void Report(std::ostream& out)
+	{
+		long long frames = Frames();
+		out << "---- profile (" << frames << " frames) ----" << std::endl;
+		for (ProfileSection* section = Head(); section; section = section->m_Next)
+		{
+			long long count = section->m_Count;
+			if (count == 0)
+				continue;
+			double totalMs = section->m_Nanoseconds / 1.0e6;
+			double perUnit = static_cast<double>(section->m_Nanoseconds) / count;
+			out << std::left << std::setw(32) << section->m_Name << std::right
+				<< std::fixed << std::setprecision(3) << std::setw(12) << totalMs << " ms  "
+				<< std::setw(12) << count << " " << section->m_Unit << "s  "
+				<< std::setprecision(1) << std::setw(10) << perUnit << " ns/" << section->m_Unit << std::endl;
+			section->Reset();
+		}
+		for (ProfileCounter* counter = CounterHead(); counter; counter = counter->m_Next)
+		{
+			long long count = counter->m_Count;
+			out << std::left << std::setw(32) << counter->m_Name << std::right
+				<< std::setw(12) << count << " total  "
+				<< std::fixed << std::setprecision(2) << std::setw(10) << (frames ? static_cast<double>(count) / frames : 0.0) << " /frame" << std::endl;
+			counter->m_Count = 0;
+		}
+		Frames() = 0;
+	}
+
+private:
+	friend class ProfileCounter;
+
+	static ProfileSection*& Head()
+	{
+		static ProfileSection* head = nullptr;
+		return head;
+	}
+
+	static ProfileCounter*& CounterHead()
+	{
+		static ProfileCounter* head = nullptr;
+		return head;
+	}
+
+	static std::mutex& RegistryMutex()
+	{
+		static std::mutex mutex;
+		return mutex;
+	}
+
+	static std::atomic<long long>& Frames()
+	{
+		static std::atomic<long long> frames(0);
+		return frames;
+	}
+
+	const char* m_Name;
+	const char* m_Unit;
+	std::atomic<long long> m_Nanoseconds;
+	std::atomic<long long> m_Count;
+	ProfileSection* m_Next;
+};
+
+inline ProfileCounter::ProfileCounter(const char* name)
+	: m_Name(name), m_Count(0)
+{
+	std::lock_guard<std::mutex> lock(ProfileSection::RegistryMutex());
+	m_Next = ProfileSection::CounterHead();
+	ProfileSection::CounterHead() = this;
+}
+
+// Times the enclosing scope into a section. The unit count defaults to one call but can be
+// raised before the scope closes (e.g. number of bones sampled) to report per-item cost.
+class ProfileScope
+{
+public:
+	explicit ProfileScope(ProfileSection& section, long long count = 1)
+		: m_Section(section), m_Count(count), m_Start(std::chrono::high_resolution_clock::now())
+	{
+	}
+
+	~ProfileScope()
+	{
+		auto elapsed = std::chrono::high_resolution_clock::now() - m_Start;
+		m_Section.Add(std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed).count(), m_Count);
+	}
+
+	void SetCount(long long count) { m_Count = count; }
+
+private:
+	ProfileSection& m_Section;
+	long long m_Count;
+	std::chrono::high_resolution_clock::time_point m_Start;
+};
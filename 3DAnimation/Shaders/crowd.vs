@@ -0,0 +1,60 @@
+#version 330 core
+
+layout(location = 0) in vec3 pos;
+layout(location = 2) in vec2 tex;
+layout(location = 5) in ivec4 boneIds;
+layout(location = 6) in vec4 weights;
+// per instance: xyz position, w yaw / x first row, y frame count, z phase, w frames per second
+layout(location = 7) in vec4 placement;
+layout(location = 8) in vec4 playback;
+
+uniform mat4 projection;
+uniform mat4 view;
+uniform float modelScale;
+uniform float time;
+// one row per baked frame, three texels (the rows of a 3x4 skinning matrix) per bone
+uniform sampler2D boneTexture;
+
+const int MAX_BONES = 100;
+const int MAX_BONE_INFLUENCE = 4;
+
+out vec2 TexCoords;
+
+vec3 skin(int row, vec4 position)
+{
+    // like anim_model.vs, a vertex with a bone past the palette stays unskinned; the baked
+    // texture can hold fewer bones than MAX_BONES
+    int boneCount = textureSize(boneTexture, 0).x / 3;
+    vec3 skinned = vec3(0.0);
+    for (int i = 0; i < MAX_BONE_INFLUENCE; i++)
+    {
+        if (boneIds[i] < 0)
+            continue;
+        if (boneIds[i] >= MAX_BONES || boneIds[i] >= boneCount)
+            return position.xyz;
+        int column = boneIds[i] * 3;
+        vec4 r0 = texelFetch(boneTexture, ivec2(column, row), 0);
+        vec4 r1 = texelFetch(boneTexture, ivec2(column + 1, row), 0);
+        vec4 r2 = texelFetch(boneTexture, ivec2(column + 2, row), 0);
+        skinned += vec3(dot(r0, position), dot(r1, position), dot(r2, position)) * weights[i];
+    }
+    return skinned;
+}
+
+void main()
+{
+    // the clip loops, so the frame after the last one is the first
+    float frame = mod(time * playback.w + playback.z, playback.y);
+    int frameCount = int(playback.y);
+    int frame0 = int(frame);
+    int frame1 = frame0 + 1 < frameCount ? frame0 + 1 : 0;
+    int firstRow = int(playback.x);
+    vec4 position = vec4(pos, 1.0);
+    vec3 local = mix(skin(firstRow + frame0, position), skin(firstRow + frame1, position), fract(frame)) * modelScale;
+
+    float s = sin(placement.w);
+    float c = cos(placement.w);
+    vec3 world = vec3(local.x * c + local.z * s, local.y, -local.x * s + local.z * c) + placement.xyz;
+    gl_Position = projection * view * vec4(world, 1.0);
+    TexCoords = tex;
+}
@@ -0,0 +1,106 @@
+#pragma once
+
+/* Fixed-step clock for the game simulation. Each rendered frame hands its measured duration to
+   Advance, which returns how many whole ticks of GetStep() seconds the simulation owes; the
+   remainder carries over to the next frame. Gameplay therefore always integrates with the same
+   step and reaches the same result at any frame rate, and rendering blends the last two ticks
+   with GetAlpha().
+   Hit-stop is part of the clock too: HitStop marks the next ticks as frozen, and the loop asks
+   ConsumeFrozenTick before each one. Frozen ticks still come due at the normal rate, so only
+   the simulation pauses; rendering, audio and input carry on every frame. */
+
+#include <cmath>
+
+class SimulationClock
+{
+public:
+	explicit SimulationClock(double tickRate = 60.0, int maxTicksPerFrame = 8)
+		: m_Step(1.0 / tickRate), m_MaxTicksPerFrame(maxTicksPerFrame)
+	{
+	}
+
+	// adds one frame's wall-clock time and returns the ticks to run now. After a long stall
+	// (debugger, window drag) the backlog is dropped past m_MaxTicksPerFrame so the
+	// simulation slows down instead of spiralling further behind.
+	int Advance(double frameSeconds)
+	{
+		if (frameSeconds > 0.0)
+			m_Accumulator += frameSeconds;
+
+		int ticks = 0;
+		while (m_Accumulator >= m_Step && ticks < m_MaxTicksPerFrame)
+		{
+			m_Accumulator -= m_Step;
+			ticks++;
+		}
+		if (ticks == m_MaxTicksPerFrame && m_Accumulator >= m_Step)
+			m_Accumulator = 0.0;
+
+		m_Tick += ticks;
+		return ticks;
+	}
+
+	// seconds simulated per tick, the dt every gameplay update receives
+	float GetStep() const { return (float)m_Step; }
+
+	// most ticks one Advance returns; past it the backlog is dropped
+	int GetMaxTicksPerFrame() const { return m_MaxTicksPerFrame; }
+
+	// fraction of a tick already elapsed past the latest one: 0 shows the previous tick's
+	// state, 1 the latest
+	float GetAlpha() const { return (float)(m_Accumulator / m_Step); }
+
+	// ticks simulated since construction or Reset
+	long long GetTick() const { return m_Tick; }
+
+	// freezes the ticks covering the next `seconds`. A longer stop replaces a shorter one still
+	// running; a shorter one never cuts a longer one short. freezeAnimators=false keeps the
+	// animation clocks running through the stop.
+	void HitStop(float seconds, bool freezeAnimators = true)
+	{
+		int ticks = (int)std::ceil(seconds / m_Step - 1e-6);
+		if (ticks > m_FrozenTicks)
+		{
+			m_FrozenTicks = ticks;
+			m_FreezeAnimators = freezeAnimators;
+		}
+		m_HitStops++;
+	}
+
+	// once per due tick, before simulating it: true if the tick is frozen, using it up
+	bool ConsumeFrozenTick()
+	{
+		if (m_FrozenTicks == 0)
+			return false;
+		m_FrozenTicks--;
+		m_TotalFrozenTicks++;
+		return true;
+	}
+
+	bool IsFrozen() const { return m_FrozenTicks > 0; }
+	bool IsFreezingAnimators() const { return m_FreezeAnimators; }
+
+	// hit-stops requested and ticks frozen since construction or Reset
+	long long GetHitStopCount() const { return m_HitStops; }
+	long long GetFrozenTickCount() const { return m_TotalFrozenTicks; }
+
+	void Reset()
+	{
+		m_Accumulator = 0.0;
+		m_Tick = 0;
+		m_FrozenTicks = 0;
+		m_FreezeAnimators = true;
+		m_HitStops = 0;
+		m_TotalFrozenTicks = 0;
+	}
+
+private:
+	double m_Step;
+	double m_Accumulator = 0.0;
+	int m_MaxTicksPerFrame;
+	long long m_Tick = 0;
+	int m_FrozenTicks = 0;
+	bool m_FreezeAnimators = true;
+	long long m_HitStops = 0;
+	long long m_TotalFrozenTicks = 0;
+};
@@ -1,20 +1,28 @@
 // Skybox.cpp
 #include "Skybox.h"
-#include "Skybox.h"
-#include <stb_image.h>
 #include <iostream>
 #include <glm/gtc/type_ptr.hpp>
 
 Skybox::Skybox(const std::vector<std::string>& faces, unsigned int shaderProg)
     : faces(faces), shaderProgram(shaderProg) {
-    load();
+    std::vector<DecodedImage> faceImages;
+    for (const std::string& face : faces)
+        faceImages.push_back(DecodeImage(face, true));
+    load(faceImages);
+}
+
+Skybox::Skybox(const std::vector<DecodedImage>& faceImages, unsigned int shaderProg)
+    : shaderProgram(shaderProg) {
+    for (const DecodedImage& image : faceImages)
+        faces.push_back(image.path);
+    load(faceImages);
 }
 
 Skybox::~Skybox() {
     glDeleteVertexArrays(1, &skyboxVAO);
     glDeleteBuffers(1, &skyboxVBO);
 }
-void Skybox::load() {
+void Skybox::load(const std::vector<DecodedImage>& faceImages) {
     float skyboxVertices[] = {
         // positions          
         -1.0f,  1.0f, -1.0f,
@@ -67,25 +75,24 @@ void Skybox::load() {
     glEnableVertexAttribArray(0);
     glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 3 * sizeof(float), (void*)0);
 
-    cubemapTexture = loadCubemap(faces);
+    cubemapTexture = loadCubemap(faceImages);
 
+    viewLocation = glGetUniformLocation(shaderProgram, "view");
+    projectionLocation = glGetUniformLocation(shaderProgram, "projection");
 }
 
-unsigned int Skybox::loadCubemap(const std::vector<std::string>& faces) {
+unsigned int Skybox::loadCubemap(const std::vector<DecodedImage>& faceImages) {
     unsigned int textureID;
     glGenTextures(1, &textureID);
     glBindTexture(GL_TEXTURE_CUBE_MAP, textureID);
 
-    int width, height, nrChannels;
-    for (unsigned int i = 0; i < faces.size(); i++) {
-        unsigned char* data = stbi_load(faces[i].c_str(), &width, &height, &nrChannels, 0);
-        if (data) {
-            glTexImage2D(GL_TEXTURE_CUBE_MAP_POSITIVE_X + i, 0, GL_RGB, width, height, 0, GL_RGB, GL_UNSIGNED_BYTE, data);
-            stbi_image_free(data);
+    for (unsigned int i = 0; i < faceImages.size(); i++) {
+        const DecodedImage& image = faceImages[i];
+        if (image.IsValid()) {
+            glTexImage2D(GL_TEXTURE_CUBE_MAP_POSITIVE_X + i, 0, GL_RGB, image.width, image.height, 0, GL_RGB, GL_UNSIGNED_BYTE, image.pixels);
         }
         else {
-            std::cerr << "Cubemap texture failed to load at path: " << faces[i] << std::endl;
-            stbi_image_free(data);
+            std::cerr << "Cubemap texture failed to load at path: " << image.path << std::endl;
         }
     }
     glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
@@ -100,8 +107,8 @@ unsigned int Skybox::loadCubemap(const std::vector<std::string>& faces) {
 void Skybox::draw(glm::mat4 view, glm::mat4 projection) {
     glDepthFunc(GL_LEQUAL);
     glUseProgram(shaderProgram);
-    glUniformMatrix4fv(glGetUniformLocation(shaderProgram, "view"), 1, GL_FALSE, glm::value_ptr(glm::mat4(glm::mat3(view))));
-    glUniformMatrix4fv(glGetUniformLocation(shaderProgram, "projection"), 1, GL_FALSE, glm::value_ptr(projection));
+    glUniformMatrix4fv(viewLocation, 1, GL_FALSE, glm::value_ptr(glm::mat4(glm::mat3(view))));
+    glUniformMatrix4fv(projectionLocation, 1, GL_FALSE, glm::value_ptr(projection));
 
     glBindVertexArray(skyboxVAO);
     glActiveTexture(GL_TEXTURE0);
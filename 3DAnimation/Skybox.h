@@ -4,20 +4,24 @@
 #include <string>
 #include <glad/glad.h>
 #include <glm/glm.hpp>
+#include "ImageData.h"
 
 class Skybox {
 public:
     Skybox(const std::vector<std::string>& faces, unsigned int shaderProg);
+    // faces already decoded (flipped) off the GL thread, in +X, -X, +Y, -Y, +Z, -Z order
+    Skybox(const std::vector<DecodedImage>& faceImages, unsigned int shaderProg);
     ~Skybox();
 
-    void load();
+    void load(const std::vector<DecodedImage>& faceImages);
     void draw(glm::mat4 view, glm::mat4 projection);
 
 private:
     unsigned int cubemapTexture;
     unsigned int skyboxVAO, skyboxVBO;
     unsigned int shaderProgram;  // Ensure this is declared
+    int viewLocation, projectionLocation; // looked up once in load()
     std::vector<std::string> faces;
 
-    unsigned int loadCubemap(const std::vector<std::string>& faces); // Updated to match implementation
+    unsigned int loadCubemap(const std::vector<DecodedImage>& faceImages);
 };
\ No newline at end of file
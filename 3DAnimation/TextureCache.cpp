@@ -0,0 +1,212 @@
+// TextureCache.cpp
+#include "TextureCache.h"
+#include "TextureCook.h"
+#include <glad/glad.h>
+#include <algorithm>
+#include <cctype>
+#include <iomanip>
+#include <vector>
+
+namespace
+{
+	// level 0 plus the mip chain CreateTexture2D generates (about a third on top)
+	uint64_t EstimateUncompressedBytes(const DecodedImage& image)
+	{
+		uint64_t level0 = (uint64_t)image.width * image.height * image.components * (image.isFloat ? sizeof(float) : 1);
+		return level0 + level0 / 3;
+	}
+
+	uint64_t EstimateGpuBytes(const DecodedImage& image)
+	{
+		return image.IsCompressed() ? image.blocks.size() : EstimateUncompressedBytes(image);
+	}
+}
+
+TextureCache& TextureCache::Get()
+{
+	static TextureCache cache;
+	return cache;
+}
+
+std::string TextureCache::CanonicalPath(const std::string& path)
+{
+	std::string normalized = path;
+	std::replace(normalized.begin(), normalized.end(), '\\', '/');
+#ifdef _WIN32
+	std::transform(normalized.begin(), normalized.end(), normalized.begin(),
+		[](unsigned char c) { return (char)std::tolower(c); });
+#endif
+
+	// "Object/Vegas/./textures/../skin.png" -> "Object/Vegas/skin.png"
+	std::vector<std::string> segments;
+	size_t start = 0;
+	while (start <= normalized.size())
+	{
+		size_t end = normalized.find('/', start);
+		if (end == std::string::npos)
+			end = normalized.size();
+		std::string segment = normalized.substr(start, end - start);
+		if (segment == "..")
+		{
+			if (!segments.empty() && segments.back() != "..")
+				segments.pop_back();
+			else
+				segments.push_back(segment);
+		}
+		else if (!segment.empty() && segment != ".")
+			segments.push_back(segment);
+		start = end + 1;
+	}
+
+	std::string canonical = !normalized.empty() && normalized[0] == '/' ? "/" : "";
+	for (size_t i = 0; i < segments.size(); i++)
+	{
+		if (i > 0)
+			canonical += '/';
+		canonical += segments[i];
+	}
+	return canonical;
+}
+
+bool TextureCache::Contains(const std::string& path, bool flipVertically) const
+{
+	std::string key = MakeKey(path, flipVertically);
+	std::lock_guard<std::mutex> lock(m_Mutex);
+	return m_ByPath.find(key) != m_ByPath.end();
+}
+
+int TextureCache::NewOwner()
+{
+	std::lock_guard<std::mutex> lock(m_Mutex);
+	return m_NextOwner++;
+}
+
+unsigned int TextureCache::AcquireByPath(const std::string& path, bool flipVertically, int owner)
+{
+	std::string key = MakeKey(path, flipVertically);
+	std::lock_guard<std::mutex> lock(m_Mutex);
+	auto byPath = m_ByPath.find(key);
+	if (byPath == m_ByPath.end())
+		return 0;
+	m_PathHits++;
+	return AddReference(m_Entries[byPath->second], owner);
+}
+
+unsigned int TextureCache::Acquire(const DecodedImage& image, int owner)
+{
+	std::string key = MakeKey(image.path, image.flipped);
+	std::lock_guard<std::mutex> lock(m_Mutex);
+
+	auto byPath = m_ByPath.find(key);
+	if (byPath != m_ByPath.end())
+	{
+		// decoded twice because two loaders raced for it; the upload is still shared
+		m_PathHits++;
+		return AddReference(m_Entries[byPath->second], owner);
+	}
+	if (!image.IsValid())
+		return CreateTexture2D(image); // logs the failure and returns 0
+	// a decode that lost the race above is only a path hit
+	m_Decodes++;
+
+	auto byContent = m_ByContent.find(image.contentHash);
+	if (byContent != m_ByContent.end())
+	{
+		// same pixels under another name: later lookups of this path skip decoding too
+		m_ContentHits++;
+		m_ByPath[key] = byContent->second;
+		return AddReference(m_Entries[byContent->second], owner);
+	}
+
+	Entry entry;
+	entry.id = CreateTexture2D(image);
+	entry.contentHash = image.contentHash;
+	entry.gpuBytes = EstimateGpuBytes(image);
+	entry.references = 1;
+	entry.owners.push_back(std::make_pair(owner, 1));
+	m_Entries[entry.id] = entry;
+	m_ByPath[key] = entry.id;
+	m_ByContent[entry.contentHash] = entry.id;
+	m_Uploads++;
+	m_ResidentBytes += entry.gpuBytes;
+	if (image.IsCompressed())
+	{
+		m_CompressedUploads++;
+		m_CompressionSavedBytes += EstimateUncompressedBytes(image) - entry.gpuBytes;
+	}
+	return entry.id;
+}
+
+unsigned int TextureCache::Load(const std::string& path, bool flipVertically, int owner)
+{
+	if (unsigned int id = AcquireByPath(path, flipVertically, owner))
+		return id;
+	return Acquire(DecodeTexture(path, flipVertically), owner);
+}
+
+void TextureCache::Release(unsigned int textureId, int owner)
+{
+	std::lock_guard<std::mutex> lock(m_Mutex);
+	auto found = m_Entries.find(textureId);
+	if (found == m_Entries.end())
+		return;
+	Entry& entry = found->second;
+	auto held = std::find_if(entry.owners.begin(), entry.owners.end(),
+		[owner](const std::pair<int, int>& holder) { return holder.first == owner; });
+	if (held == entry.owners.end())
+		return;
+	if (--held->second == 0)
+	{
+		// one sharer fewer: if others still hold it, that copy no longer counts as saved
+		entry.owners.erase(held);
+		if (!entry.owners.empty())
+			m_SavedBytes -= entry.gpuBytes;
+	}
+	if (--entry.references > 0)
+		return;
+
+	for (auto byPath = m_ByPath.begin(); byPath != m_ByPath.end();)
+	{
+		if (byPath->second == textureId)
+			byPath = m_ByPath.erase(byPath);
+		else
+			++byPath;
+	}
+	m_ByContent.erase(found->second.contentHash);
+	m_ResidentBytes -= found->second.gpuBytes;
+	glDeleteTextures(1, &textureId);
+	m_Entries.erase(found);
+}
+
+void TextureCache::Report(std::ostream& out) const
+{
+	std::lock_guard<std::mutex> lock(m_Mutex);
+	out << "Textures: " << m_Decodes << " decoded, " << m_Uploads << " uploaded (" << m_CompressedUploads << " cooked), "
+		<< m_PathHits << " shared by path, " << m_ContentHits << " shared by content; "
+		<< std::fixed << std::setprecision(1) << m_ResidentBytes / (1024.0 * 1024.0) << " MB resident, "
+		<< m_SavedBytes / (1024.0 * 1024.0) << " MB saved by sharing, "
+		<< m_CompressionSavedBytes / (1024.0 * 1024.0) << " MB saved by compression" << std::endl;
+}
+
+std::string TextureCache::MakeKey(const std::string& path, bool flipVertically)
+{
+	return flipVertically ? CanonicalPath(path) + "|flipped" : CanonicalPath(path);
+}
+
+unsigned int TextureCache::AddReference(Entry& entry, int owner)
+{
+	entry.references++;
+	for (std::pair<int, int>& holder : entry.owners)
+	{
+		if (holder.first == owner)
+		{
+			// the same load reusing its own texture saves nothing over one load on its own
+			holder.second++;
+			return entry.id;
+		}
+	}
+	entry.owners.push_back(std::make_pair(owner, 1));
+	if (entry.owners.size() > 1)
+		m_SavedBytes += entry.gpuBytes;
+	return entry.id;
+}
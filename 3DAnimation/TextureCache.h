@@ -0,0 +1,82 @@
+#pragma once
+
+/* Process-wide cache of 2D textures shared by every model and the HUD.
+   Textures are keyed by canonical path and by a hash of their decoded pixels, so a
+   texture is uploaded once even if two models reach it through different paths or file
+   copies. Every Acquire adds a reference, and the GL texture is deleted when the last
+   reference is released. References are made on behalf of an owner, one per model load (or
+   the HUD): a load reusing its own texture across meshes is not sharing, so only owners
+   beyond a texture's first count towards the bytes sharing saves. */
+
+#include <cstdint>
+#include <mutex>
+#include <ostream>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+#include "ImageData.h"
+
+class TextureCache
+{
+public:
+	static TextureCache& Get();
+
+	// forward slashes with "." and ".." segments resolved, lower-cased where the file system ignores case
+	static std::string CanonicalPath(const std::string& path);
+
+	// any thread: true if path is already resident with this orientation, so a loader can skip decoding it
+	bool Contains(const std::string& path, bool flipVertically) const;
+
+	// a token no one else holds, for one load's references
+	int NewOwner();
+
+	// GL thread: adds a reference for owner to the texture resident for path; 0 if there is none
+	unsigned int AcquireByPath(const std::string& path, bool flipVertically, int owner);
+
+	// GL thread: adds a reference for owner to the texture resident for image.path or for
+	// identical pixels, uploading the image only if neither exists. 0 if the image failed to decode.
+	unsigned int Acquire(const DecodedImage& image, int owner);
+
+	// GL thread: AcquireByPath, falling back to DecodeTexture on this thread
+	unsigned int Load(const std::string& path, bool flipVertically, int owner);
+
+	// GL thread: drops one of owner's references; the texture is deleted with the last one
+	void Release(unsigned int textureId, int owner);
+
+	// decode and upload totals since startup, and what sharing saves right now
+	void Report(std::ostream& out) const;
+
+private:
+	TextureCache() = default;
+
+	struct Entry
+	{
+		unsigned int id;
+		uint64_t contentHash;
+		uint64_t gpuBytes;
+		int references;
+		std::vector<std::pair<int, int>> owners;   // owner token, references it holds
+	};
+
+	// canonical path, plus a marker for flipped copies so both orientations can be resident
+	static std::string MakeKey(const std::string& path, bool flipVertically);
+
+	// the caller holds m_Mutex
+	unsigned int AddReference(Entry& entry, int owner);
+
+	mutable std::mutex m_Mutex;
+	std::unordered_map<unsigned int, Entry> m_Entries;         // by GL id
+	std::unordered_map<std::string, unsigned int> m_ByPath;    // MakeKey -> GL id
+	std::unordered_map<uint64_t, unsigned int> m_ByContent;    // pixel hash -> GL id
+
+	long long m_Decodes = 0;                // images that missed the path lookup
+	long long m_Uploads = 0;
+	long long m_PathHits = 0;
+	long long m_ContentHits = 0;
+	uint64_t m_ResidentBytes = 0;
+	uint64_t m_SavedBytes = 0;              // gpuBytes per owner beyond the first, currently held
+	int m_NextOwner = 1;
+	long long m_CompressedUploads = 0;
+	uint64_t m_CompressionSavedBytes = 0; // uncompressed size minus cooked size, per upload
+};
@@ -0,0 +1,293 @@
+// TextureCook.cpp
+#include "TextureCook.h"
+#include "AssetCache.h"
+#include "Profiler.h"
+#include <glad/glad.h>
+#include <algorithm>
+#include <atomic>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <vector>
+
+extern "C"
+{
+#include <image_DXT.h>
+}
+#include <image_helper.h>
+
+// EXT_texture_compression_s3tc; the bundled glad was generated without the extension
+#ifndef GL_COMPRESSED_RGB_S3TC_DXT1_EXT
+#define GL_COMPRESSED_RGB_S3TC_DXT1_EXT 0x83F0
+#define GL_COMPRESSED_RGBA_S3TC_DXT5_EXT 0x83F3
+#endif
+
+namespace
+{
+	const uint32_t DDSMagic = 0x20534444;    // "DDS "
+	const uint32_t FourCCDXT1 = 0x31545844;  // "DXT1"
+	const uint32_t FourCCDXT5 = 0x35545844;  // "DXT5"
+	const uint32_t FourCCATI1 = 0x31495441;  // "ATI1", BC4 / RGTC1
+	const uint32_t CookTag = 0x58545757;     // "WWTX", marks a DDS written by CookTexture
+	const uint32_t CookVersion = 2;          // 2: single-channel images are BC4, no longer DXT1
+
+	// dwReserved1 slots holding the source stamp, so stale files are ignored like asset caches
+	enum CookStampSlot { SlotTag, SlotVersion, SlotSizeLow, SlotSizeHigh, SlotTimeLow, SlotTimeHigh, SlotFlipped };
+
+	std::atomic<bool> s_CompressedSupported(false);
+
+	// One 4x4 BC4 block of a single-channel image: the block's highest and lowest values as
+	// endpoints, then a 3-bit index per pixel into the 8-step ramp between them. Blocks over
+	// the right or bottom edge repeat the last column or row.
+	void EncodeBC4Block(const unsigned char* pixels, int width, int height, int blockX, int blockY, unsigned char* out)
+	{
+		unsigned char values[16];
+		unsigned char high = 0, low = 255;
+		for (int y = 0; y < 4; y++)
+		{
+			for (int x = 0; x < 4; x++)
+			{
+				int column = std::min(blockX * 4 + x, width - 1);
+				int row = std::min(blockY * 4 + y, height - 1);
+				unsigned char value = pixels[row * width + column];
+				values[y * 4 + x] = value;
+				high = std::max(high, value);
+				low = std::min(low, value);
+			}
+		}
+
+		// with red0 > red1, index 0 is red0, 1 is red1 and 2..7 step evenly from red0 to red1
+		uint64_t indices = 0;
+		if (high > low)
+		{
+			for (int i = 0; i < 16; i++)
+			{
+				int step = (int)((high - values[i]) * 7.0f / (high - low) + 0.5f);
+				uint64_t index = step == 0 ? 0 : step == 7 ? 1 : step + 1;
+				indices |= index << (3 * i);
+			}
+		}
+		out[0] = high;
+		out[1] = low;
+		for (int i = 0; i < 6; i++)
+			out[2 + i] = (unsigned char)(indices >> (8 * i));
+	}
+
+	std::vector<unsigned char> EncodeBC4(const unsigned char* pixels, int width, int height)
+	{
+		int blocksX = (width + 3) / 4, blocksY = (height + 3) / 4;
+		std::vector<unsigned char> blocks((size_t)blocksX * blocksY * 8);
+		for (int blockY = 0; blockY < blocksY; blockY++)
+		{
+			for (int blockX = 0; blockX < blocksX; blockX++)
+				EncodeBC4Block(pixels, width, height, blockX, blockY, &blocks[((size_t)blockY * blocksX + blockX) * 8]);
+		}
+		return blocks;
+	}
+
+	bool ReadCookedTexture(const std::string& path, bool flipVertically, DecodedImage& image)
+	{
+		uint64_t sourceSize = 0;
+		int64_t sourceModified = 0;
+		if (!AssetCache::GetSourceStamp(path, sourceSize, sourceModified))
+			return false;
+
+		std::ifstream file(CookedTexturePath(path, flipVertically), std::ios::binary | std::ios::ate);
+		if (!file)
+			return false;
+		size_t fileSize = (size_t)file.tellg();
+		DDS_header header;
+		file.seekg(0);
+		if (fileSize < sizeof(header) || !file.read(reinterpret_cast<char*>(&header), sizeof(header)))
+			return false;
+
+		const unsigned int* stamp = header.dwReserved1;
+		bool current = header.dwMagic == DDSMagic && stamp[SlotTag] == CookTag && stamp[SlotVersion] == CookVersion
+			&& stamp[SlotSizeLow] == (uint32_t)sourceSize && stamp[SlotSizeHigh] == (uint32_t)(sourceSize >> 32)
+			&& stamp[SlotTimeLow] == (uint32_t)sourceModified && stamp[SlotTimeHigh] == (uint32_t)((uint64_t)sourceModified >> 32)
+			&& stamp[SlotFlipped] == (flipVertically ? 1u : 0u);
+		if (!current)
+		{
+			std::cout << "Cooked texture for " << path << " is stale, decoding the source" << std::endl;
+			return false;
+		}
+
+		image.path = path;
+		image.width = (int)header.dwWidth;
+		image.height = (int)header.dwHeight;
+		image.flipped = flipVertically;
+		uint32_t blockBytes = 8;
+		switch (header.sPixelFormat.dwFourCC)
+		{
+		case FourCCDXT1:
+			image.components = 3;
+			image.compressedFormat = GL_COMPRESSED_RGB_S3TC_DXT1_EXT;
+			break;
+		case FourCCDXT5:
+			image.components = 4;
+			image.compressedFormat = GL_COMPRESSED_RGBA_S3TC_DXT5_EXT;
+			blockBytes = 16;
+			break;
+		case FourCCATI1:
+			image.components = 1;
+			image.compressedFormat = GL_COMPRESSED_RED_RGTC1;
+			break;
+		default:
+			return false;
+		}
+
+		// level sizes follow from the dimensions: 8 (DXT1, BC4) or 16 (DXT5) bytes per 4x4 block
+		size_t total = 0;
+		int width = image.width, height = image.height;
+		for (unsigned int level = 0; level < header.dwMipMapCount; level++)
+		{
+			uint32_t size = (uint32_t)((width + 3) / 4) * (uint32_t)((height + 3) / 4) * blockBytes;
+			image.levelSizes.push_back(size);
+			total += size;
+			width = width > 1 ? width / 2 : 1;
+			height = height > 1 ? height / 2 : 1;
+		}
+		if (image.levelSizes.empty() || total != fileSize - sizeof(header))
+			return false;
+
+		image.blocks.resize(total);
+		if (!file.read(reinterpret_cast<char*>(image.blocks.data()), total))
+			return false;
+		image.contentHash = HashImageContents(image);
+		return true;
+	}
+}
+
+std::string CookedTexturePath(const std::string& sourcePath, bool flipVertically)
+{
+	return sourcePath + (flipVertically ? ".flipped.dds" : ".dds");
+}
+
+bool DetectCompressedTextureSupport()
+{
+	GLint extensionCount = 0;
+	glGetIntegerv(GL_NUM_EXTENSIONS, &extensionCount);
+	for (GLint i = 0; i < extensionCount; i++)
+	{
+		const char* name = reinterpret_cast<const char*>(glGetStringi(GL_EXTENSIONS, i));
+		if (name && std::strcmp(name, "GL_EXT_texture_compression_s3tc") == 0)
+		{
+			s_CompressedSupported = true;
+			return true;
+		}
+	}
+	std::cout << "S3TC texture compression unavailable, cooked textures are ignored" << std::endl;
+	return false;
+}
+
+DecodedImage DecodeTexture(const std::string& path, bool flipVertically)
+{
+	static ProfileSection s_CookedRead("Texture read (cooked DDS)", "texture");
+	static ProfileSection s_SourceDecode("Texture decode (stb)", "texture");
+
+	if (s_CompressedSupported && !AssetCache::IsCooking())
+	{
+		ProfileScope profile(s_CookedRead);
+		DecodedImage cooked;
+		if (ReadCookedTexture(path, flipVertically, cooked))
+			return cooked;
+	}
+
+	DecodedImage image;
+	{
+		ProfileScope profile(s_SourceDecode);
+		image = DecodeImage(path, flipVertically);
+	}
+	if (AssetCache::IsCooking() && image.IsValid())
+		CookTexture(image);
+	return image;
+}
+
+bool CookTexture(const DecodedImage& image)
+{
+	if (!image.IsValid() || image.IsCompressed() || image.isFloat)
+		return false;
+
+	uint64_t sourceSize = 0;
+	int64_t sourceModified = 0;
+	if (!AssetCache::GetSourceStamp(image.path, sourceSize, sourceModified))
+		return false;
+
+	// BC4 for single-channel images, so they stay red-only as the plain GL_RED upload has them;
+	// otherwise DXT1 for opaque images, DXT5 whenever there is an alpha channel (2 or 4 components)
+	bool singleChannel = image.components == 1;
+	bool hasAlpha = image.components % 2 == 0;
+	uint32_t fourCC = singleChannel ? FourCCATI1 : hasAlpha ? FourCCDXT5 : FourCCDXT1;
+	std::vector<unsigned char> level(static_cast<const unsigned char*>(image.pixels),
+		static_cast<const unsigned char*>(image.pixels) + (size_t)image.width * image.height * image.components);
+	std::vector<unsigned char> blocks;
+	unsigned int levelCount = 0;
+	int width = image.width, height = image.height;
+	for (;;)
+	{
+		if (singleChannel)
+		{
+			std::vector<unsigned char> compressed = EncodeBC4(level.data(), width, height);
+			blocks.insert(blocks.end(), compressed.begin(), compressed.end());
+		}
+		else
+		{
+			int compressedSize = 0;
+			unsigned char* compressed = hasAlpha
+				? convert_image_to_DXT5(level.data(), width, height, image.components, &compressedSize)
+				: convert_image_to_DXT1(level.data(), width, height, image.components, &compressedSize);
+			if (!compressed)
+				return false;
+			blocks.insert(blocks.end(), compressed, compressed + compressedSize);
+			std::free(compressed);
+		}
+		levelCount++;
+		if (width == 1 && height == 1)
+			break;
+
+		// box-filtered like glGenerateMipmap; odd edges average the pixels that exist
+		int blockX = width > 1 ? 2 : 1;
+		int blockY = height > 1 ? 2 : 1;
+		std::vector<unsigned char> next((size_t)(width / blockX) * (height / blockY) * image.components);
+		mipmap_image(level.data(), width, height, image.components, next.data(), blockX, blockY);
+		level.swap(next);
+		width /= blockX;
+		height /= blockY;
+	}
+
+	DDS_header header;
+	std::memset(&header, 0, sizeof(header));
+	header.dwMagic = DDSMagic;
+	header.dwSize = 124;
+	header.dwFlags = DDSD_CAPS | DDSD_HEIGHT | DDSD_WIDTH | DDSD_PIXELFORMAT | DDSD_LINEARSIZE | DDSD_MIPMAPCOUNT;
+	header.dwWidth = image.width;
+	header.dwHeight = image.height;
+	header.dwPitchOrLinearSize = ((image.width + 3) / 4) * ((image.height + 3) / 4) * (hasAlpha ? 16 : 8);
+	header.dwMipMapCount = levelCount;
+	header.sPixelFormat.dwSize = 32;
+	header.sPixelFormat.dwFlags = DDPF_FOURCC;
+	header.sPixelFormat.dwFourCC = fourCC;
+	header.sCaps.dwCaps1 = DDSCAPS_TEXTURE | DDSCAPS_COMPLEX | DDSCAPS_MIPMAP;
+	// rows are stored in the orientation the loader asked for, not DDS's usual top-down order
+	header.dwReserved1[SlotTag] = CookTag;
+	header.dwReserved1[SlotVersion] = CookVersion;
+	header.dwReserved1[SlotSizeLow] = (uint32_t)sourceSize;
+	header.dwReserved1[SlotSizeHigh] = (uint32_t)(sourceSize >> 32);
+	header.dwReserved1[SlotTimeLow] = (uint32_t)sourceModified;
+	header.dwReserved1[SlotTimeHigh] = (uint32_t)((uint64_t)sourceModified >> 32);
+	header.dwReserved1[SlotFlipped] = image.flipped ? 1 : 0;
+
+	std::string cookedPath = CookedTexturePath(image.path, image.flipped);
+	std::ofstream file(cookedPath, std::ios::binary | std::ios::trunc);
+	file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+	file.write(reinterpret_cast<const char*>(blocks.data()), blocks.size());
+	if (!file)
+	{
+		std::cout << "ERROR::TEXTURE_COOK::WRITE_FAILED " << cookedPath << std::endl;
+		return false;
+	}
+	AssetCache::Written().Increment();
+	std::cout << "Cooked " << cookedPath << " (" << levelCount << " levels, " << sizeof(header) + blocks.size() << " bytes)" << std::endl;
+	return true;
+}
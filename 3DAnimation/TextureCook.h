@@ -0,0 +1,27 @@
+#pragma once
+
+/* Offline texture cooking. "--cook" compresses every model and HUD texture it decodes to
+   DXT1 (no alpha), DXT5 (alpha) or BC4 (single channel), builds the full mip chain, and
+   writes the result as a DDS file next to the source. At runtime DecodeTexture reads that
+   file instead of decoding the PNG/JPG, and CreateTexture2D uploads the stored levels with
+   glCompressedTexImage2D, so no stb decode or glGenerateMipmap is needed. The DDS header's
+   reserved words record the source's size and modification time. A stale or missing file,
+   or a driver without S3TC, falls back to the stb path. */
+
+#include <string>
+#include "ImageData.h"
+
+// <source>.dds, or <source>.flipped.dds for textures decoded upside down
+std::string CookedTexturePath(const std::string& sourcePath, bool flipVertically);
+
+// GL thread, once after the context exists: checks the driver for S3TC. Until this is
+// called (or if it fails) DecodeTexture never hands out compressed images.
+bool DetectCompressedTextureSupport();
+
+// worker-safe: the cooked DDS if it is current, else stb_image. While cooking, decodes the
+// source and writes a fresh DDS before returning the plain pixels.
+DecodedImage DecodeTexture(const std::string& path, bool flipVertically);
+
+// worker-safe: compresses image (plain 8-bit pixels) with a full mip chain and writes it to
+// CookedTexturePath(image.path, image.flipped)
+bool CookTexture(const DecodedImage& image);
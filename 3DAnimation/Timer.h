@@ -1,14 +1,15 @@
 #ifndef COUNTDOWN_TIMER_H
 #define COUNTDOWN_TIMER_H
 
-#include <GLFW/glfw3.h>
 #include <string>
 #include <iostream>
 
+// Counts down in simulation time: update() receives the tick's dt, so the clock runs at the
+// same rate as the gameplay it times and stops whenever the simulation does.
 class CountdownTimer {
 public:
     CountdownTimer(float initialTime = 60.0f, float delay = 0.0f)
-        : running(false), startTime(0.0f), remainingTime(initialTime),
+        : running(false), elapsed(0.0f), remainingTime(initialTime),
         defaultTime(initialTime), delay(delay), delayElapsed(0.0f) {}
 
 
@@ -18,7 +19,7 @@ public:
                 delay = newDelay;
             }
             running = true;
-            startTime = static_cast<float>(glfwGetTime());
+            elapsed = 0.0f;
             delayElapsed = 0.0f; // Reset delay tracker
         }
     }
@@ -26,7 +27,6 @@ public:
     void stop() {
         if (running) {
             running = false;
-            float elapsed = static_cast<float>(glfwGetTime()) - startTime;
             if (elapsed > delay) {
                 remainingTime -= (elapsed - delay);
             }
@@ -50,10 +50,9 @@ public:
     }
 
 
-    void update() {
+    void update(float dt) {
         if (running) {
-            float currentTime = static_cast<float>(glfwGetTime());
-            float elapsed = currentTime - startTime;
+            elapsed += dt;
 
             // Handle delay
             if (delayElapsed < delay) {
@@ -95,7 +94,7 @@ public:
 
 private:
     bool running;
-    float startTime;      // When the timer started
+    float elapsed;        // Simulated time since start()
     float remainingTime;  // Remaining time in seconds
     float defaultTime;    // Default countdown duration
 
@@ -1,25 +1,31 @@
 #pragma once
 
+#include <algorithm>
 #include <vector>
 #include <map>
 #include <glm/glm.hpp>
 #include <assimp/scene.h>
 #include "bone.h"
 #include <functional>
+#include <cmath>
 #include "animdata.h"
 #include "model_animation.h"
+#include "Profiler.h"
+#include "pose.h"
+#include "AssetCache.h"
+#include "ClipCompression.h"
 
-struct AssimpNodeData
-{
-	glm::mat4 transformation;
-	std::string name;
-	int childrenCount;
-	std::vector<AssimpNodeData> children;
+// What a clip asks for at one point on its timeline. The animator playing the clip reports it
+// to its listeners, which decide what it means: a Strike lands damage, a Sound plays a cue.
+enum class AnimationEventType {
+	Strike,
+	Sound
 };
 
-struct DamageKeyframe {
-	float time;
-	int damage;
+struct AnimationEvent {
+	float time;               // seconds into the clip, on the timeline its pose is sampled from
+	AnimationEventType type;
+	int value;                // Strike: damage points; Sound: cue id
 };
 
 
@@ -28,63 +34,210 @@ class Animation
 public:
 	Animation() = default;
 
+	// bones point into m_KeyData, so a clip can be moved (the buffer moves with it) but not copied
+	Animation(const Animation&) = delete;
+	Animation& operator=(const Animation&) = delete;
+	Animation(Animation&&) = default;
+	Animation& operator=(Animation&&) = default;
+
 	Animation(const std::string& animationPath, ModelAnim* model,float speed = 1.0f)
 	{
 		Assimp::Importer importer;
-		const aiScene* scene = importer.ReadFile(animationPath, aiProcess_Triangulate);
+		const aiScene* scene = importer.ReadFile(animationPath, ImportFlags);
 		assert(scene && scene->mRootNode);
-		auto animation = scene->mAnimations[0];
-		m_Duration = animation->mDuration;
-		m_DurationInSecond = m_Duration / m_TicksPerSecond;
-		m_Speed = 1.0f;
-		m_TicksPerSecond = animation->mTicksPerSecond;
-		aiMatrix4x4 globalTransformation = scene->mRootNode->mTransformation;
-		globalTransformation = globalTransformation.Inverse();
-		ReadHierarchyData(m_RootNode, scene->mRootNode);
-		ReadMissingBones(animation, *model);
+		loadAnimation(scene, animationPath, model, 1.0f);
+	}
+
+	// Clip files are full exports with the skinned mesh in them, but a clip only reads the
+	// animation channels (the hierarchy comes from the model's Skeleton), so no
+	// post-processing is asked for - triangulating a mesh nobody draws is pure overhead.
+	static const unsigned int ImportFlags = 0;
+
+	// inserted in time order, so crossed events can be found by binary search and come out sorted
+	void AddEvent(const AnimationEvent& event) {
+		auto at = std::upper_bound(m_Events.begin(), m_Events.end(), event.time,
+			[](float time, const AnimationEvent& other) { return time < other.time; });
+		m_Events.insert(at, event);
 	}
 
 	void AddDamageKeyframe(float timeInSeconds, int damage) {
-		damageKeyframes.push_back({ timeInSeconds, damage });
+		AddEvent({ timeInSeconds, AnimationEventType::Strike, damage });
 		cout << "Added damage keyframe at time " << timeInSeconds << " sec" << endl;
 	}
 
-	int getDamageForTime(float currentTimeInSeconds) {
-		float tolerance = 0.05f; // This may need adjustment based on your specific timing precision
-		for (const auto& frame : damageKeyframes) {
-			if (std::abs(currentTimeInSeconds - frame.time) <= tolerance) {
-				return frame.damage;
-			}
+	// Calls visit(event) for every event a clock crossed moving from `from` to `to` (in ticks):
+	// (from, to], or (from, end of clip] followed by [start, to] when it wrapped. includeFrom
+	// also reports an event sitting exactly on `from`, for a clip that has just started there.
+	template <typename Visitor>
+	void ForEachEventCrossed(float from, float to, bool wrapped, bool includeFrom, Visitor&& visit) const
+	{
+		if (m_Events.empty())
+			return;
+		float fromSeconds = from / m_TicksPerSecond;
+		float toSeconds = to / m_TicksPerSecond;
+		auto event = std::lower_bound(m_Events.begin(), m_Events.end(), fromSeconds,
+			[](const AnimationEvent& other, float time) { return other.time < time; });
+		if (!includeFrom)
+			while (event != m_Events.end() && event->time <= fromSeconds)
+				++event;
+
+		if (wrapped) {
+			for (; event != m_Events.end(); ++event)
+				visit(*event);
+			event = m_Events.begin();
 		}
-		return 0;
+		for (; event != m_Events.end() && event->time <= toSeconds; ++event)
+			visit(*event);
 	}
 
+	inline const std::vector<AnimationEvent>& GetEvents() const { return m_Events; }
 
 	void loadAnimation(const std::string& animationPath, ModelAnim* model,float speed = 1.0f)
 	{
+		if (LoadCache(animationPath, model, speed))
+			return;
+
 		Assimp::Importer importer;
-		const aiScene* scene = importer.ReadFile(animationPath, aiProcess_Triangulate);
+		const aiScene* scene = importer.ReadFile(animationPath, ImportFlags);
 		assert(scene && scene->mRootNode);
+		loadAnimation(scene, animationPath, model, speed);
+	}
+
+	// binds the first animation of an already imported scene; see ClipLoader for batches
+	void loadAnimation(const aiScene* scene, const std::string& animationPath, ModelAnim* model, float speed = 1.0f)
+	{
 		auto animation = scene->mAnimations[0];  // Assuming first animation is what we need
 
+		m_Path = animationPath;
 		m_Duration = animation->mDuration;
 		m_Speed = speed;
 		m_TicksPerSecond = animation->mTicksPerSecond != 0 ? animation->mTicksPerSecond : 25.0f;  // Default to 25 if not specified
+		m_DurationInSecond = m_Duration / m_TicksPerSecond;
 
-		std::cout << "Loaded Animation: " << animationPath << " with duration: " << m_Duration << " and ticks per second: " << m_TicksPerSecond << std::endl;
-
-		aiMatrix4x4 globalTransformation = scene->mRootNode->mTransformation;
-		globalTransformation = globalTransformation.Inverse();
-		ReadHierarchyData(m_RootNode, scene->mRootNode);
 		ReadMissingBones(animation, *model);
+		BindSkeleton(*model);
+		if (AssetCache::IsCooking())
+			SaveCache(animationPath);
+
+		std::cout << "Loaded Animation: " << animationPath << " with duration: " << m_Duration << " and ticks per second: " << m_TicksPerSecond
+			<< " (" << m_Bones.size() << " tracks over " << m_Skeleton->GetNodeCount() << " shared nodes, " << GetKeyDataBytes() << " bytes of keys)" << std::endl;
+	}
+
+	// binds the clip from its compiled cache if there is a current one; false means import the source
+	bool LoadCache(const std::string& animationPath, ModelAnim* model, float speed = 1.0f)
+	{
+		CacheReader reader;
+		if (!reader.Open(animationPath, AssetCache::AnimationClip))
+			return false;
+
+		float duration = reader.Read<float>();
+		float ticksPerSecond = reader.Read<float>();
+		uint32_t numChannels = reader.Read<uint32_t>();
+		uint32_t numTimes = reader.Read<uint32_t>();
+		uint32_t numValues = reader.Read<uint32_t>();
+		struct CachedChannel { std::string name; int numPositions, numRotations, numScalings; };
+		std::vector<CachedChannel> channels;
+		for (uint32_t i = 0; i < numChannels && reader.IsValid(); i++)
+		{
+			CachedChannel channel;
+			channel.name = reader.ReadString();
+			channel.numPositions = reader.Read<int32_t>();
+			channel.numRotations = reader.Read<int32_t>();
+			channel.numScalings = reader.Read<int32_t>();
+			channels.push_back(channel);
+		}
+		const float* keys = reader.ReadArray<float>(numTimes + numValues);
+		// compressed keys from a cooking run, for Compress to take if it asks for the same tolerance
+		CompressedClip cachedCompressed;
+		CompressionTolerance cachedTolerance;
+		PoseError cachedError;
+		bool compressedValid = true;
+		if (reader.Read<uint32_t>() != 0)
+		{
+			cachedTolerance = reader.Read<CompressionTolerance>();
+			cachedError = reader.Read<PoseError>();
+			compressedValid = cachedCompressed.Read(reader);
+		}
+		if (!reader.IsValid() || !compressedValid)
+		{
+			std::cout << "ERROR::ASSET_CACHE:: corrupt cache for " << animationPath << std::endl;
+			return false;
+		}
+
+		m_Path = animationPath;
+		m_Duration = duration;
+		m_Speed = speed;
+		m_TicksPerSecond = ticksPerSecond;
+		m_DurationInSecond = m_Duration / m_TicksPerSecond;
+
+		// the key buffer is already in its runtime layout: one bulk copy, then bones point into it
+		m_KeyData.assign(keys, keys + numTimes + numValues);
+		const float* times = m_KeyData.data();
+		const float* values = m_KeyData.data() + numTimes;
+		m_Bones.clear();
+		m_Bones.reserve(channels.size());
+		for (const CachedChannel& channel : channels)
+		{
+			int boneId = model->RegisterBone(channel.name);
+			m_Bones.push_back(Bone(channel.name, boneId, channel.numPositions, channel.numRotations, channel.numScalings, times, values));
+		}
+		BindSkeleton(*model);
+		m_CachedCompressed = std::move(cachedCompressed);
+		m_CompressionTolerance = cachedTolerance;
+		m_CompressionError = cachedError;
+
+		std::cout << "Loaded Animation: " << animationPath << " from cache (" << m_Bones.size() << " tracks, " << GetKeyDataBytes() << " bytes of keys)" << std::endl;
+		return true;
+	}
+
+	// cache layout: timing, per-channel name and key counts, the packed key buffer verbatim, then
+	// the compressed keys (with the tolerance they were reduced for and their error) once
+	// Compress has built them
+	void SaveCache(const std::string& animationPath) const
+	{
+		size_t numTimes = 0;
+		for (const Bone& bone : m_Bones)
+			numTimes += bone.GetNumPositionKeys() + bone.GetNumRotationKeys() + bone.GetNumScalingKeys();
+
+		CacheWriter writer;
+		writer.Write(m_Duration);
+		writer.Write((float)m_TicksPerSecond);
+		writer.Write((uint32_t)m_Bones.size());
+		writer.Write((uint32_t)numTimes);
+		writer.Write((uint32_t)(m_KeyData.size() - numTimes));
+		for (const Bone& bone : m_Bones)
+		{
+			writer.WriteString(bone.GetBoneName());
+			writer.Write((int32_t)bone.GetNumPositionKeys());
+			writer.Write((int32_t)bone.GetNumRotationKeys());
+			writer.Write((int32_t)bone.GetNumScalingKeys());
+		}
+		writer.WriteArray(m_KeyData.data(), m_KeyData.size());
+		writer.Write((uint32_t)(IsCompressed() ? 1 : 0));
+		if (IsCompressed())
+		{
+			writer.Write(m_CompressionTolerance);
+			writer.Write(m_CompressionError);
+			m_Compressed.Write(writer);
+		}
+		writer.Save(animationPath, AssetCache::AnimationClip);
 	}
 
 	~Animation()
 	{
 	}
 
+	// name lookups only happen while binding at load time; the counter catches any that sneak
+	// into per-frame code
+	static ProfileCounter& NameLookups()
+	{
+		static ProfileCounter counter("Bone name lookups");
+		return counter;
+	}
+
 	Bone* FindBone(const std::string& name)
 	{
+		NameLookups().Increment();
 		auto iter = std::find_if(m_Bones.begin(), m_Bones.end(),
 			[&](const Bone& Bone)
 			{
@@ -102,64 +255,272 @@ public:
 
 
 	
+	inline Bone* GetBone(int boneIndex)
+	{
+		return boneIndex < 0 ? nullptr : &m_Bones[boneIndex];
+	}
+
+	inline int GetChannelCount() const { return (int)m_Bones.size(); }
+
+	// channel driving a skeleton node, null if the clip leaves it at its bind transform
+	inline Bone* GetBoneForNode(int nodeIndex)
+	{
+		return GetBone(m_NodeChannels[nodeIndex]);
+	}
+
+	// channel index driving a skeleton node, -1 if the clip leaves it at its bind transform
+	inline int GetChannelForNode(int nodeIndex) const
+	{
+		return m_NodeChannels[nodeIndex];
+	}
+
+	// name lookup for clips bound to another skeleton, resolved once per clip pair by the
+	// animator; -1 if the clip has no such track
+	int FindChannel(const std::string& name)
+	{
+		Bone* bone = FindBone(name);
+		return bone ? (int)(bone - m_Bones.data()) : -1;
+	}
+
+	// local pose of one channel at animationTime (in ticks), from the baked table if there is
+	// one, else from the compressed or raw keys. cursors, one per channel, carries the raw key
+	// lookup over from the caller's last sample; without it every lookup is a binary search.
+	void SampleChannel(int channel, float animationTime, BonePose& out, KeyCursors* cursors = nullptr)
+	{
+		if (m_BakedFrameCount == 0)
+		{
+			SampleKeys(channel, animationTime, out, cursors);
+			return;
+		}
+
+		float frame = glm::clamp(animationTime / m_BakedFrameTicks, 0.0f, (float)(m_BakedFrameCount - 1));
+		int frame0 = glm::min((int)frame, m_BakedFrameCount - 2);
+		float weight = frame - frame0;
+		const BonePose& a = m_BakedPoses[frame0 * m_Bones.size() + channel];
+		const BonePose& b = m_BakedPoses[(frame0 + 1) * m_Bones.size() + channel];
+		out.translation = glm::mix(a.translation, b.translation, weight);
+		// adjacent rows are close together, so a normalized lerp is as good as a slerp here
+		float side = glm::dot(a.rotation, b.rotation) < 0.0f ? -1.0f : 1.0f;
+		out.rotation = glm::normalize(a.rotation * (1.0f - weight) + b.rotation * (weight * side));
+		out.scale = glm::mix(a.scale, b.scale, weight);
+	}
+
+	// Resamples every channel at a fixed rate into one pose table (row per frame), after which
+	// sampling is a single interpolation between two adjacent rows instead of a key search
+	// per track. The rate trades memory (frames x tracks x sizeof(BonePose)) for accuracy.
+	// Call before Compress: the rows are then probed against the raw keys between frames, and a
+	// table that strays further than tolerance is dropped again, so the clip keeps sampling its
+	// keys. Returns whether the table was kept.
+	bool Bake(float sampleRate, const PoseTolerance& tolerance)
+	{
+		size_t numChannels = m_Bones.size();
+		float durationInSeconds = m_Duration / m_TicksPerSecond;
+		m_BakedFrameCount = glm::max(2, (int)std::ceil(durationInSeconds * sampleRate) + 1);
+		m_BakedFrameTicks = m_Duration / (m_BakedFrameCount - 1);
+		m_BakedPoses.resize(m_BakedFrameCount * numChannels);
+
+		for (int frame = 0; frame < m_BakedFrameCount; frame++)
+		{
+			float time = frame * m_BakedFrameTicks;
+			for (size_t channel = 0; channel < numChannels; channel++)
+				SampleKeys((int)channel, time, m_BakedPoses[frame * numChannels + channel]);
+		}
+
+		// probe inside every interval, where interpolating the rows strays furthest from the keys
+		PoseError error;
+		const int probesPerFrame = 4;
+		for (int probe = 1; probe < (m_BakedFrameCount - 1) * probesPerFrame; probe++)
+		{
+			float time = probe * m_BakedFrameTicks / probesPerFrame;
+			for (size_t channel = 0; channel < numChannels; channel++)
+			{
+				BonePose baked, keyed;
+				SampleChannel((int)channel, time, baked);
+				SampleKeys((int)channel, time, keyed);
+				error.Measure(baked, keyed);
+			}
+		}
+
+		const char* reference = IsCompressed() ? "compressed keys" : "raw keys";
+		if (!error.Within(tolerance))
+		{
+			std::cout << "WARNING::BAKE:: " << m_Path << " at " << sampleRate << " Hz strays " << error.position << " units / "
+				<< error.rotation << " deg / " << error.scale << " scale from the " << reference << ", over the tolerance of "
+				<< tolerance.position << " / " << tolerance.rotation << " / " << tolerance.scale << "; sampling the keys instead" << std::endl;
+			m_BakedPoses.clear();
+			m_BakedPoses.shrink_to_fit();
+			m_BakedFrameCount = 0;
+			return false;
+		}
+
+		std::cout << "Baked " << m_Path << " at " << sampleRate << " Hz: " << m_BakedFrameCount << " frames, "
+			<< GetBakedBytes() << " bytes (keys " << GetKeyBytes() << "), max error against the " << reference << " "
+			<< error.position << " units / " << error.rotation << " deg / " << error.scale << " scale" << std::endl;
+		return true;
+	}
+
+	// Replaces the raw keys with a CompressedClip within the given bone-space tolerances, then
+	// frees them. A baked table is left as it is; the compressed keys are what the clip falls
+	// back to without one. Keys a cooking run stored in the cache for the same tolerance are
+	// taken as they are; otherwise the keys are reduced here, the error against the raw keys is
+	// measured at 120 Hz, and a cooking run writes the result to the cache. A result that still
+	// strays past the tolerance is dropped with a warning and the clip keeps its raw keys.
+	void Compress(const CompressionTolerance& tolerance)
+	{
+		if (IsCompressed())
+			return;
+
+		bool fromCache = !m_CachedCompressed.IsEmpty() && m_CompressionTolerance == tolerance;
+		if (fromCache)
+			m_Compressed = std::move(m_CachedCompressed);
+		else
+		{
+			// reduce within 90% of the tolerance, leaving the rest for quantizing the kept keys
+			CompressionTolerance reduction = tolerance;
+			reduction.position *= 0.9f;
+			reduction.rotation *= 0.9f;
+			reduction.scale *= 0.9f;
+			m_Compressed.Reset(m_Duration);
+			for (const Bone& bone : m_Bones)
+				m_Compressed.AddChannel(bone, reduction);
+
+			PoseError error;
+			float probeTicks = m_TicksPerSecond / 120.0f;
+			for (float time = 0.0f; time <= m_Duration; time += probeTicks)
+			{
+				for (size_t channel = 0; channel < m_Bones.size(); channel++)
+				{
+					BonePose compressed;
+					m_Compressed.Sample((int)channel, time, compressed);
+					m_Bones[channel].Update(time);
+					error.Measure(compressed, m_Bones[channel].GetLocalPose());
+				}
+			}
+			m_CompressionTolerance = tolerance;
+			m_CompressionError = error;
+			if (AssetCache::IsCooking())
+				SaveCache(m_Path);
+		}
+		m_CachedCompressed = CompressedClip();
+
+		const PoseError& error = m_CompressionError;
+		if (!error.Within(tolerance))
+		{
+			std::cout << "WARNING::COMPRESS:: " << m_Path << " strays " << error.position << " units / " << error.rotation << " deg / "
+				<< error.scale << " scale from its keys, over the tolerance of " << tolerance.position << " / " << tolerance.rotation
+				<< " / " << tolerance.scale << "; keeping the raw keys" << std::endl;
+			m_Compressed = CompressedClip();
+			return;
+		}
+
+		size_t rawBytes = GetKeyDataBytes();
+		for (Bone& bone : m_Bones)
+			bone.ReleaseKeys();
+		m_KeyData.clear();
+		m_KeyData.shrink_to_fit();
+
+		std::cout << "Compressed " << m_Path << (fromCache ? " (from cache)" : "") << ": " << m_Compressed.GetBytes()
+			<< " bytes (raw keys " << rawBytes << "), " << m_Compressed.GetKeyCount() << " of " << m_Compressed.GetSourceKeyCount() << " keys kept, "
+			<< m_Compressed.GetConstantTrackCount() << " constant tracks, max error "
+			<< error.position << " units / " << error.rotation << " deg / " << error.scale << " scale" << std::endl;
+	}
+
+	inline bool IsBaked() const { return m_BakedFrameCount != 0; }
+	inline bool IsCompressed() const { return !m_Compressed.IsEmpty(); }
+	// what the clip's keys take now: compressed or raw
+	inline size_t GetKeyBytes() const { return IsCompressed() ? m_Compressed.GetBytes() : GetKeyDataBytes(); }
+	inline size_t GetBakedBytes() const { return m_BakedPoses.size() * sizeof(BonePose); }
+
 	inline float GetTicksPerSecond() { return m_TicksPerSecond; }
 	inline float GetDuration() { return m_Duration;}
 	inline float GetSpeed() { return m_Speed; }
-	inline const AssimpNodeData& GetRootNode() { return m_RootNode; }
-	inline const std::map<std::string,BoneInfo>& GetBoneIDMap() 
-	{ 
-		return m_BoneInfoMap;
-	}
+	inline const Skeleton& GetSkeleton() { return *m_Skeleton; }
+	inline size_t GetKeyDataBytes() const { return m_KeyData.size() * sizeof(float); }
+	// offset matrices of the model this clip was bound to, indexed by boneId
+	inline const std::vector<AffineTransform>& GetBoneOffsets() { return *m_BoneOffsets; }
 
 private:
+	// local pose of one channel straight from the keys, compressed if Compress has run. Nothing
+	// in the clip changes (the key cursors belong to the caller), so animators on different
+	// threads can sample it together.
+	void SampleKeys(int channel, float animationTime, BonePose& out, KeyCursors* cursors = nullptr)
+	{
+		if (IsCompressed())
+		{
+			m_Compressed.Sample(channel, animationTime, out);
+			return;
+		}
+		if (cursors)
+			m_Bones[channel].Sample(animationTime, out, cursors[channel]);
+		else
+			m_Bones[channel].Sample(animationTime, out);
+	}
+
 	void ReadMissingBones(const aiAnimation* animation, ModelAnim& model)
 	{
 		int size = animation->mNumChannels;
 
-		auto& boneInfoMap = model.GetBoneInfoMap();//getting m_BoneInfoMap from Model class
-		int& boneCount = model.GetBoneCount(); //getting the m_BoneCounter from Model class
+		//size the clip's key buffer: every bone's timestamps first, then every bone's values
+		size_t numTimes = 0;
+		size_t numValues = 0;
+		for (int i = 0; i < size; i++)
+			Bone::GetPackedSize(animation->mChannels[i], numTimes, numValues);
+		m_Bones.clear();
+		m_Bones.reserve(size);
+		m_KeyData.assign(numTimes + numValues, 0.0f);
+		float* times = m_KeyData.data();
+		float* values = m_KeyData.data() + numTimes;
 
 		//reading channels(bones engaged in an animation and their keyframes)
 		for (int i = 0; i < size; i++)
 		{
 			auto channel = animation->mChannels[i];
 			std::string boneName = channel->mNodeName.data;
-
-			if (boneInfoMap.find(boneName) == boneInfoMap.end())
-			{
-				boneInfoMap[boneName].id = boneCount;
-				boneCount++;
-			}
-			m_Bones.push_back(Bone(channel->mNodeName.data,
-				boneInfoMap[channel->mNodeName.data].id, channel));
+			//bones animated by the clip but not skinned by the model get an identity offset
+			int boneId = model.RegisterBone(boneName);
+			m_Bones.push_back(Bone(boneName, boneId, channel, times, values));
 		}
-
-		m_BoneInfoMap = boneInfoMap;
 	}
 
-	void ReadHierarchyData(AssimpNodeData& dest, const aiNode* src)
+	// resolves the channel driving each node of the model's skeleton by name, once, so the
+	// animator can walk the skeleton by index alone
+	void BindSkeleton(ModelAnim& model)
 	{
-		assert(src);
-
-		dest.name = src->mName.data;
-		dest.transformation = AssimpGLMHelpers::ConvertMatrixToGLMFormat(src->mTransformation);
-		dest.childrenCount = src->mNumChildren;
-
-		for (int i = 0; i < src->mNumChildren; i++)
+		const Skeleton& skeleton = model.GetSkeleton();
+		m_Skeleton = &skeleton;
+		m_BoneOffsets = &model.GetBoneOffsets();
+		m_NodeChannels.assign(skeleton.GetNodeCount(), -1);
+		for (int i = 0; i < (int)m_Bones.size(); i++)
 		{
-			AssimpNodeData newData;
-			ReadHierarchyData(newData, src->mChildren[i]);
-			dest.children.push_back(newData);
+			int node = skeleton.FindNode(m_Bones[i].GetBoneName());
+			if (node >= 0)
+				m_NodeChannels[node] = i;
 		}
+		NameLookups();
 	}
+
+	std::string m_Path;
 	float m_Duration;
 	float m_Speed;
 	int m_TicksPerSecond;
 	float currentDuration;
 	std::vector<Bone> m_Bones;
-	AssimpNodeData m_RootNode;
+	std::vector<float> m_KeyData;
+	std::vector<int> m_NodeChannels;
+	const Skeleton* m_Skeleton = nullptr;
 	float m_DurationInSecond;
-	std::map<std::string, BoneInfo> m_BoneInfoMap;
-	std::vector<DamageKeyframe> damageKeyframes;
+	const std::vector<AffineTransform>* m_BoneOffsets = nullptr;
+	std::vector<AnimationEvent> m_Events;   // sorted by time
+	// fixed-rate pose table from Bake(); empty when sampling straight from the keys
+	std::vector<BonePose> m_BakedPoses;
+	int m_BakedFrameCount = 0;
+	float m_BakedFrameTicks = 0.0f;
+	// quantized, reduced keys from Compress(); empty while sampling the raw keys
+	CompressedClip m_Compressed;
+	// the tolerance m_Compressed was reduced for and its measured error, as stored in the cache
+	CompressionTolerance m_CompressionTolerance;
+	PoseError m_CompressionError;
+	// compressed keys LoadCache found, until Compress takes them or drops them
+	CompressedClip m_CachedCompressed;
 };
 
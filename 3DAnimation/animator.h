@@ -7,10 +7,29 @@
 #include <glm/glm.hpp>
 #include <map>
 #include <vector>
+#include <algorithm>
+#include <functional>
 #include <assimp/scene.h>
 #include <assimp/Importer.hpp>
 #include "animation.h"
 #include "bone.h"
+#include "pose.h"
+#include "BlendTree.h"
+#include "Profiler.h"
+#include "AllocationCounter.h"
+
+// Read-only view of an animator's skinning palette. It points at the animator's own storage,
+// so it stays valid until that animator is destroyed and always shows the latest update.
+struct BonePalette
+{
+	const glm::mat4* data;
+	int count;
+
+	int size() const { return count; }
+	const glm::mat4& operator[](int i) const { return data[i]; }
+	const glm::mat4* begin() const { return data; }
+	const glm::mat4* end() const { return data + count; }
+};
 
 class Animator
 {
@@ -26,30 +45,197 @@ public:
 
 		for (int i = 0; i < 100; i++)
 			m_FinalBoneMatrices.push_back(glm::mat4(1.0f));
+
+		// an animator built with a clip may be evaluated without PlayAnimation ever running
+		if (animation)
+		{
+			m_GlobalTransforms.resize(animation->GetSkeleton().GetNodeCount());
+			m_KeyCursors.resize(animation->GetChannelCount());
+		}
 	}
 
-	void UpdateAnimation(float dt)
+	// simulation tick: advances the clip clocks only. The pose is sampled once per rendered
+	// frame by EvaluatePose, so the tick rate and the frame rate can differ.
+	void Advance(float dt)
 	{
 		m_DeltaTime = dt;
+		if (m_BlendTree)
+		{
+			m_BlendTree->Advance(dt, [this](const Animation& clip, float from, float to, bool wrapped, bool includeFrom) {
+				ReportEvents(clip, from, to, wrapped, includeFrom);
+			});
+			return;
+		}
 		m_AnimationTimer += m_DeltaTime * m_CurrentAnimation->GetSpeed();
 		m_AnimationTimer = fmod(m_AnimationTimer, m_CurrentAnimation->GetDuration() / m_CurrentAnimation->GetTicksPerSecond());
 		if (m_CurrentAnimation)
 		{
-			m_CurrentTime += m_CurrentAnimation->GetTicksPerSecond() * dt * m_CurrentAnimation->GetSpeed();
+			float previousTime = m_CurrentTime;
+			m_TickAdvance = m_CurrentAnimation->GetTicksPerSecond() * dt * m_CurrentAnimation->GetSpeed();
+			m_CurrentTime += m_TickAdvance;
+			bool wrapped = m_CurrentTime >= m_CurrentAnimation->GetDuration();
 			m_CurrentTime = fmod(m_CurrentTime, m_CurrentAnimation->GetDuration());
+			ReportEvents(*m_CurrentAnimation, previousTime, m_CurrentTime, wrapped, m_StartedFresh);
+			m_StartedFresh = false;
 
 			if (m_CurrentAnimation2)
 			{
-				m_CurrentTime2 += m_CurrentAnimation2->GetTicksPerSecond() * dt * m_CurrentAnimation->GetSpeed();
+				float previousTime2 = m_CurrentTime2;
+				m_TickAdvance2 = m_CurrentAnimation2->GetTicksPerSecond() * dt * m_CurrentAnimation->GetSpeed();
+				m_CurrentTime2 += m_TickAdvance2;
+				bool wrapped2 = m_CurrentTime2 >= m_CurrentAnimation2->GetDuration();
 				m_CurrentTime2 = fmod(m_CurrentTime2, m_CurrentAnimation2->GetDuration());
+				ReportEvents(*m_CurrentAnimation2, previousTime2, m_CurrentTime2, wrapped2, m_StartedFresh2);
+				m_StartedFresh2 = false;
 			}
+		}
+	}
+
+	// Advance hands every event either clip crosses to each listener, in order along the clip
+	// and exactly once however the ticks fall: a clip passing its end reports the events up to
+	// the end and then those from its start. A listener must not call PlayAnimation on this
+	// animator; it runs in the middle of the advance.
+	typedef std::function<void(const Animation& clip, const AnimationEvent& event)> EventListener;
+
+	void AddEventListener(EventListener listener)
+	{
+		m_EventListeners.push_back(std::move(listener));
+	}
 
-			CalculateBoneTransform(&m_CurrentAnimation->GetRootNode(), glm::mat4(1.0f));
+	// render frame: samples the pose alpha of the way from the previous tick to the latest one,
+	// by stepping the clip clocks back over the part of the last advance not yet shown
+	void EvaluatePose(float alpha)
+	{
+		// reported per sampled bone so clip length doesn't hide in the per-frame total
+		static ProfileSection s_BoneSampling("Animator bone sampling", "bone");
+		ProfileScope profile(s_BoneSampling, 0);
+		NoAllocationScope noAllocations;
+		m_SampledBones = 0;
+
+		if (m_LodInterval <= 1)
+			SamplePose(alpha);
+		else
+		{
+			// every interval-th frame samples a new latest pose; every frame shows the palette
+			// part of the way from the pose before it, reaching it on the last frame before the next
+			int boneCount = (int)m_FinalBoneMatrices.size();
+			if (m_LodPhase == 0)
+			{
+				m_LodLatest ^= 1;
+				m_PoseOutput = &m_LodPoses[m_LodLatest * boneCount];
+				SamplePose(alpha);
+				m_PoseOutput = nullptr;
+			}
+			m_LodPhase = (m_LodPhase + 1) % m_LodInterval;
+			float weight = m_LodPhase == 0 ? 1.0f : (float)m_LodPhase / m_LodInterval;
+			const glm::mat4* previous = &m_LodPoses[(m_LodLatest ^ 1) * boneCount];
+			const glm::mat4* latest = &m_LodPoses[m_LodLatest * boneCount];
+			glm::mat4* palette = m_PaletteTarget ? m_PaletteTarget : m_FinalBoneMatrices.data();
+			for (int bone = 0; bone < boneCount; bone++)
+				palette[bone] = previous[bone] + (latest[bone] - previous[bone]) * weight;
 		}
+		profile.SetCount(m_SampledBones);
+	}
+
+	// Animation level of detail. updateInterval > 1 samples the pose on only every
+	// updateInterval-th EvaluatePose and blends the palette towards it on the frames between,
+	// so the pose shows up to updateInterval - 1 frames late. reducedBones holds the skeleton's
+	// detail nodes (fingers, face) at their bind pose instead of sampling them. Advance is not
+	// affected: clocks and events stay exact at every level. phase staggers which frames sample
+	// among characters on the same interval; it only applies when the interval changes.
+	void SetLod(int updateInterval, bool reducedBones, int phase = 0)
+	{
+		updateInterval = std::max(1, updateInterval);
+		if (updateInterval != m_LodInterval && updateInterval > 1)
+		{
+			// both the previous and the latest pose start as whatever the palette shows now:
+			// the pose holds until the next sample and then blends on from it, instead of from
+			// zero matrices (a new buffer) or a pose left over from an earlier interval
+			int boneCount = (int)m_FinalBoneMatrices.size();
+			m_LodPoses.resize((size_t)boneCount * 2);
+			BonePalette current = GetFinalBoneMatrices();
+			std::copy(current.begin(), current.end(), m_LodPoses.begin());
+			std::copy(current.begin(), current.end(), m_LodPoses.begin() + boneCount);
+			m_LodPhase = phase % updateInterval;
+		}
+		m_LodInterval = updateInterval;
+		m_LodReducedBones = reducedBones;
+	}
+
+	int GetLodInterval() const { return m_LodInterval; }
+	bool HasReducedBones() const { return m_LodReducedBones; }
+
+	// the hierarchy the pose is built on, from the blend tree or the primary clip; null if neither
+	const Skeleton* GetSkeleton() const
+	{
+		if (m_BlendTree)
+			return m_BlendTree->GetSkeleton();
+		return m_CurrentAnimation ? &m_CurrentAnimation->GetSkeleton() : nullptr;
+	}
+
+	// samples the current pose into the palette, or into m_PoseOutput when that is set
+	void SamplePose(float alpha)
+	{
+		if (m_BlendTree)
+		{
+			const Skeleton* skeleton = m_BlendTree->GetSkeleton();
+			m_BlendTree->Evaluate(alpha, m_LodReducedBones && skeleton ? skeleton->GetDetailNodes() : nullptr);
+			if (skeleton)
+				CalculateBoneTransforms(*m_BlendTree);
+			m_SampledBones = m_BlendTree->GetSampledChannels();
+		}
+		else if (m_CurrentAnimation)
+		{
+			float rewind = 1.0f - alpha;
+			float time1 = WrapTime(m_CurrentTime - rewind * m_TickAdvance, m_CurrentAnimation->GetDuration());
+			float time2 = m_CurrentAnimation2 ? WrapTime(m_CurrentTime2 - rewind * m_TickAdvance2, m_CurrentAnimation2->GetDuration()) : 0.0f;
+			CalculateBoneTransforms(time1, time2);
+		}
+	}
+
+	void UpdateAnimation(float dt)
+	{
+		Advance(dt);
+		EvaluatePose(1.0f);
 	}
 
 	void PlayAnimation(Animation* pAnimation, Animation* pAnimation2, float time1, float time2, float blend)
 	{
+		// size the global transform scratch here so UpdateAnimation never has to
+		if (pAnimation && (int)m_GlobalTransforms.size() < pAnimation->GetSkeleton().GetNodeCount())
+			m_GlobalTransforms.resize(pAnimation->GetSkeleton().GetNodeCount());
+
+		// a clip that changes has no previous tick to interpolate from, nor key cursors
+		if (pAnimation != m_CurrentAnimation)
+		{
+			m_TickAdvance = 0.0f;
+			m_KeyCursors.assign(pAnimation ? pAnimation->GetChannelCount() : 0, KeyCursors());
+		}
+		if (pAnimation2 != m_CurrentAnimation2)
+		{
+			m_TickAdvance2 = 0.0f;
+			m_KeyCursors2.assign(pAnimation2 ? pAnimation2->GetChannelCount() : 0, KeyCursors());
+		}
+
+		// A clip already playing in either slot carries on along its timeline, so events it has
+		// reported stay reported. Any other clip starts fresh and also reports an event sitting
+		// exactly on its start time.
+		m_StartedFresh = (pAnimation != m_CurrentAnimation && pAnimation != m_CurrentAnimation2)
+			|| (m_StartedFresh && pAnimation == m_CurrentAnimation);
+		m_StartedFresh2 = (pAnimation2 && pAnimation2 != m_CurrentAnimation && pAnimation2 != m_CurrentAnimation2)
+			|| (m_StartedFresh2 && pAnimation2 == m_CurrentAnimation2);
+
+		// a blend target bound to another model's skeleton can only be matched up by name; do
+		// that once for the pair instead of per node every frame
+		if (pAnimation && pAnimation2 && &pAnimation2->GetSkeleton() != &pAnimation->GetSkeleton()
+			&& (pAnimation != m_CurrentAnimation || pAnimation2 != m_CurrentAnimation2))
+		{
+			const Skeleton& skeleton = pAnimation->GetSkeleton();
+			m_BlendChannels.resize(skeleton.GetNodeCount());
+			for (int node = 0; node < skeleton.GetNodeCount(); node++)
+				m_BlendChannels[node] = pAnimation2->FindChannel(skeleton.GetNodeName(node));
+		}
+
 		m_CurrentAnimation = pAnimation;
 		m_CurrentTime = time1;
 		m_CurrentAnimation2 = pAnimation2;
@@ -59,70 +245,121 @@ public:
 
 	}
 
-	glm::mat4 UpdateBlend(Bone* Bone1, Bone* Bone2) {
-		glm::vec3 bonePos1, bonePos2, finalPos;
-		glm::vec3 boneScale1, boneScale2, finalScale;
-		glm::quat boneRot1, boneRot2, finalRot;
-
-		Bone1->InterpolatePosition(m_CurrentTime, bonePos1);
-		Bone2->InterpolatePosition(m_CurrentTime2, bonePos2);
-		Bone1->InterpolateRotation(m_CurrentTime, boneRot1);
-		Bone2->InterpolateRotation(m_CurrentTime2, boneRot2);
-		Bone1->InterpolateScaling(m_CurrentTime, boneScale1);
-		Bone2->InterpolateScaling(m_CurrentTime2, boneScale2);
-
-		finalPos = glm::mix(bonePos1, bonePos2, m_blendAmount);
-		finalRot = glm::slerp(boneRot1, boneRot2, m_blendAmount);
-		finalRot = glm::normalize(finalRot);
-		finalScale = glm::mix(boneScale1, boneScale2, m_blendAmount);
-
-		glm::mat4 translation = glm::translate(glm::mat4(1.0f), finalPos);
-		glm::mat4 rotation = glm::toMat4(finalRot);
-		glm::mat4 scale = glm::scale(glm::mat4(1.0f), finalScale);
+	// Hands the pose over to a blend tree of any number of clips and layers, or back to the
+	// two playback slots with nullptr. The tree is not owned. While it is set, Advance moves the
+	// tree's clocks instead of the slots' and reports the events its weighted inputs cross.
+	void SetBlendTree(BlendTree* tree)
+	{
+		if (tree && tree->GetSkeleton() && (int)m_GlobalTransforms.size() < tree->GetSkeleton()->GetNodeCount())
+			m_GlobalTransforms.resize(tree->GetSkeleton()->GetNodeCount());
+		m_BlendTree = tree;
+	}
 
-		glm::mat4 TRS = glm::mat4(1.0f);
-		TRS = translation * rotation * scale;
-		return TRS;
+	BlendTree* getBlendTree() const {
+		return m_BlendTree;
 	}
 
-	void CalculateBoneTransform(const AssimpNodeData* node, glm::mat4 parentTransform)
+	// one forward pass over the shared skeleton: parents precede children, so each node's
+	// global transform only needs its parent's, already computed. Local poses stay as
+	// translation/rotation/scale until Compose, and the concatenation is done on 3x4 affines.
+	void CalculateBoneTransforms(float time1, float time2)
 	{
-		std::string nodeName = node->name;
-		glm::mat4 nodeTransform = node->transformation;
+		const Skeleton& skeleton = m_CurrentAnimation->GetSkeleton();
+		const int* parents = skeleton.GetParents();
+		const int* boneIds = skeleton.GetBoneIds();
+		const AffineTransform* bindTransforms = skeleton.GetBindTransforms();
+		const AffineTransform* offsets = m_CurrentAnimation->GetBoneOffsets().data();
+		AffineTransform* globals = m_GlobalTransforms.data();
+		glm::mat4* palette = GetPoseOutput();
+		const unsigned char* skipNodes = m_LodReducedBones ? skeleton.GetDetailNodes() : nullptr;
+		// a blend target on another skeleton goes through the table PlayAnimation matched up by name
+		bool sharedSkeleton = m_CurrentAnimation2 && &m_CurrentAnimation2->GetSkeleton() == &skeleton;
+
+		for (int node = 0; node < skeleton.GetNodeCount(); node++)
+		{
+			AffineTransform nodeTransform;
+
+			int channel1 = skipNodes && skipNodes[node] ? -1 : m_CurrentAnimation->GetChannelForNode(node);
+			if (channel1 >= 0)
+			{
+				m_SampledBones++;
+				BonePose pose;
+				m_CurrentAnimation->SampleChannel(channel1, time1, pose, m_KeyCursors.data());
+
+				int channel2 = -1;
+				if (m_CurrentAnimation2) {
+					channel2 = sharedSkeleton ? m_CurrentAnimation2->GetChannelForNode(node)
+						: m_BlendChannels[node];
+				}
+				if (channel2 >= 0) {
+					BonePose pose2;
+					m_CurrentAnimation2->SampleChannel(channel2, time2, pose2, m_KeyCursors2.data());
+					PoseMath::Blend(pose, pose2, m_blendAmount, pose);
+				}
+				PoseMath::Compose(pose, nodeTransform);
+			}
+			else
+				nodeTransform = bindTransforms[node];
 
-		Bone* Bone1 = m_CurrentAnimation->FindBone(nodeName);
-		Bone* Bone2 = NULL;
-		if (m_CurrentAnimation2) {
-			Bone2 = m_CurrentAnimation2->FindBone(nodeName);
+			StoreNode(node, nodeTransform, parents[node], boneIds[node], offsets, globals, palette);
 		}
+	}
 
-		if (Bone1)
+	// the same pass with the local poses a blend tree has already mixed
+	void CalculateBoneTransforms(const BlendTree& tree)
+	{
+		const Skeleton& skeleton = *tree.GetSkeleton();
+		const int* parents = skeleton.GetParents();
+		const int* boneIds = skeleton.GetBoneIds();
+		const AffineTransform* bindTransforms = skeleton.GetBindTransforms();
+		const AffineTransform* offsets = tree.GetBoneOffsets().data();
+		const BonePose* poses = tree.GetPose();
+		AffineTransform* globals = m_GlobalTransforms.data();
+		glm::mat4* palette = GetPoseOutput();
+
+		for (int node = 0; node < skeleton.GetNodeCount(); node++)
 		{
-			Bone1->Update(m_CurrentTime);
-			nodeTransform = Bone1->GetLocalTransform();
+			AffineTransform nodeTransform;
+			if (tree.IsDriven(node))
+				PoseMath::Compose(poses[node], nodeTransform);
+			else
+				nodeTransform = bindTransforms[node];
 
-			if (Bone2) {
-				nodeTransform = UpdateBlend(Bone1, Bone2);
-			}
+			StoreNode(node, nodeTransform, parents[node], boneIds[node], offsets, globals, palette);
 		}
+	}
 
-		glm::mat4 globalTransformation = parentTransform * nodeTransform;
+	// concatenates one node onto its parent's global transform and writes its skinning matrix
+	static inline void StoreNode(int node, const AffineTransform& nodeTransform, int parent, int boneId,
+		const AffineTransform* offsets, AffineTransform* globals, glm::mat4* palette)
+	{
+		if (parent < 0)
+			globals[node] = nodeTransform;
+		else
+			PoseMath::Multiply(globals[parent], nodeTransform, globals[node]);
 
-		auto boneInfoMap = m_CurrentAnimation->GetBoneIDMap();
-		if (boneInfoMap.find(nodeName) != boneInfoMap.end())
+		if (boneId >= 0)
 		{
-			int index = boneInfoMap[nodeName].id;
-			glm::mat4 offset = boneInfoMap[nodeName].offset;
-			m_FinalBoneMatrices[index] = globalTransformation * offset;
+			AffineTransform skinning;
+			PoseMath::Multiply(globals[node], offsets[boneId], skinning);
+			PoseMath::ToMat4(skinning, palette[boneId]);
 		}
+	}
 
-		for (int i = 0; i < node->childrenCount; i++)
-			CalculateBoneTransform(&node->children[i], globalTransformation);
+	BonePalette GetFinalBoneMatrices() const
+	{
+		BonePalette palette = { m_PaletteTarget ? m_PaletteTarget : m_FinalBoneMatrices.data(), (int)m_FinalBoneMatrices.size() };
+		return palette;
 	}
 
-	std::vector<glm::mat4> GetFinalBoneMatrices()
+	// Redirects palette writes to external storage of at least GetFinalBoneMatrices().size()
+	// matrices, e.g. a mapped uniform buffer, so the pose lands there without a copy.
+	// Pass nullptr to go back to the animator's own palette.
+	void SetPaletteTarget(glm::mat4* target)
 	{
-		return m_FinalBoneMatrices;
+		if (target)
+			std::copy(m_FinalBoneMatrices.begin(), m_FinalBoneMatrices.end(), target);
+		m_PaletteTarget = target;
 	}
 
 	Animation* getCurrentAnimation() const {
@@ -163,6 +400,29 @@ public:
 
 
 	//private:
+	static float WrapTime(float time, float duration)
+	{
+		time = fmod(time, duration);
+		return time < 0.0f ? time + duration : time;
+	}
+
+	glm::mat4* GetPoseOutput()
+	{
+		if (m_PoseOutput)
+			return m_PoseOutput;
+		return m_PaletteTarget ? m_PaletteTarget : m_FinalBoneMatrices.data();
+	}
+
+	void ReportEvents(const Animation& clip, float from, float to, bool wrapped, bool includeFrom)
+	{
+		if (m_EventListeners.empty())
+			return;
+		clip.ForEachEventCrossed(from, to, wrapped, includeFrom, [&](const AnimationEvent& event) {
+			for (const EventListener& listener : m_EventListeners)
+				listener(clip, event);
+		});
+	}
+
 	std::vector<glm::mat4> m_FinalBoneMatrices;
 	Animation* m_CurrentAnimation;
 	Animation* m_CurrentAnimation2;
@@ -172,6 +432,24 @@ public:
 	float m_blendAmount;
 	float m_speed;
 	float m_AnimationTimer;
+	float m_TickAdvance = 0.0f;   // clip ticks the last Advance moved each clock by
+	float m_TickAdvance2 = 0.0f;
+	bool m_StartedFresh = true;   // set by PlayAnimation for a clip that was not already playing
+	bool m_StartedFresh2 = false;
+	std::vector<EventListener> m_EventListeners;
 	bool m_IsPaused = false;
+	int m_SampledBones = 0;
+	std::vector<AffineTransform> m_GlobalTransforms;
+	std::vector<int> m_BlendChannels;   // blend target channel per node when the skeletons differ
+	std::vector<KeyCursors> m_KeyCursors;    // per channel of each slot's clip, for the raw key lookup
+	std::vector<KeyCursors> m_KeyCursors2;
+	glm::mat4* m_PaletteTarget = nullptr;
+	BlendTree* m_BlendTree = nullptr;
+	int m_LodInterval = 1;
+	int m_LodPhase = 0;           // frames since the last sampled pose, under m_LodInterval
+	int m_LodLatest = 0;          // which half of m_LodPoses holds the latest sampled pose
+	bool m_LodReducedBones = false;
+	std::vector<glm::mat4> m_LodPoses;   // the last two sampled poses, back to back
+	glm::mat4* m_PoseOutput = nullptr;   // set while EvaluatePose samples into m_LodPoses
 
 };
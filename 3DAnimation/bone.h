@@ -9,81 +9,139 @@
 #define GLM_ENABLE_EXPERIMENTAL
 #include <glm/gtx/quaternion.hpp>
 #include "assimp_glm_helpers.h"
+#include "pose.h"
 
-struct KeyPosition
+// where the last lookup on each of one bone's tracks landed, for Bone::Sample; -1 until the
+// first lookup
+struct KeyCursors
 {
-	glm::vec3 position;
-	float timeStamp;
-};
-
-struct KeyRotation
-{
-	glm::quat orientation;
-	float timeStamp;
-};
-
-struct KeyScale
-{
-	glm::vec3 scale;
-	float timeStamp;
+	int position = -1;
+	int rotation = -1;
+	int scale = -1;
 };
 
+/* Keys are not owned by the bone. Animation packs every bone's timestamps into one
+   contiguous run and every bone's values into another, inside a single allocation per clip,
+   so the time search only ever walks floats and the values it lands on sit side by side. */
 class Bone
 {
 public:
-	Bone(const std::string& name, int ID, const aiNodeAnim* channel)
+	// number of floats a channel needs in the clip's timestamp and value runs
+	static void GetPackedSize(const aiNodeAnim* channel, size_t& numTimes, size_t& numValues)
+	{
+		numTimes += channel->mNumPositionKeys + channel->mNumRotationKeys + channel->mNumScalingKeys;
+		numValues += channel->mNumPositionKeys * 3 + channel->mNumRotationKeys * 4 + channel->mNumScalingKeys * 3;
+	}
+
+	// copies the channel's keys to the clip buffer at the two write cursors and advances them
+	Bone(const std::string& name, int ID, const aiNodeAnim* channel, float*& times, float*& values)
 		:
 		m_Name(name),
-		m_ID(ID),
-		m_LocalTransform(1.0f)
+		m_ID(ID)
 	{
 		m_NumPositions = channel->mNumPositionKeys;
-
+		m_PositionTimes = times;
+		m_Positions = reinterpret_cast<const glm::vec3*>(values);
 		for (int positionIndex = 0; positionIndex < m_NumPositions; ++positionIndex)
 		{
-			aiVector3D aiPosition = channel->mPositionKeys[positionIndex].mValue;
-			float timeStamp = channel->mPositionKeys[positionIndex].mTime;
-			KeyPosition data;
-			data.position = AssimpGLMHelpers::GetGLMVec(aiPosition);
-			data.timeStamp = timeStamp;
-			m_Positions.push_back(data);
+			glm::vec3 position = AssimpGLMHelpers::GetGLMVec(channel->mPositionKeys[positionIndex].mValue);
+			*times++ = channel->mPositionKeys[positionIndex].mTime;
+			*values++ = position.x;
+			*values++ = position.y;
+			*values++ = position.z;
 		}
 
 		m_NumRotations = channel->mNumRotationKeys;
+		m_RotationTimes = times;
+		m_Rotations = reinterpret_cast<const glm::quat*>(values);
 		for (int rotationIndex = 0; rotationIndex < m_NumRotations; ++rotationIndex)
 		{
-			aiQuaternion aiOrientation = channel->mRotationKeys[rotationIndex].mValue;
-			float timeStamp = channel->mRotationKeys[rotationIndex].mTime;
-			KeyRotation data;
-			data.orientation = AssimpGLMHelpers::GetGLMQuat(aiOrientation);
-			data.timeStamp = timeStamp;
-			m_Rotations.push_back(data);
+			glm::quat orientation = AssimpGLMHelpers::GetGLMQuat(channel->mRotationKeys[rotationIndex].mValue);
+			*times++ = channel->mRotationKeys[rotationIndex].mTime;
+			*values++ = orientation.x;
+			*values++ = orientation.y;
+			*values++ = orientation.z;
+			*values++ = orientation.w;
 		}
 
 		m_NumScalings = channel->mNumScalingKeys;
+		m_ScaleTimes = times;
+		m_Scales = reinterpret_cast<const glm::vec3*>(values);
 		for (int keyIndex = 0; keyIndex < m_NumScalings; ++keyIndex)
 		{
-			aiVector3D scale = channel->mScalingKeys[keyIndex].mValue;
-			float timeStamp = channel->mScalingKeys[keyIndex].mTime;
-			KeyScale data;
-			data.scale = AssimpGLMHelpers::GetGLMVec(scale);
-			data.timeStamp = timeStamp;
-			m_Scales.push_back(data);
+			glm::vec3 scale = AssimpGLMHelpers::GetGLMVec(channel->mScalingKeys[keyIndex].mValue);
+			*times++ = channel->mScalingKeys[keyIndex].mTime;
+			*values++ = scale.x;
+			*values++ = scale.y;
+			*values++ = scale.z;
 		}
 	}
 
+	// binds to keys already packed in the clip buffer (e.g. copied from the asset cache) and
+	// advances the two read cursors past them
+	Bone(const std::string& name, int ID, int numPositions, int numRotations, int numScalings,
+		const float*& times, const float*& values)
+		:
+		m_Name(name),
+		m_ID(ID)
+	{
+		m_NumPositions = numPositions;
+		m_PositionTimes = times;
+		m_Positions = reinterpret_cast<const glm::vec3*>(values);
+		times += numPositions;
+		values += numPositions * 3;
+
+		m_NumRotations = numRotations;
+		m_RotationTimes = times;
+		m_Rotations = reinterpret_cast<const glm::quat*>(values);
+		times += numRotations;
+		values += numRotations * 4;
+
+		m_NumScalings = numScalings;
+		m_ScaleTimes = times;
+		m_Scales = reinterpret_cast<const glm::vec3*>(values);
+		times += numScalings;
+		values += numScalings * 3;
+	}
+
 	void Update(float animationTime)
 	{
-		glm::vec3 tmp;
-		glm::quat tmpR;
-		glm::mat4 translation = InterpolatePosition(animationTime, tmp);
-		glm::mat4 rotation = InterpolateRotation(animationTime, tmpR);
-		glm::mat4 scale = InterpolateScaling(animationTime, tmp);
-		m_LocalTransform = translation * rotation * scale;
+		m_LocalPose.translation = InterpolatePosition(animationTime);
+		m_LocalPose.rotation = InterpolateRotation(animationTime);
+		m_LocalPose.scale = InterpolateScaling(animationTime);
+	}
+	const BonePose& GetLocalPose() const { return m_LocalPose; }
+
+	// Update with cursors the caller keeps instead of the bone's own, and without touching the
+	// bone's pose, so any number of threads can sample the same clip at once. Each animator
+	// keeps its own cursors and still gets the forward-step lookup.
+	void Sample(float animationTime, BonePose& out, KeyCursors& cursors) const
+	{
+		out.translation = InterpolatePosition(animationTime, cursors.position);
+		out.rotation = InterpolateRotation(animationTime, cursors.rotation);
+		out.scale = InterpolateScaling(animationTime, cursors.scale);
+	}
+
+	// one-off sample with no cursors to carry over; every lookup is a binary search
+	void Sample(float animationTime, BonePose& out) const
+	{
+		KeyCursors cursors;
+		Sample(animationTime, out, cursors);
+	}
+
+	// forgets the keys once the clip no longer samples them (e.g. it compressed them)
+	void ReleaseKeys()
+	{
+		m_PositionTimes = m_RotationTimes = m_ScaleTimes = nullptr;
+		m_Positions = m_Scales = nullptr;
+		m_Rotations = nullptr;
+		m_NumPositions = m_NumRotations = m_NumScalings = 0;
 	}
-	glm::mat4 GetLocalTransform() { return m_LocalTransform; }
 	std::string GetBoneName() const { return m_Name; }
 	int GetBoneID() { return m_ID; }
+	int GetNumPositionKeys() const { return m_NumPositions; }
+	int GetNumRotationKeys() const { return m_NumRotations; }
+	int GetNumScalingKeys() const { return m_NumScalings; }
 	
 	glm::mat4 GetFinalTransformation() const {
 		return m_FinalTransformation; // This should be calculated during the animation update
@@ -92,12 +150,7 @@ public:
 
 	int GetPositionIndex(float animationTime)
 	{
-		for (int index = 0; index < m_NumPositions - 1; ++index)
-		{
-			if (animationTime < m_Positions[index + 1].timeStamp)
-				return index;
-		}
-		assert(0);
+		return FindKeyIndex(m_PositionTimes, m_NumPositions, animationTime, m_PositionCursor);
 	}
 
 	void SetFinalTransformation(const glm::mat4& transform) {
@@ -107,28 +160,52 @@ public:
 
 	int GetRotationIndex(float animationTime)
 	{
-		for (int index = 0; index < m_NumRotations - 1; ++index)
-		{
-			if (animationTime < m_Rotations[index + 1].timeStamp)
-				return index;
-		}
-		assert(0);
+		return FindKeyIndex(m_RotationTimes, m_NumRotations, animationTime, m_RotationCursor);
 	}
 
 	int GetScaleIndex(float animationTime)
 	{
-		for (int index = 0; index < m_NumScalings - 1; ++index)
+		return FindKeyIndex(m_ScaleTimes, m_NumScalings, animationTime, m_ScaleCursor);
+	}
+
+	/* Returns the key i with times[i] <= animationTime < times[i + 1],
+	   clamped to the first/last segment. The cursor holds the previous answer for this track:
+	   forward playback only ever advances it by a key or two, and anything else (seeks, loop
+	   wrap-around, a second animator sampling the same clip) falls back to a binary search. */
+	static int FindKeyIndex(const float* times, int numKeys, float animationTime, int& cursor)
+	{
+		const int lastSegment = numKeys - 2;
+		int index = cursor;
+		if (index >= 0 && index <= lastSegment && animationTime >= times[index])
+		{
+			for (int step = 0; step < 4; ++step, ++index)
+			{
+				if (index == lastSegment || animationTime < times[index + 1])
+				{
+					cursor = index;
+					return index;
+				}
+			}
+		}
+
+		int low = 0;
+		int high = lastSegment;
+		while (low < high)
 		{
-			if (animationTime < m_Scales[index + 1].timeStamp)
-				return index;
+			int mid = (low + high) / 2;
+			if (animationTime < times[mid + 1])
+				high = mid;
+			else
+				low = mid + 1;
 		}
-		assert(0);
+		cursor = low;
+		return low;
 	}
 
 
 	//private:
 
-	float GetScaleFactor(float lastTimeStamp, float nextTimeStamp, float animationTime)
+	static float GetScaleFactor(float lastTimeStamp, float nextTimeStamp, float animationTime)
 	{
 		float scaleFactor = 0.0f;
 		float midWayLength = animationTime - lastTimeStamp;
@@ -137,65 +214,74 @@ public:
 		return scaleFactor;
 	}
 
-	glm::mat4 InterpolatePosition(float animationTime, glm::vec3& finalPos)
+	glm::vec3 InterpolatePosition(float animationTime)
+	{
+		return InterpolatePosition(animationTime, m_PositionCursor);
+	}
+
+	glm::vec3 InterpolatePosition(float animationTime, int& cursor) const
 	{
 		if (1 == m_NumPositions)
-			return glm::translate(glm::mat4(1.0f), m_Positions[0].position);
+			return m_Positions[0];
 
-		int p0Index = GetPositionIndex(animationTime);
+		int p0Index = FindKeyIndex(m_PositionTimes, m_NumPositions, animationTime, cursor);
 		int p1Index = p0Index + 1;
-		float scaleFactor = GetScaleFactor(m_Positions[p0Index].timeStamp,
-			m_Positions[p1Index].timeStamp, animationTime);
-		glm::vec3 finalPosition = glm::mix(m_Positions[p0Index].position, m_Positions[p1Index].position
-			, scaleFactor);
-		finalPos = finalPosition;
-		return glm::translate(glm::mat4(1.0f), finalPosition);
+		float scaleFactor = GetScaleFactor(m_PositionTimes[p0Index],
+			m_PositionTimes[p1Index], animationTime);
+		return glm::mix(m_Positions[p0Index], m_Positions[p1Index], scaleFactor);
+	}
+
+	glm::quat InterpolateRotation(float animationTime)
+	{
+		return InterpolateRotation(animationTime, m_RotationCursor);
 	}
 
-	glm::mat4 InterpolateRotation(float animationTime, glm::quat& finalQuat)
+	glm::quat InterpolateRotation(float animationTime, int& cursor) const
 	{
 		if (1 == m_NumRotations)
-		{
-			auto rotation = glm::normalize(m_Rotations[0].orientation);
-			return glm::toMat4(rotation);
-		}
+			return glm::normalize(m_Rotations[0]);
 
-		int p0Index = GetRotationIndex(animationTime);
+		int p0Index = FindKeyIndex(m_RotationTimes, m_NumRotations, animationTime, cursor);
 		int p1Index = p0Index + 1;
-		float scaleFactor = GetScaleFactor(m_Rotations[p0Index].timeStamp,
-			m_Rotations[p1Index].timeStamp, animationTime);
-		glm::quat finalRotation = glm::slerp(m_Rotations[p0Index].orientation, m_Rotations[p1Index].orientation
+		float scaleFactor = GetScaleFactor(m_RotationTimes[p0Index],
+			m_RotationTimes[p1Index], animationTime);
+		glm::quat finalRotation = glm::slerp(m_Rotations[p0Index], m_Rotations[p1Index]
 			, scaleFactor);
-		finalRotation = glm::normalize(finalRotation);
-		finalQuat = finalRotation;
-		return glm::toMat4(finalRotation);
+		return glm::normalize(finalRotation);
+	}
 
+	glm::vec3 InterpolateScaling(float animationTime)
+	{
+		return InterpolateScaling(animationTime, m_ScaleCursor);
 	}
 
-	glm::mat4 InterpolateScaling(float animationTime, glm::vec3& finalScaling)
+	glm::vec3 InterpolateScaling(float animationTime, int& cursor) const
 	{
 		if (1 == m_NumScalings)
-			return glm::scale(glm::mat4(1.0f), m_Scales[0].scale);
+			return m_Scales[0];
 
-		int p0Index = GetScaleIndex(animationTime);
+		int p0Index = FindKeyIndex(m_ScaleTimes, m_NumScalings, animationTime, cursor);
 		int p1Index = p0Index + 1;
-		float scaleFactor = GetScaleFactor(m_Scales[p0Index].timeStamp,
-			m_Scales[p1Index].timeStamp, animationTime);
-		glm::vec3 finalScale = glm::mix(m_Scales[p0Index].scale, m_Scales[p1Index].scale
-			, scaleFactor);
-		finalScaling = finalScale;
-		return glm::scale(glm::mat4(1.0f), finalScale);
+		float scaleFactor = GetScaleFactor(m_ScaleTimes[p0Index],
+			m_ScaleTimes[p1Index], animationTime);
+		return glm::mix(m_Scales[p0Index], m_Scales[p1Index], scaleFactor);
 	}
 
-	std::vector<KeyPosition> m_Positions;
-	std::vector<KeyRotation> m_Rotations;
-	std::vector<KeyScale> m_Scales;
+	const float* m_PositionTimes;
+	const float* m_RotationTimes;
+	const float* m_ScaleTimes;
+	const glm::vec3* m_Positions;
+	const glm::quat* m_Rotations;
+	const glm::vec3* m_Scales;
 	int m_NumPositions;
 	int m_NumRotations;
 	int m_NumScalings;
+	int m_PositionCursor = 0;
+	int m_RotationCursor = 0;
+	int m_ScaleCursor = 0;
 
 	glm::mat4 m_FinalTransformation;
-	glm::mat4 m_LocalTransform;
+	BonePose m_LocalPose;
 	std::string m_Name;
 	int m_ID;
 };
@@ -43,6 +43,7 @@ public:
     vector<unsigned int> indices;
     vector<PBRTexture>      textures;
     unsigned int VAO;
+    size_t indexCount;
 
     // constructor
     Mesh(vector<PBRVertex> vertices, vector<unsigned int> indices, vector<PBRTexture> textures)
@@ -52,7 +53,15 @@ public:
         this->textures = textures;
 
         // now that we have all the required data, set the vertex buffers and its attribute pointers.
-        setupMesh();
+        setupMesh(this->vertices.data(), this->vertices.size(), this->indices.data(), this->indices.size());
+    }
+
+    // uploads straight from caller-owned arrays (e.g. a mapped asset cache) without keeping
+    // a CPU copy, so vertices and indices stay empty
+    Mesh(const PBRVertex* vertexData, size_t vertexCount, const unsigned int* indexData, size_t indexCount, vector<PBRTexture> textures)
+    {
+        this->textures = textures;
+        setupMesh(vertexData, vertexCount, indexData, indexCount);
     }
 
     // render the mesh
@@ -88,7 +97,7 @@ public:
 
     //// Draw mesh
     //glBindVertexArray(VAO);
-    //glDrawElements(GL_TRIANGLES, static_cast<unsigned int>(indices.size()), GL_UNSIGNED_INT, 0);
+    //glDrawElements(GL_TRIANGLES, static_cast<unsigned int>(indexCount), GL_UNSIGNED_INT, 0);
     //glBindVertexArray(0);
 
     //// Always good practice to set everything back to defaults once configured.
@@ -96,10 +105,38 @@ public:
     //}
 
     void Draw(Shader& shader) {
-        unsigned int albedoNr = 1, normalNr = 1, metallicNr = 1, roughnessNr = 1, aoNr = 1;
-
+        resolveSamplers(shader);
         for (unsigned int i = 0; i < textures.size(); i++) {
             glActiveTexture(GL_TEXTURE0 + i + 3);
+            glUniform1i(samplerLocations[i], i + 3);
+            glBindTexture(GL_TEXTURE_2D, textures[i].id);
+        }
+
+        glBindVertexArray(VAO);
+        glDrawElements(GL_TRIANGLES, static_cast<unsigned int>(indexCount), GL_UNSIGNED_INT, 0);
+        glBindVertexArray(0);
+        glActiveTexture(GL_TEXTURE0);
+    }
+
+
+private:
+    // render data 
+    unsigned int VBO, EBO;
+    // sampler uniform of each texture (texture_albedoN etc.), resolved for samplerProgram
+    vector<string> samplerNames;
+    vector<GLint> samplerLocations;
+    unsigned int samplerProgram = 0;
+
+    // the names only depend on the texture list, so they are built once and their
+    // locations looked up again only when the mesh is drawn with a different shader
+    void resolveSamplers(Shader& shader) {
+        if (samplerProgram == shader.ID && samplerLocations.size() == textures.size())
+            return;
+
+        unsigned int albedoNr = 1, normalNr = 1, metallicNr = 1, roughnessNr = 1, aoNr = 1;
+        samplerNames.clear();
+        samplerLocations.clear();
+        for (unsigned int i = 0; i < textures.size(); i++) {
             string name = textures[i].type;
             string number;
 
@@ -114,24 +151,17 @@ public:
             else if (name == "texture_ao")
                 number = std::to_string(aoNr++);
 
-            shader.setInt(name + number, i + 3);
-            glBindTexture(GL_TEXTURE_2D, textures[i].id);
+            samplerNames.push_back(name + number);
+            samplerLocations.push_back(shader.getUniformLocation(samplerNames.back()));
         }
-
-        glBindVertexArray(VAO);
-        glDrawElements(GL_TRIANGLES, static_cast<unsigned int>(indices.size()), GL_UNSIGNED_INT, 0);
-        glBindVertexArray(0);
-        glActiveTexture(GL_TEXTURE0);
+        samplerProgram = shader.ID;
     }
 
-
-private:
-    // render data 
-    unsigned int VBO, EBO;
-
     // initializes all the buffer objects/arrays
-    void setupMesh()
+    void setupMesh(const PBRVertex* vertexData, size_t vertexCount, const unsigned int* indexData, size_t indexCount)
     {
+        this->indexCount = indexCount;
+
         // create buffers/arrays
         glGenVertexArrays(1, &VAO);
         glGenBuffers(1, &VBO);
@@ -143,10 +173,10 @@ private:
         // A great thing about structs is that their memory layout is sequential for all its items.
         // The effect is that we can simply pass a pointer to the struct and it translates perfectly to a glm::vec3/2 array which
         // again translates to 3/2 floats which translates to a byte array.
-        glBufferData(GL_ARRAY_BUFFER, vertices.size() * sizeof(PBRVertex), &vertices[0], GL_STATIC_DRAW);
+        glBufferData(GL_ARRAY_BUFFER, vertexCount * sizeof(PBRVertex), vertexData, GL_STATIC_DRAW);
 
         glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, EBO);
-        glBufferData(GL_ELEMENT_ARRAY_BUFFER, indices.size() * sizeof(unsigned int), &indices[0], GL_STATIC_DRAW);
+        glBufferData(GL_ELEMENT_ARRAY_BUFFER, indexCount * sizeof(unsigned int), indexData, GL_STATIC_DRAW);
 
         // set the vertex attribute pointers
         // vertex Positions
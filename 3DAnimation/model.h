@@ -5,34 +5,37 @@
 
 #include <glm/glm.hpp>
 #include <glm/gtc/matrix_transform.hpp>
-#include <stb_image.h>
 #include <assimp/Importer.hpp>
 #include <assimp/scene.h>
 #include <assimp/postprocess.h>
 
 #include "mesh.h"
 #include "shader.h"
+#include "AssetCache.h"
+#include "ImageData.h"
+#include "TextureCache.h"
+#include "TextureCook.h"
 
 #include <string>
 #include <fstream>
 #include <sstream>
 #include <iostream>
 #include <map>
+#include <memory>
 #include <vector>
 using namespace std;
 
-unsigned int TextureFromFile(const char* path, const string& directory, bool gamma = false);
-
 class Model
 {
 public:
     // model data 
-    vector<PBRTexture> textures_loaded;	// stores all the textures loaded so far, optimization to make sure textures aren't loaded more than once.
     vector<Mesh>    meshes;
     string directory;
     bool gammaCorrection;
     glm::vec3 startPosition;
 
+    Model() = default;
+
     // constructor, expects a filepath to a 3D model.
     Model(string const& path, bool gamma = false) : gammaCorrection(gamma)
     {
@@ -50,24 +53,144 @@ public:
             meshes[i].Draw(shader);
     }
 
-private:
-    // loads a model with supported ASSIMP extensions from file and stores the resulting meshes in the meshes vector.
     void loadModel(string const& path)
     {
-        // read file via ASSIMP
-        Assimp::Importer importer;
-        const aiScene* scene = importer.ReadFile(path, aiProcess_Triangulate | aiProcess_GenSmoothNormals | aiProcess_FlipUVs | aiProcess_CalcTangentSpace);
-        // check for errors
-        if (!scene || scene->mFlags & AI_SCENE_FLAGS_INCOMPLETE || !scene->mRootNode) // if is Not Zero
-        {
-            cout << "ERROR::ASSIMP:: " << importer.GetErrorString() << endl;
-            return;
-        }
+        ParseModel(path);
+        UploadModel();
+    }
+
+    // CPU half of loadModel, safe on a worker thread: reads the cache or imports the source
+    // and decodes every texture. No GL calls.
+    void ParseModel(string const& path)
+    {
         // retrieve the directory path of the filepath
         directory = path.substr(0, path.find_last_of('/'));
+        if (!LoadCache(path))
+        {
+            // read file via ASSIMP
+            Assimp::Importer importer;
+            const aiScene* scene = importer.ReadFile(path, aiProcess_Triangulate | aiProcess_GenSmoothNormals | aiProcess_FlipUVs | aiProcess_CalcTangentSpace);
+            // check for errors
+            if (!scene || scene->mFlags & AI_SCENE_FLAGS_INCOMPLETE || !scene->mRootNode) // if is Not Zero
+            {
+                cout << "ERROR::ASSIMP:: " << importer.GetErrorString() << endl;
+                return;
+            }
+            // process ASSIMP's root node recursively
+            processNode(scene->mRootNode, scene);
+
+            if (AssetCache::IsCooking())
+                SaveCache(path);
+        }
+
+        // aiProcess_FlipUVs already matches GL's origin, so these are decoded as stored
+        for (const PendingMesh& mesh : m_PendingMeshes)
+        {
+            for (const PBRTexture& texture : mesh.textures)
+            {
+                string fullPath = directory + '/' + texture.path;
+                // another model (or an earlier load of this one) may already have it on the GPU
+                if (m_DecodedImages.find(texture.path) == m_DecodedImages.end() && !TextureCache::Get().Contains(fullPath, false))
+                    m_DecodedImages[texture.path] = DecodeTexture(fullPath, false);
+            }
+        }
+    }
+
+    // GL half of loadModel, context thread only: creates the buffers and textures ParseModel prepared
+    void UploadModel()
+    {
+        // this load's texture references, told apart from other models' for the sharing totals
+        m_TextureOwner = TextureCache::Get().NewOwner();
+        for (PendingMesh& mesh : m_PendingMeshes)
+        {
+            for (PBRTexture& texture : mesh.textures)
+                texture = loadTexture(texture.path, texture.type);
+            const PBRVertex* vertexData = mesh.vertexData ? mesh.vertexData : mesh.vertices.data();
+            const unsigned int* indexData = mesh.indexData ? mesh.indexData : mesh.indices.data();
+            meshes.push_back(Mesh(vertexData, mesh.vertexCount, indexData, mesh.indexCount, mesh.textures));
+        }
+        m_PendingMeshes.clear();
+        m_DecodedImages.clear();
+        m_PendingCache.reset();
+    }
+
+private:
+    // mesh data between ParseModel and UploadModel; either owns its arrays (parsed from the
+    // source) or points into the mapped cache. Textures only carry type and path until upload.
+    struct PendingMesh
+    {
+        vector<PBRVertex> vertices;
+        vector<unsigned int> indices;
+        const PBRVertex* vertexData = nullptr;
+        const unsigned int* indexData = nullptr;
+        size_t vertexCount = 0;
+        size_t indexCount = 0;
+        vector<PBRTexture> textures;
+    };
+
+    vector<PendingMesh> m_PendingMeshes;
+    std::map<string, DecodedImage> m_DecodedImages;
+    int m_TextureOwner = 0;
+    std::unique_ptr<CacheReader> m_PendingCache; // keeps cached mesh arrays mapped until upload
+
+    // cache layout: per mesh vertices, indices and texture refs
+    void SaveCache(const string& path)
+    {
+        CacheWriter writer;
+        writer.Write((uint32_t)m_PendingMeshes.size());
+        for (const PendingMesh& mesh : m_PendingMeshes)
+        {
+            writer.Write((uint32_t)mesh.vertices.size());
+            writer.Write((uint32_t)mesh.indices.size());
+            writer.Write((uint32_t)mesh.textures.size());
+            writer.WriteArray(mesh.vertices.data(), mesh.vertices.size());
+            writer.WriteArray(mesh.indices.data(), mesh.indices.size());
+            for (const PBRTexture& texture : mesh.textures)
+            {
+                writer.WriteString(texture.type);
+                writer.WriteString(texture.path);
+            }
+        }
+        writer.Save(path, AssetCache::StaticModel);
+    }
 
-        // process ASSIMP's root node recursively
-        processNode(scene->mRootNode, scene);
+    bool LoadCache(const string& path)
+    {
+        std::unique_ptr<CacheReader> reader(new CacheReader());
+        if (!reader->Open(path, AssetCache::StaticModel))
+            return false;
+
+        // vertex and index arrays stay in the mapping until UploadModel hands them to GL
+        uint32_t meshCount = reader->Read<uint32_t>();
+        for (uint32_t i = 0; i < meshCount && reader->IsValid(); i++)
+        {
+            PendingMesh mesh;
+            mesh.vertexCount = reader->Read<uint32_t>();
+            mesh.indexCount = reader->Read<uint32_t>();
+            uint32_t textureCount = reader->Read<uint32_t>();
+            mesh.vertexData = reader->ReadArray<PBRVertex>(mesh.vertexCount);
+            mesh.indexData = reader->ReadArray<unsigned int>(mesh.indexCount);
+            for (uint32_t t = 0; t < textureCount && reader->IsValid(); t++)
+            {
+                PBRTexture texture;
+                texture.id = 0;
+                texture.type = reader->ReadString();
+                texture.path = reader->ReadString();
+                mesh.textures.push_back(texture);
+            }
+            if (reader->IsValid())
+                m_PendingMeshes.push_back(std::move(mesh));
+        }
+        if (!reader->IsValid())
+        {
+            // the header matched but the payload did not; start over from the source. Nothing
+            // here has reached GL yet, UploadModel creates the buffers and textures.
+            cout << "ERROR::ASSET_CACHE:: corrupt cache for " << path << endl;
+            m_PendingMeshes.clear();
+            return false;
+        }
+        m_PendingCache = std::move(reader);
+        return true;
     }
 
     // processes a node in a recursive fashion. Processes each individual mesh located at the node and repeats this process on its children nodes (if any).
@@ -79,7 +202,7 @@ private:
             // the node object only contains indices to index the actual objects in the scene. 
             // the scene contains all the data, node is just to keep stuff organized (like relations between nodes).
             aiMesh* mesh = scene->mMeshes[node->mMeshes[i]];
-            meshes.push_back(processMesh(mesh, scene));
+            m_PendingMeshes.push_back(processMesh(mesh, scene));
         }
         // after we've processed all of the meshes (if any) we then recursively process each of the children nodes
         for (unsigned int i = 0; i < node->mNumChildren; i++)
@@ -89,12 +212,13 @@ private:
 
     }
 
-    Mesh processMesh(aiMesh* mesh, const aiScene* scene)
+    PendingMesh processMesh(aiMesh* mesh, const aiScene* scene)
     {
         // data to fill
-        vector<PBRVertex> vertices;
-        vector<unsigned int> indices;
-        vector<PBRTexture> textures;
+        PendingMesh pending;
+        vector<PBRVertex>& vertices = pending.vertices;
+        vector<unsigned int>& indices = pending.indices;
+        vector<PBRTexture>& textures = pending.textures;
 
         // walk through each of the mesh's vertices
         for (unsigned int i = 0; i < mesh->mNumVertices; i++)
@@ -184,13 +308,15 @@ private:
         vector<PBRTexture> aoMaps = loadMaterialTextures(material, aiTextureType_AMBIENT_OCCLUSION, "texture_ao");
         textures.insert(textures.end(), aoMaps.begin(), aoMaps.end());
 
-        // return a mesh object created from the extracted mesh data
-        return Mesh(vertices, indices, textures);
+        // the GL mesh is created from this in UploadModel
+        pending.vertexCount = vertices.size();
+        pending.indexCount = indices.size();
+        return pending;
 
     }
 
-    // checks all material textures of a given type and loads the textures if they're not loaded yet.
-    // the required info is returned as a Texture struct.
+    // collects the material's textures of a given type; they are decoded by ParseModel and
+    // created by UploadModel once every mesh is known
     vector<PBRTexture> loadMaterialTextures(aiMaterial* mat, aiTextureType type, string typeName) {
         vector<PBRTexture> textures;
         for (unsigned int i = 0; i < mat->GetTextureCount(type); i++) {
@@ -200,72 +326,34 @@ private:
             // Debugging: Output the texture type and path
             std::cout << "Checking texture: " << str.C_Str() << " for type: " << typeName << std::endl;
 
-            bool skip = false;
-            for (unsigned int j = 0; j < textures_loaded.size(); j++) {
-                if (std::strcmp(textures_loaded[j].path.data(), str.C_Str()) == 0) {
-                    textures.push_back(textures_loaded[j]);
-                    skip = true;
-
-                    // Debugging: Notify that this texture was skipped because it was already loaded
-                    std::cout << "Skipping texture (already loaded): " << str.C_Str() << std::endl;
-                    break;
-                }
-            }
-            if (!skip) {
-                // If texture hasn't been loaded already, load it
-                PBRTexture texture;
-                texture.id = TextureFromFile(str.C_Str(), this->directory);  // Assuming TextureFromFile is your custom function
-                texture.type = typeName;
-                texture.path = str.C_Str();
-                textures.push_back(texture);
-                textures_loaded.push_back(texture);
-
-                // Debugging: Notify that this texture was successfully loaded
-                std::cout << "Loaded texture: " << str.C_Str() << " as type: " << typeName << std::endl;
-            }
+            PBRTexture texture;
+            texture.id = 0;
+            texture.type = typeName;
+            texture.path = str.C_Str();
+            textures.push_back(texture);
         }
         return textures;
     }
-};
-
-
-unsigned int TextureFromFile(const char* path, const string& directory, bool gamma)
-{
-    string filename = string(path);
-    filename = directory + '/' + filename;
 
-    unsigned int textureID;
-    glGenTextures(1, &textureID);
-
-    int width, height, nrComponents;
-    unsigned char* data = stbi_load(filename.c_str(), &width, &height, &nrComponents, 0);
-    if (data)
-    {
-        GLenum format;
-        if (nrComponents == 1)
-            format = GL_RED;
-        else if (nrComponents == 3)
-            format = GL_RGB;
-        else if (nrComponents == 4)
-            format = GL_RGBA;
-
-        glBindTexture(GL_TEXTURE_2D, textureID);
-        glTexImage2D(GL_TEXTURE_2D, 0, format, width, height, 0, format, GL_UNSIGNED_BYTE, data);
-        glGenerateMipmap(GL_TEXTURE_2D);
-
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-
-        stbi_image_free(data);
-    }
-    else
-    {
-        std::cout << "Texture failed to load at path: " << path << std::endl;
-        stbi_image_free(data);
+    // shares the texture through the process-wide TextureCache; the first user uploads it from
+    // the image ParseModel decoded
+    PBRTexture loadTexture(const string& path, const string& typeName) {
+        PBRTexture texture;
+        auto decoded = m_DecodedImages.find(path);
+        if (decoded != m_DecodedImages.end())
+        {
+            texture.id = TextureCache::Get().Acquire(decoded->second, m_TextureOwner);
+            m_DecodedImages.erase(decoded);
+            // Debugging: Notify that this texture was successfully loaded
+            std::cout << "Loaded texture: " << path << " as type: " << typeName << std::endl;
+        }
+        else
+            texture.id = TextureCache::Get().Load(this->directory + '/' + path, false, m_TextureOwner);
+        texture.type = typeName;
+        texture.path = path;
+        return texture;
     }
+};
+
 
-    return textureID;
-}
 #endif
\ No newline at end of file
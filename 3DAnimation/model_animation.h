@@ -5,7 +5,6 @@
 
 #include <glm/glm.hpp>
 #include <glm/gtc/matrix_transform.hpp>
-#include <stb_image.h>
 #include <assimp/Importer.hpp>
 #include <assimp/scene.h>
 #include <assimp/postprocess.h>
@@ -23,9 +22,15 @@
 #include <sstream>
 #include <iostream>
 #include <map>
+#include <memory>
 #include <vector>
 #include "assimp_glm_helpers.h"
 #include "animdata.h"
+#include "skeleton.h"
+#include "AssetCache.h"
+#include "ImageData.h"
+#include "TextureCache.h"
+#include "TextureCook.h"
 
 using namespace std;
 
@@ -33,7 +38,6 @@ class ModelAnim
 {
 public:
     // model data 
-    vector<Texture> textures_loaded;	// stores all the textures loaded so far, optimization to make sure textures aren't loaded more than once.
     vector<AnimatorMesh>    meshes;
     string directory;
     bool gammaCorrection;
@@ -56,31 +60,204 @@ public:
     
 	auto& GetBoneInfoMap() { return m_BoneInfoMap; }
 	int& GetBoneCount() { return m_BoneCounter; }
+	// offset matrices indexed by bone id, so pose evaluation never goes through the name map
+	const std::vector<AffineTransform>& GetBoneOffsets() const { return m_BoneOffsets; }
+	// node hierarchy shared by every clip loaded against this model
+	const Skeleton& GetSkeleton() const { return m_Skeleton; }
+
+	// returns the id of a named bone, assigning the next free one (with the given offset) if it is new
+	int RegisterBone(const std::string& boneName, const glm::mat4& offset = glm::mat4(1.0f))
+	{
+		auto existing = m_BoneInfoMap.find(boneName);
+		if (existing != m_BoneInfoMap.end())
+			return existing->second.id;
+
+		BoneInfo newBoneInfo;
+		newBoneInfo.id = m_BoneCounter;
+		newBoneInfo.offset = offset;
+		m_BoneInfoMap[boneName] = newBoneInfo;
+		m_BoneOffsets.push_back(PoseMath::FromMat4(offset));
+		m_Skeleton.BindBones(m_BoneInfoMap);
+		return m_BoneCounter++;
+	}
 	
 	void loadModel(string const& path)
 	{
-		// read file via ASSIMP
-		Assimp::Importer importer;
-		const aiScene* scene = importer.ReadFile(path, aiProcess_Triangulate | aiProcess_GenSmoothNormals | aiProcess_CalcTangentSpace);
-		// check for errors
-		if (!scene || scene->mFlags & AI_SCENE_FLAGS_INCOMPLETE || !scene->mRootNode) // if is Not Zero
-		{
-			cout << "ERROR::ASSIMP:: " << importer.GetErrorString() << endl;
-			return;
-		}
+		ParseModel(path);
+		UploadModel();
+	}
+
+	// CPU half of loadModel, safe on a worker thread: reads the cache or imports the source,
+	// registers bones, builds the skeleton and decodes every texture. No GL calls.
+	void ParseModel(string const& path)
+	{
 		// retrieve the directory path of the filepath
 		directory = path.substr(0, path.find_last_of('/'));
+		if (!LoadCache(path))
+		{
+			// read file via ASSIMP
+			Assimp::Importer importer;
+			const aiScene* scene = importer.ReadFile(path, aiProcess_Triangulate | aiProcess_GenSmoothNormals | aiProcess_CalcTangentSpace);
+			// check for errors
+			if (!scene || scene->mFlags & AI_SCENE_FLAGS_INCOMPLETE || !scene->mRootNode) // if is Not Zero
+			{
+				cout << "ERROR::ASSIMP:: " << importer.GetErrorString() << endl;
+				return;
+			}
+			// process ASSIMP's root node recursively
+			processNode(scene->mRootNode, scene);
+
+			m_Skeleton.Build(scene->mRootNode);
+			m_Skeleton.BindBones(m_BoneInfoMap);
 
-		// process ASSIMP's root node recursively
-		processNode(scene->mRootNode, scene);
+			if (AssetCache::IsCooking())
+				SaveCache(path);
+		}
+
+		// character textures are stored upside down relative to GL's origin
+		for (const PendingMesh& mesh : m_PendingMeshes)
+		{
+			for (const Texture& texture : mesh.textures)
+			{
+				string fullPath = directory + '/' + texture.path;
+				// another model (or an earlier load of this one) may already have it on the GPU
+				if (m_DecodedImages.find(texture.path) == m_DecodedImages.end() && !TextureCache::Get().Contains(fullPath, true))
+					m_DecodedImages[texture.path] = DecodeTexture(fullPath, true);
+			}
+		}
+	}
+
+	// GL half of loadModel, context thread only: creates the buffers and textures ParseModel prepared
+	void UploadModel()
+	{
+		// this load's texture references, told apart from other models' for the sharing totals
+		m_TextureOwner = TextureCache::Get().NewOwner();
+		for (PendingMesh& mesh : m_PendingMeshes)
+		{
+			for (Texture& texture : mesh.textures)
+				texture = loadTexture(texture.path, texture.type);
+			const Vertex* vertexData = mesh.vertexData ? mesh.vertexData : mesh.vertices.data();
+			const unsigned int* indexData = mesh.indexData ? mesh.indexData : mesh.indices.data();
+			meshes.push_back(AnimatorMesh(vertexData, mesh.vertexCount, indexData, mesh.indexCount, mesh.textures));
+		}
+		m_PendingMeshes.clear();
+		m_DecodedImages.clear();
+		m_PendingCache.reset();
 	}
 
 
 private:
 
+	// mesh data between ParseModel and UploadModel; either owns its arrays (parsed from the
+	// source) or points into the mapped cache. Textures only carry type and path until upload.
+	struct PendingMesh
+	{
+		vector<Vertex> vertices;
+		vector<unsigned int> indices;
+		const Vertex* vertexData = nullptr;
+		const unsigned int* indexData = nullptr;
+		size_t vertexCount = 0;
+		size_t indexCount = 0;
+		vector<Texture> textures;
+	};
+
+	// cache layout: meshes (vertices, indices, texture refs), bones in id order, skeleton
+	void SaveCache(const string& path)
+	{
+		CacheWriter writer;
+		writer.Write((uint32_t)m_PendingMeshes.size());
+		for (const PendingMesh& mesh : m_PendingMeshes)
+		{
+			writer.Write((uint32_t)mesh.vertices.size());
+			writer.Write((uint32_t)mesh.indices.size());
+			writer.Write((uint32_t)mesh.textures.size());
+			writer.WriteArray(mesh.vertices.data(), mesh.vertices.size());
+			writer.WriteArray(mesh.indices.data(), mesh.indices.size());
+			for (const Texture& texture : mesh.textures)
+			{
+				writer.WriteString(texture.type);
+				writer.WriteString(texture.path);
+			}
+		}
+
+		std::vector<const std::string*> boneNames(m_BoneCounter);
+		for (const auto& bone : m_BoneInfoMap)
+			boneNames[bone.second.id] = &bone.first;
+		writer.Write((uint32_t)m_BoneCounter);
+		for (int id = 0; id < m_BoneCounter; id++)
+		{
+			writer.WriteString(*boneNames[id]);
+			writer.Write(m_BoneInfoMap[*boneNames[id]].offset);
+		}
+
+		m_Skeleton.Write(writer);
+		writer.Save(path, AssetCache::SkinnedModel);
+	}
+
+	bool LoadCache(const string& path)
+	{
+		std::unique_ptr<CacheReader> reader(new CacheReader());
+		if (!reader->Open(path, AssetCache::SkinnedModel))
+			return false;
+
+		// vertex and index arrays stay in the mapping until UploadModel hands them to GL
+		uint32_t meshCount = reader->Read<uint32_t>();
+		for (uint32_t i = 0; i < meshCount && reader->IsValid(); i++)
+		{
+			PendingMesh mesh;
+			mesh.vertexCount = reader->Read<uint32_t>();
+			mesh.indexCount = reader->Read<uint32_t>();
+			uint32_t textureCount = reader->Read<uint32_t>();
+			mesh.vertexData = reader->ReadArray<Vertex>(mesh.vertexCount);
+			mesh.indexData = reader->ReadArray<unsigned int>(mesh.indexCount);
+			for (uint32_t t = 0; t < textureCount && reader->IsValid(); t++)
+			{
+				Texture texture;
+				texture.id = 0;
+				texture.type = reader->ReadString();
+				texture.path = reader->ReadString();
+				mesh.textures.push_back(texture);
+			}
+			if (reader->IsValid())
+				m_PendingMeshes.push_back(std::move(mesh));
+		}
+
+		uint32_t boneCount = reader->Read<uint32_t>();
+		for (uint32_t id = 0; id < boneCount && reader->IsValid(); id++)
+		{
+			string boneName = reader->ReadString();
+			RegisterBone(boneName, reader->Read<glm::mat4>());
+		}
+
+		m_Skeleton.Read(*reader);
+		m_Skeleton.BindBones(m_BoneInfoMap);
+		if (!reader->IsValid())
+		{
+			// The header matched but the payload did not; start over from the source. Nothing
+			// here has reached GL (UploadModel creates the buffers and textures), so dropping
+			// what was read leaves the model as empty as before the call.
+			cout << "ERROR::ASSET_CACHE:: corrupt cache for " << path << endl;
+			m_PendingMeshes.clear();
+			m_BoneInfoMap.clear();
+			m_BoneOffsets.clear();
+			m_BoneCounter = 0;
+			m_Skeleton.Clear();
+			return false;
+		}
+		m_PendingCache = std::move(reader);
+		return true;
+	}
+
 	std::map<string, BoneInfo> m_BoneInfoMap;
+	std::vector<AffineTransform> m_BoneOffsets;
+	Skeleton m_Skeleton;
 	int m_BoneCounter = 0;
 
+	vector<PendingMesh> m_PendingMeshes;
+	std::map<string, DecodedImage> m_DecodedImages;
+	int m_TextureOwner = 0;
+	std::unique_ptr<CacheReader> m_PendingCache; // keeps cached mesh arrays mapped until upload
+
     // loads a model with supported ASSIMP extensions from file and stores the resulting meshes in the meshes vector.
    
     // processes a node in a recursive fashion. Processes each individual mesh located at the node and repeats this process on its children nodes (if any).
@@ -92,7 +269,7 @@ private:
             // the node object only contains indices to index the actual objects in the scene. 
             // the scene contains all the data, node is just to keep stuff organized (like relations between nodes).
             aiMesh* mesh = scene->mMeshes[node->mMeshes[i]];
-            meshes.push_back(processMesh(mesh, scene));
+            m_PendingMeshes.push_back(processMesh(mesh, scene));
         }
         // after we've processed all of the meshes (if any) we then recursively process each of the children nodes
         for(unsigned int i = 0; i < node->mNumChildren; i++)
@@ -112,11 +289,12 @@ private:
 	}
 
 
-	AnimatorMesh processMesh(aiMesh* mesh, const aiScene* scene)
+	PendingMesh processMesh(aiMesh* mesh, const aiScene* scene)
 	{
-		vector<Vertex> vertices;
-		vector<unsigned int> indices;
-		vector<Texture> textures;
+		PendingMesh pending;
+		vector<Vertex>& vertices = pending.vertices;
+		vector<unsigned int>& indices = pending.indices;
+		vector<Texture>& textures = pending.textures;
 
 		for (unsigned int i = 0; i < mesh->mNumVertices; i++)
 		{
@@ -156,7 +334,9 @@ private:
 
 		ExtractBoneWeightForVertices(vertices,mesh,scene);
 
-		return AnimatorMesh(vertices, indices, textures);
+		pending.vertexCount = vertices.size();
+		pending.indexCount = indices.size();
+		return pending;
 	}
 
 	void SetVertexBoneData(Vertex& vertex, int boneID, float weight)
@@ -175,26 +355,10 @@ private:
 
 	void ExtractBoneWeightForVertices(std::vector<Vertex>& vertices, aiMesh* mesh, const aiScene* scene)
 	{
-		auto& boneInfoMap = m_BoneInfoMap;
-		int& boneCount = m_BoneCounter;
-
 		for (int boneIndex = 0; boneIndex < mesh->mNumBones; ++boneIndex)
 		{
-			int boneID = -1;
 			std::string boneName = mesh->mBones[boneIndex]->mName.C_Str();
-			if (boneInfoMap.find(boneName) == boneInfoMap.end())
-			{
-				BoneInfo newBoneInfo;
-				newBoneInfo.id = boneCount;
-				newBoneInfo.offset = AssimpGLMHelpers::ConvertMatrixToGLMFormat(mesh->mBones[boneIndex]->mOffsetMatrix);
-				boneInfoMap[boneName] = newBoneInfo;
-				boneID = boneCount;
-				boneCount++;
-			}
-			else
-			{
-				boneID = boneInfoMap[boneName].id;
-			}
+			int boneID = RegisterBone(boneName, AssimpGLMHelpers::ConvertMatrixToGLMFormat(mesh->mBones[boneIndex]->mOffsetMatrix));
 			assert(boneID != -1);
 			auto weights = mesh->mBones[boneIndex]->mWeights;
 			int numWeights = mesh->mBones[boneIndex]->mNumWeights;
@@ -210,48 +374,8 @@ private:
 	}
 
 
-	unsigned int TextureFromFile(const char* path, const string& directory, bool gamma = false)
-	{
-		string filename = string(path);
-		filename = directory + '/' + filename;
-
-		unsigned int textureID;
-		glGenTextures(1, &textureID);
-
-		int width, height, nrComponents;
-		unsigned char* data = stbi_load(filename.c_str(), &width, &height, &nrComponents, 0);
-		if (data)
-		{
-			GLenum format;
-			if (nrComponents == 1)
-				format = GL_RED;
-			else if (nrComponents == 3)
-				format = GL_RGB;
-			else if (nrComponents == 4)
-				format = GL_RGBA;
-
-			glBindTexture(GL_TEXTURE_2D, textureID);
-			glTexImage2D(GL_TEXTURE_2D, 0, format, width, height, 0, format, GL_UNSIGNED_BYTE, data);
-			glGenerateMipmap(GL_TEXTURE_2D);
-
-			glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
-			glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
-			glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
-			glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-
-			stbi_image_free(data);
-		}
-		else
-		{
-			std::cout << "Texture failed to load at path: " << path << std::endl;
-			stbi_image_free(data);
-		}
-
-		return textureID;
-	}
-    
-    // checks all material textures of a given type and loads the textures if they're not loaded yet.
-    // the required info is returned as a Texture struct.
+    // collects the material's textures of a given type; they are decoded by ParseModel and
+    // created by UploadModel once every mesh is known
     vector<Texture> loadMaterialTextures(aiMaterial *mat, aiTextureType type, string typeName)
     {
         vector<Texture> textures;
@@ -259,29 +383,32 @@ private:
         {
             aiString str;
             mat->GetTexture(type, i, &str);
-            // check if texture was loaded before and if so, continue to next iteration: skip loading a new texture
-            bool skip = false;
-            for(unsigned int j = 0; j < textures_loaded.size(); j++)
-            {
-                if(std::strcmp(textures_loaded[j].path.data(), str.C_Str()) == 0)
-                {
-                    textures.push_back(textures_loaded[j]);
-                    skip = true; // a texture with the same filepath has already been loaded, continue to next one. (optimization)
-                    break;
-                }
-            }
-            if(!skip)
-            {   // if texture hasn't been loaded already, load it
-                Texture texture;
-                texture.id = TextureFromFile(str.C_Str(), this->directory);
-                texture.type = typeName;
-                texture.path = str.C_Str();
-                textures.push_back(texture);
-                textures_loaded.push_back(texture);  // store it as texture loaded for entire model, to ensure we won't unnecessary load duplicate textures.
-            }
+            Texture texture;
+            texture.id = 0;
+            texture.type = typeName;
+            texture.path = str.C_Str();
+            textures.push_back(texture);
         }
         return textures;
     }
+
+    // shares the texture through the process-wide TextureCache; the first user uploads it from
+    // the image ParseModel decoded
+    Texture loadTexture(const string& path, const string& typeName)
+    {
+        Texture texture;
+        auto decoded = m_DecodedImages.find(path);
+        if (decoded != m_DecodedImages.end())
+        {
+            texture.id = TextureCache::Get().Acquire(decoded->second, m_TextureOwner);
+            m_DecodedImages.erase(decoded);
+        }
+        else
+            texture.id = TextureCache::Get().Load(this->directory + '/' + path, true, m_TextureOwner);
+        texture.type = typeName;
+        texture.path = path;
+        return texture;
+    }
 };
 
 
@@ -0,0 +1,156 @@
+#pragma once
+
+/* Pose math for the animator.
+   Local poses stay as packed translation/rotation/scale until the moment they are combined,
+   and hierarchy concatenation runs on 3x4 affine matrices (the bottom row of a bone transform
+   is always 0 0 0 1) with SSE kernels. Define POSE_MATH_SCALAR to force the plain C++ path,
+   e.g. to compare timings. */
+
+#include <cmath>
+#include <glm/glm.hpp>
+#include <glm/gtc/quaternion.hpp>
+
+#if !defined(POSE_MATH_SCALAR) && (defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2) || defined(__SSE2__))
+#define POSE_MATH_SSE
+#include <emmintrin.h>
+#endif
+
+struct BonePose
+{
+	glm::vec3 translation;
+	glm::quat rotation;
+	glm::vec3 scale;
+};
+
+// how far a pose may stray from a reference pose, in bone space
+struct PoseTolerance
+{
+	float position;   // units
+	float rotation;   // degrees
+	float scale;
+};
+
+// worst deviation seen over any number of pose pairs
+struct PoseError
+{
+	float position = 0.0f;
+	float rotation = 0.0f;
+	float scale = 0.0f;
+
+	void Measure(const BonePose& pose, const BonePose& reference)
+	{
+		position = glm::max(position, glm::length(pose.translation - reference.translation));
+		float cosHalfAngle = glm::min(1.0f, std::abs(glm::dot(pose.rotation, reference.rotation)));
+		rotation = glm::max(rotation, glm::degrees(2.0f * std::acos(cosHalfAngle)));
+		scale = glm::max(scale, glm::length(pose.scale - reference.scale));
+	}
+
+	bool Within(const PoseTolerance& tolerance) const
+	{
+		return position <= tolerance.position && rotation <= tolerance.rotation && scale <= tolerance.scale;
+	}
+};
+
+// rows of the upper 3x4 block of a transform; rows[i].w holds the translation.
+// The kernels use unaligned loads, so these can live in ordinary std::vectors.
+struct AffineTransform
+{
+	glm::vec4 rows[3];
+};
+
+class PoseMath
+{
+public:
+	static inline AffineTransform Identity()
+	{
+		AffineTransform out;
+		out.rows[0] = glm::vec4(1.0f, 0.0f, 0.0f, 0.0f);
+		out.rows[1] = glm::vec4(0.0f, 1.0f, 0.0f, 0.0f);
+		out.rows[2] = glm::vec4(0.0f, 0.0f, 1.0f, 0.0f);
+		return out;
+	}
+
+	static inline AffineTransform FromMat4(const glm::mat4& m)
+	{
+		// glm is column-major: m[column][row]
+		AffineTransform out;
+		for (int row = 0; row < 3; row++)
+			out.rows[row] = glm::vec4(m[0][row], m[1][row], m[2][row], m[3][row]);
+		return out;
+	}
+
+	// cross-fade between two local poses; weight 0 gives a, 1 gives b
+	static inline void Blend(const BonePose& a, const BonePose& b, float weight, BonePose& out)
+	{
+		out.translation = glm::mix(a.translation, b.translation, weight);
+		out.rotation = glm::normalize(glm::slerp(a.rotation, b.rotation, weight));
+		out.scale = glm::mix(a.scale, b.scale, weight);
+	}
+
+	// translate * rotate * scale without building the three 4x4 matrices
+	static inline void Compose(const BonePose& pose, AffineTransform& out)
+	{
+		const glm::quat& q = pose.rotation;
+		float xx = q.x * q.x, yy = q.y * q.y, zz = q.z * q.z;
+		float xy = q.x * q.y, xz = q.x * q.z, yz = q.y * q.z;
+		float wx = q.w * q.x, wy = q.w * q.y, wz = q.w * q.z;
+		const glm::vec3& s = pose.scale;
+		const glm::vec3& t = pose.translation;
+
+		out.rows[0] = glm::vec4((1.0f - 2.0f * (yy + zz)) * s.x, 2.0f * (xy - wz) * s.y, 2.0f * (xz + wy) * s.z, t.x);
+		out.rows[1] = glm::vec4(2.0f * (xy + wz) * s.x, (1.0f - 2.0f * (xx + zz)) * s.y, 2.0f * (yz - wx) * s.z, t.y);
+		out.rows[2] = glm::vec4(2.0f * (xz - wy) * s.x, 2.0f * (yz + wx) * s.y, (1.0f - 2.0f * (xx + yy)) * s.z, t.z);
+	}
+
+	// out = a * b; out may alias either input
+	static inline void Multiply(const AffineTransform& a, const AffineTransform& b, AffineTransform& out)
+	{
+#ifdef POSE_MATH_SSE
+		__m128 b0 = _mm_loadu_ps(&b.rows[0].x);
+		__m128 b1 = _mm_loadu_ps(&b.rows[1].x);
+		__m128 b2 = _mm_loadu_ps(&b.rows[2].x);
+		// keeps only the w lane: a's translation is added, b's implicit bottom row is 0 0 0 1
+		const __m128 wMask = _mm_castsi128_ps(_mm_set_epi32(-1, 0, 0, 0));
+		__m128 r[3];
+		for (int i = 0; i < 3; i++)
+		{
+			__m128 row = _mm_loadu_ps(&a.rows[i].x);
+			__m128 sum = _mm_mul_ps(_mm_shuffle_ps(row, row, _MM_SHUFFLE(0, 0, 0, 0)), b0);
+			sum = _mm_add_ps(sum, _mm_mul_ps(_mm_shuffle_ps(row, row, _MM_SHUFFLE(1, 1, 1, 1)), b1));
+			sum = _mm_add_ps(sum, _mm_mul_ps(_mm_shuffle_ps(row, row, _MM_SHUFFLE(2, 2, 2, 2)), b2));
+			r[i] = _mm_add_ps(sum, _mm_and_ps(row, wMask));
+		}
+		_mm_storeu_ps(&out.rows[0].x, r[0]);
+		_mm_storeu_ps(&out.rows[1].x, r[1]);
+		_mm_storeu_ps(&out.rows[2].x, r[2]);
+#else
+		AffineTransform result;
+		for (int i = 0; i < 3; i++)
+		{
+			const glm::vec4& row = a.rows[i];
+			result.rows[i] = row.x * b.rows[0] + row.y * b.rows[1] + row.z * b.rows[2];
+			result.rows[i].w += row.w;
+		}
+		out = result;
+#endif
+	}
+
+	// expands to the column-major 4x4 the skinning shader expects
+	static inline void ToMat4(const AffineTransform& a, glm::mat4& out)
+	{
+#ifdef POSE_MATH_SSE
+		__m128 r0 = _mm_loadu_ps(&a.rows[0].x);
+		__m128 r1 = _mm_loadu_ps(&a.rows[1].x);
+		__m128 r2 = _mm_loadu_ps(&a.rows[2].x);
+		__m128 r3 = _mm_set_ps(1.0f, 0.0f, 0.0f, 0.0f);
+		_MM_TRANSPOSE4_PS(r0, r1, r2, r3);
+		_mm_storeu_ps(&out[0][0], r0);
+		_mm_storeu_ps(&out[1][0], r1);
+		_mm_storeu_ps(&out[2][0], r2);
+		_mm_storeu_ps(&out[3][0], r3);
+#else
+		for (int column = 0; column < 4; column++)
+			out[column] = glm::vec4(a.rows[0][column], a.rows[1][column], a.rows[2][column], column == 3 ? 1.0f : 0.0f);
+#endif
+	}
+};
@@ -0,0 +1,142 @@
+#pragma once
+
+/* Flattened node hierarchy shared by a model and every clip bound to it.
+   Nodes are stored in depth-first order, so a node's parent always comes before it and
+   global transforms can be built in one forward pass without recursion. */
+
+#include <vector>
+#include <map>
+#include <string>
+#include <glm/glm.hpp>
+#include <assimp/scene.h>
+#include "assimp_glm_helpers.h"
+#include "animdata.h"
+#include "pose.h"
+#include "AssetCache.h"
+
+class Skeleton
+{
+public:
+	// flattens an assimp node tree; parents[i] < i for every node except the root (-1)
+	void Build(const aiNode* root)
+	{
+		Clear();
+
+		struct PendingNode { const aiNode* node; int parent; };
+		std::vector<PendingNode> stack;
+		stack.push_back({ root, -1 });
+		while (!stack.empty())
+		{
+			PendingNode pending = stack.back();
+			stack.pop_back();
+
+			int index = (int)m_Parents.size();
+			m_Parents.push_back(pending.parent);
+			m_BindTransforms.push_back(PoseMath::FromMat4(AssimpGLMHelpers::ConvertMatrixToGLMFormat(pending.node->mTransformation)));
+			m_BoneIds.push_back(-1);
+			m_Names.push_back(pending.node->mName.data);
+			m_NodeByName.emplace(m_Names.back(), index);
+
+			// push in reverse so children are visited in file order
+			for (int i = (int)pending.node->mNumChildren - 1; i >= 0; i--)
+				stack.push_back({ pending.node->mChildren[i], index });
+		}
+		FindDetailNodes();
+	}
+
+	// asset cache round trip: parents, bind transforms and names in node order
+	void Write(CacheWriter& writer) const
+	{
+		writer.Write((uint32_t)GetNodeCount());
+		writer.WriteArray(m_Parents.data(), m_Parents.size());
+		writer.WriteArray(m_BindTransforms.data(), m_BindTransforms.size());
+		for (const std::string& name : m_Names)
+			writer.WriteString(name);
+	}
+
+	// back to no nodes, e.g. after a cache that failed part-way through
+	void Clear()
+	{
+		m_Parents.clear();
+		m_BindTransforms.clear();
+		m_BoneIds.clear();
+		m_Names.clear();
+		m_NodeByName.clear();
+		m_Detail.clear();
+		m_DetailCount = 0;
+	}
+
+	void Read(CacheReader& reader)
+	{
+		uint32_t count = reader.Read<uint32_t>();
+		const int* parents = reader.ReadArray<int>(count);
+		const AffineTransform* bindTransforms = reader.ReadArray<AffineTransform>(count);
+		if (!reader.IsValid())
+			return;
+
+		m_Parents.assign(parents, parents + count);
+		m_BindTransforms.assign(bindTransforms, bindTransforms + count);
+		m_BoneIds.assign(count, -1);
+		m_Names.clear();
+		m_NodeByName.clear();
+		for (uint32_t i = 0; i < count; i++)
+		{
+			m_Names.push_back(reader.ReadString());
+			m_NodeByName.emplace(m_Names.back(), (int)i);
+		}
+		FindDetailNodes();
+	}
+
+	// attaches skinning slots to nodes by name; call again whenever bones are added
+	void BindBones(const std::map<std::string, BoneInfo>& boneInfoMap)
+	{
+		for (int i = 0; i < GetNodeCount(); i++)
+		{
+			auto boneInfo = boneInfoMap.find(m_Names[i]);
+			m_BoneIds[i] = boneInfo != boneInfoMap.end() ? boneInfo->second.id : -1;
+		}
+	}
+
+	// load-time only: -1 if the skeleton has no node with this name
+	int FindNode(const std::string& name) const
+	{
+		auto node = m_NodeByName.find(name);
+		return node != m_NodeByName.end() ? node->second : -1;
+	}
+
+	int GetNodeCount() const { return (int)m_Parents.size(); }
+	const int* GetParents() const { return m_Parents.data(); }
+	const AffineTransform* GetBindTransforms() const { return m_BindTransforms.data(); }
+	const int* GetBoneIds() const { return m_BoneIds.data(); }
+	const std::string& GetNodeName(int node) const { return m_Names[node]; }
+
+	// Fingers, face and end-of-chain nodes, with everything below them: the nodes a reduced
+	// level of detail leaves at their bind pose. One flag per node, in node order.
+	const unsigned char* GetDetailNodes() const { return m_Detail.data(); }
+	int GetDetailNodeCount() const { return m_DetailCount; }
+
+private:
+	void FindDetailNodes()
+	{
+		static const char* const detailNames[] = { "Thumb", "Index", "Middle", "Ring", "Pinky",
+			"Eye", "Jaw", "Tongue", "Teeth", "Brow", "Lip", "_End" };
+		m_Detail.assign(GetNodeCount(), 0);
+		m_DetailCount = 0;
+		for (int node = 0; node < GetNodeCount(); node++)
+		{
+			bool detail = m_Parents[node] >= 0 && m_Detail[m_Parents[node]];
+			for (const char* name : detailNames)
+				detail = detail || m_Names[node].find(name) != std::string::npos;
+			m_Detail[node] = detail ? 1 : 0;
+			m_DetailCount += detail ? 1 : 0;
+		}
+	}
+
+	std::vector<int> m_Parents;
+	std::vector<AffineTransform> m_BindTransforms;
+	std::vector<int> m_BoneIds;
+	std::vector<std::string> m_Names;
+	std::map<std::string, int> m_NodeByName;
+	std::vector<unsigned char> m_Detail;
+	int m_DetailCount = 0;
+};
@@ -8,6 +8,7 @@
 #include <fstream>
 #include <sstream>
 #include <iostream>
+#include <unordered_map>
 
 class Shader
 {
@@ -89,6 +90,7 @@ public:
             glAttachShader(ID, geometry);
         glLinkProgram(ID);
         checkCompileErrors(ID, "PROGRAM");
+        reflectUniforms();
         // delete the shaders as they're linked into our program now and no longer necessary
         glDeleteShader(vertex);
         glDeleteShader(fragment);
@@ -103,62 +105,132 @@ public:
         glUseProgram(ID); 
     }
     // utility uniform functions
+    // A uniform name that remembers its location in the last program it was used with.
+    // Hot call sites keep one as a static and pass it to the setters below, which then
+    // cost one integer compare instead of building a string and asking the driver.
+    struct Uniform
+    {
+        explicit Uniform(const char* name) : name(name), program(0), location(-1) {}
+        const char* name;
+        unsigned int program;
+        GLint location;
+    };
+    // ------------------------------------------------------------------------
+    // -1 (ignored by glUniform*) if the program has no active uniform of that name
+    GLint getUniformLocation(const std::string &name) const
+    {
+        auto found = uniformLocations.find(name);
+        return found != uniformLocations.end() ? found->second : -1;
+    }
+    // ------------------------------------------------------------------------
+    GLint getUniformLocation(Uniform &uniform) const
+    {
+        if (uniform.program != ID)
+        {
+            uniform.location = getUniformLocation(uniform.name);
+            uniform.program = ID;
+        }
+        return uniform.location;
+    }
     // ------------------------------------------------------------------------
     void setBool(const std::string &name, bool value) const
     {         
-        glUniform1i(glGetUniformLocation(ID, name.c_str()), (int)value); 
+        glUniform1i(getUniformLocation(name), (int)value); 
     }
     // ------------------------------------------------------------------------
     void setInt(const std::string &name, int value) const
     { 
-        glUniform1i(glGetUniformLocation(ID, name.c_str()), value); 
+        glUniform1i(getUniformLocation(name), value); 
     }
     // ------------------------------------------------------------------------
     void setFloat(const std::string &name, float value) const
     { 
-        glUniform1f(glGetUniformLocation(ID, name.c_str()), value); 
+        glUniform1f(getUniformLocation(name), value); 
     }
     // ------------------------------------------------------------------------
     void setVec2(const std::string &name, const glm::vec2 &value) const
     { 
-        glUniform2fv(glGetUniformLocation(ID, name.c_str()), 1, &value[0]); 
+        glUniform2fv(getUniformLocation(name), 1, &value[0]); 
     }
     void setVec2(const std::string &name, float x, float y) const
     { 
-        glUniform2f(glGetUniformLocation(ID, name.c_str()), x, y); 
+        glUniform2f(getUniformLocation(name), x, y); 
     }
     // ------------------------------------------------------------------------
     void setVec3(const std::string &name, const glm::vec3 &value) const
     { 
-        glUniform3fv(glGetUniformLocation(ID, name.c_str()), 1, &value[0]); 
+        glUniform3fv(getUniformLocation(name), 1, &value[0]); 
     }
     void setVec3(const std::string &name, float x, float y, float z) const
     { 
-        glUniform3f(glGetUniformLocation(ID, name.c_str()), x, y, z); 
+        glUniform3f(getUniformLocation(name), x, y, z); 
     }
     // ------------------------------------------------------------------------
     void setVec4(const std::string &name, const glm::vec4 &value) const
     { 
-        glUniform4fv(glGetUniformLocation(ID, name.c_str()), 1, &value[0]); 
+        glUniform4fv(getUniformLocation(name), 1, &value[0]); 
     }
     void setVec4(const std::string &name, float x, float y, float z, float w) 
     { 
-        glUniform4f(glGetUniformLocation(ID, name.c_str()), x, y, z, w); 
+        glUniform4f(getUniformLocation(name), x, y, z, w); 
     }
     // ------------------------------------------------------------------------
     void setMat2(const std::string &name, const glm::mat2 &mat) const
     {
-        glUniformMatrix2fv(glGetUniformLocation(ID, name.c_str()), 1, GL_FALSE, &mat[0][0]);
+        glUniformMatrix2fv(getUniformLocation(name), 1, GL_FALSE, &mat[0][0]);
     }
     // ------------------------------------------------------------------------
     void setMat3(const std::string &name, const glm::mat3 &mat) const
     {
-        glUniformMatrix3fv(glGetUniformLocation(ID, name.c_str()), 1, GL_FALSE, &mat[0][0]);
+        glUniformMatrix3fv(getUniformLocation(name), 1, GL_FALSE, &mat[0][0]);
     }
     // ------------------------------------------------------------------------
     void setMat4(const std::string &name, const glm::mat4 &mat) const
     {
-        glUniformMatrix4fv(glGetUniformLocation(ID, name.c_str()), 1, GL_FALSE, &mat[0][0]);
+        glUniformMatrix4fv(getUniformLocation(name), 1, GL_FALSE, &mat[0][0]);
+    }
+    // ------------------------------------------------------------------------
+    // uploads a whole mat4 array uniform in one call; name is the array's base name
+    void setMat4Array(const std::string &name, const glm::mat4 *mats, int count) const
+    {
+        glUniformMatrix4fv(getUniformLocation(name), count, GL_FALSE, &mats[0][0][0]);
+    }
+
+    // handle-based setters
+    // ------------------------------------------------------------------------
+    void setInt(Uniform &uniform, int value) const
+    {
+        glUniform1i(getUniformLocation(uniform), value);
+    }
+    // ------------------------------------------------------------------------
+    void setFloat(Uniform &uniform, float value) const
+    {
+        glUniform1f(getUniformLocation(uniform), value);
+    }
+    // ------------------------------------------------------------------------
+    void setVec2(Uniform &uniform, const glm::vec2 &value) const
+    {
+        glUniform2fv(getUniformLocation(uniform), 1, &value[0]);
+    }
+    // ------------------------------------------------------------------------
+    void setVec3(Uniform &uniform, const glm::vec3 &value) const
+    {
+        glUniform3fv(getUniformLocation(uniform), 1, &value[0]);
+    }
+    // ------------------------------------------------------------------------
+    void setVec4(Uniform &uniform, const glm::vec4 &value) const
+    {
+        glUniform4fv(getUniformLocation(uniform), 1, &value[0]);
+    }
+    // ------------------------------------------------------------------------
+    void setMat3(Uniform &uniform, const glm::mat3 &mat) const
+    {
+        glUniformMatrix3fv(getUniformLocation(uniform), 1, GL_FALSE, &mat[0][0]);
+    }
+    // ------------------------------------------------------------------------
+    void setMat4(Uniform &uniform, const glm::mat4 &mat) const
+    {
+        glUniformMatrix4fv(getUniformLocation(uniform), 1, GL_FALSE, &mat[0][0]);
     }
 
     unsigned int getID() const {
@@ -166,6 +238,48 @@ public:
     }
 
 private:
+    // every active uniform by name, filled once at link time; arrays are listed both by their
+    // base name and by each "name[i]" element, so either spelling hits the table
+    std::unordered_map<std::string, GLint> uniformLocations;
+
+    void reflectUniforms()
+    {
+        GLint linked = 0;
+        glGetProgramiv(ID, GL_LINK_STATUS, &linked);
+        if (!linked)
+            return;
+
+        GLint count = 0, maxLength = 0;
+        glGetProgramiv(ID, GL_ACTIVE_UNIFORMS, &count);
+        glGetProgramiv(ID, GL_ACTIVE_UNIFORM_MAX_LENGTH, &maxLength);
+        std::string buffer(maxLength > 0 ? maxLength : 1, '\0');
+        for (GLint i = 0; i < count; i++)
+        {
+            GLsizei length = 0;
+            GLint size = 0;
+            GLenum type = 0;
+            glGetActiveUniform(ID, (GLuint)i, (GLsizei)buffer.size(), &length, &size, &type, &buffer[0]);
+            std::string name(buffer.data(), length);
+            GLint location = glGetUniformLocation(ID, name.c_str());
+            if (location < 0)
+                continue; // member of a uniform block, set through its buffer instead
+
+            std::string::size_type bracket = name.find("[0]");
+            if (bracket == std::string::npos || bracket + 3 != name.size())
+            {
+                uniformLocations[name] = location;
+                continue;
+            }
+            std::string base = name.substr(0, bracket);
+            uniformLocations[base] = location;
+            for (GLint element = 0; element < size; element++)
+            {
+                std::string elementName = base + "[" + std::to_string(element) + "]";
+                uniformLocations[elementName] = glGetUniformLocation(ID, elementName.c_str());
+            }
+        }
+    }
+
     // utility function for checking shader compilation/linking errors.
     // ------------------------------------------------------------------------
     void checkCompileErrors(GLuint shader, std::string type)